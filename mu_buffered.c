@@ -0,0 +1,121 @@
+/*
+ * mu_buffered.c
+ *
+ * gcc -Wall -O2 -c mu_buffered.c mu_printf.c
+ */
+
+#include "mu_buffered.h"
+
+// =============================================================================
+// forward declarations
+
+char *buffered_reserve(mu_sink_t *sink, int *n);
+void buffered_commit(mu_sink_t *sink, int n);
+void buffered_end(mu_sink_t *sink);
+int buffered_flush(mu_buffered_t *buffered, mu_flush_reason_t reason);
+
+static const mu_sink_vtable_t s_buffered_vtable = {
+  buffered_reserve,
+  buffered_commit,
+  buffered_end
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_buffered_init(mu_buffered_t *buffered,
+                            char *buf,
+                            int size,
+                            int policy,
+                            emitter_t emitter_fn,
+                            void *obj) {
+  buffered->sink.vtable = &s_buffered_vtable;
+  buffered->emitter_fn = emitter_fn;
+  buffered->emitter_arg = obj;
+  buffered->buf = buf;
+  buffered->size = size;
+  buffered->length = 0;
+  buffered->policy = policy;
+  mu_buffered_reset_stats(buffered);
+  return &buffered->sink;
+}
+
+int mu_buffered_flush(mu_buffered_t *buffered) {
+  return buffered_flush(buffered, MU_FLUSH_EXPLICIT);
+}
+
+void mu_buffered_reset_stats(mu_buffered_t *buffered) {
+  static const mu_buffered_stats_t empty;
+  buffered->stats = empty;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *buffered_reserve(mu_sink_t *sink, int *n) {
+  mu_buffered_t *buffered = (mu_buffered_t *)sink;
+  int room = buffered->size - buffered->length;
+
+  if (*n > room && buffered->length > 0) {
+    // make the whole buffer available, so large writes stay large
+    buffered_flush(buffered, MU_FLUSH_FULL);
+    room = buffered->size;
+  }
+  if (*n > room) {
+    *n = room;
+  }
+  return &buffered->buf[buffered->length];
+}
+
+void buffered_commit(mu_sink_t *sink, int n) {
+  mu_buffered_t *buffered = (mu_buffered_t *)sink;
+  char const *p = &buffered->buf[buffered->length];
+  char const *end = p + n;
+
+  buffered->length += n;
+  if (buffered->policy & MU_FLUSH_ON_NEWLINE) {
+    while (p < end) {
+      if (*p++ == '\n') {
+        buffered_flush(buffered, MU_FLUSH_NEWLINE);
+        break;
+      }
+    }
+  }
+}
+
+void buffered_end(mu_sink_t *sink) {
+  mu_buffered_t *buffered = (mu_buffered_t *)sink;
+
+  if (buffered->policy & MU_FLUSH_ON_CALL) {
+    buffered_flush(buffered, MU_FLUSH_CALL);
+  }
+}
+
+/*
+ * Pass the buffer on and count the flush.  An empty buffer is not flushed.
+ */
+int buffered_flush(mu_buffered_t *buffered, mu_flush_reason_t reason) {
+  mu_buffered_stats_t *stats = &buffered->stats;
+  uint32_t n = buffered->length;
+  int bucket = 0;
+
+  if (n == 0) {
+    return 0;
+  }
+  mu_emit_block(buffered->emitter_fn, buffered->emitter_arg, buffered->buf, n);
+  buffered->length = 0;
+
+  while (bucket < MU_BUFFERED_SIZE_BUCKETS - 1 && (n >> (bucket + 1)) != 0) {
+    bucket++;
+  }
+  if (stats->bytes == 0 || n < stats->smallest) {
+    stats->smallest = n;
+  }
+  if (n > stats->largest) {
+    stats->largest = n;
+  }
+  stats->flushes[reason] += 1;
+  stats->bytes += n;
+  stats->sizes[bucket] += 1;
+  return n;
+}
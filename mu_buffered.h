@@ -0,0 +1,93 @@
+/*
+ * mu_buffered - collect output in a buffer and pass it on in large writes
+ *
+ * Many destinations (USB CDC, SPI flash, semihosting...) are slow per call
+ * and fast per byte, but mu_printf() can hand them single chars.  A
+ * mu_buffered_t is a sink (see mu_sink_t in mu_printf.h) that collects
+ * output in a caller-provided buffer and flushes it to another emitter with
+ * mu_emit_block().  That emitter may itself be mu_sink_emitter with a sink,
+ * in which case each flush is a single copy into the sink's memory.
+ *
+ *   static char buf[128];
+ *   mu_buffered_t usb;
+ *   mu_sink_t *out = mu_buffered_init(&usb, buf, sizeof(buf),
+ *                                     MU_FLUSH_ON_NEWLINE, usb_emitter, NULL);
+ *   mu_printf(mu_sink_emitter, out, "t=%d\n", t);
+ *
+ * The buffer is flushed when it is full, plus on the occasions chosen by the
+ * policy, plus whenever mu_buffered_flush() is called.  The flushes are
+ * counted by reason and by size, to help choose the buffer size and policy.
+ */
+
+#ifndef SOURCE_MU_BUFFERED_H_
+#define SOURCE_MU_BUFFERED_H_
+
+#include "mu_printf.h"
+
+// why a buffer was flushed
+typedef enum {
+  MU_FLUSH_FULL,      // there was no room for more output
+  MU_FLUSH_NEWLINE,   // output included a '\n'
+  MU_FLUSH_CALL,      // a mu_printf() call ended
+  MU_FLUSH_EXPLICIT,  // mu_buffered_flush() was called
+  MU_FLUSH_N_REASONS
+} mu_flush_reason_t;
+
+// policy bits: flush on these occasions as well as when full
+#define MU_FLUSH_ON_NEWLINE (1 << MU_FLUSH_NEWLINE)
+#define MU_FLUSH_ON_CALL (1 << MU_FLUSH_CALL)
+
+// flushes are also counted by size: bucket k holds the flushes of 2^k to
+// 2^(k+1)-1 chars, and the last bucket everything larger
+#define MU_BUFFERED_SIZE_BUCKETS 12
+
+typedef struct {
+  uint32_t flushes[MU_FLUSH_N_REASONS];  // flushes, by reason
+  uint32_t bytes;                        // chars flushed in all
+  uint32_t smallest;                     // fewest chars in one flush
+  uint32_t largest;                      // most chars in one flush
+  uint32_t sizes[MU_BUFFERED_SIZE_BUCKETS];
+} mu_buffered_stats_t;
+
+typedef struct {
+  mu_sink_t sink;        // must come first
+  emitter_t emitter_fn;  // where flushed output goes
+  void *emitter_arg;     // user-supplied argument to emitter_fn
+  char *buf;             // the buffer
+  int size;              // chars in buf
+  int length;            // chars waiting to be flushed
+  int policy;            // MU_FLUSH_ON_xxx bits
+  mu_buffered_stats_t stats;
+} mu_buffered_t;
+
+/*!
+ * @brief Set up buffered to collect output in buf and flush it to
+ * emitter_fn.
+ *
+ * @param buffered The adapter.
+ * @param buf, size The buffer, which should be at least a line long.
+ * @param policy 0, or any of MU_FLUSH_ON_NEWLINE and MU_FLUSH_ON_CALL.
+ * @param emitter_fn Where the flushed output goes.
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_buffered_init(mu_buffered_t *buffered,
+                            char *buf,
+                            int size,
+                            int policy,
+                            emitter_t emitter_fn,
+                            void *obj);
+
+/*!
+ * @brief Pass on whatever output is waiting in the buffer.
+ *
+ * @return The number of chars flushed.
+ */
+int mu_buffered_flush(mu_buffered_t *buffered);
+
+/*!
+ * @brief Zero the flush statistics.
+ */
+void mu_buffered_reset_stats(mu_buffered_t *buffered);
+
+#endif /* SOURCE_MU_BUFFERED_H_ */
@@ -0,0 +1,181 @@
+/*
+ * mu_buffered_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_buffered_test mu_buffered_test.c mu_buffered.c mu_printf.c && ./mu_buffered_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_buffered.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf) - 1) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+bool check_test_emitter(const char *expected) {
+  test_buf[test_index] = '\0';
+  test_index = 0;
+  return strcmp(expected, test_buf) == 0;
+}
+
+// A downstream sink that appends to test_buf and records the size of each
+// write, so the tests can see where the flushes fell.
+int writes[16];
+int n_writes;
+
+char *recording_reserve(mu_sink_t *sink, int *n) {
+  return &test_buf[test_index];
+}
+
+void recording_commit(mu_sink_t *sink, int n) {
+  test_index += n;
+  writes[n_writes++] = n;
+}
+
+static const mu_sink_vtable_t s_recording_vtable = {
+  recording_reserve,
+  recording_commit,
+  NULL
+};
+static mu_sink_t s_recording = {&s_recording_vtable};
+
+bool check_writes(int n, int const *expected) {
+  bool match = n == n_writes && memcmp(writes, expected, n * sizeof(int)) == 0;
+  n_writes = 0;
+  return match;
+}
+
+// ======================================================================
+// tests
+
+void mu_buffered_full_test() {
+  PRINTF("...mu_buffered_full_test\r\n");
+  char buf[8];
+  mu_buffered_t buffered;
+  mu_sink_t *out = mu_buffered_init(&buffered, buf, sizeof(buf), 0,
+                                    mu_sink_emitter, &s_recording);
+
+  // a write larger than the buffer fills it, then the rest waits
+  MU_TEST(mu_printf(mu_sink_emitter, out, "abcdefghij") == 10);
+  MU_TEST(check_writes(1, (int[]){8}));
+  MU_TEST(buffered.length == 2);
+
+  // nothing else goes out until the buffer fills or is flushed
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%d\n", 42) == 3);
+  MU_TEST(check_writes(0, writes));
+  MU_TEST(mu_buffered_flush(&buffered) == 5);
+  MU_TEST(check_writes(1, (int[]){5}));
+  MU_TEST(check_test_emitter("abcdefghij42\n"));
+  MU_TEST(mu_buffered_flush(&buffered) == 0);
+
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_FULL] == 1);
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_EXPLICIT] == 1);
+  MU_TEST(buffered.stats.bytes == 13);
+  MU_TEST(buffered.stats.smallest == 5);
+  MU_TEST(buffered.stats.largest == 8);
+  MU_TEST(buffered.stats.sizes[2] == 1);  // 5
+  MU_TEST(buffered.stats.sizes[3] == 1);  // 8
+
+  mu_buffered_reset_stats(&buffered);
+  MU_TEST(buffered.stats.bytes == 0);
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_FULL] == 0);
+}
+
+void mu_buffered_newline_test() {
+  PRINTF("...mu_buffered_newline_test\r\n");
+  char buf[32];
+  mu_buffered_t buffered;
+  mu_sink_t *out = mu_buffered_init(&buffered, buf, sizeof(buf),
+                                    MU_FLUSH_ON_NEWLINE,
+                                    mu_sink_emitter, &s_recording);
+
+  MU_TEST(mu_printf(mu_sink_emitter, out, "a=%d ", 1) == 4);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "b=%s\n", "two") == 6);
+  MU_TEST(check_writes(1, (int[]){10}));
+  MU_TEST(mu_printf(mu_sink_emitter, out, "c\n") == 2);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "partial") == 7);
+  MU_TEST(check_writes(1, (int[]){2}));
+  MU_TEST(buffered.length == 7);
+
+  // single chars go through the sink too
+  MU_TEST(mu_emit_char(mu_sink_emitter, out, '\n') == 1);
+  MU_TEST(check_writes(1, (int[]){8}));
+  MU_TEST(check_test_emitter("a=1 b=two\nc\npartial\n"));
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_NEWLINE] == 3);
+}
+
+void mu_buffered_call_test() {
+  PRINTF("...mu_buffered_call_test\r\n");
+  char buf[32];
+  mu_buffered_t buffered;
+  mu_sink_t *out = mu_buffered_init(&buffered, buf, sizeof(buf),
+                                    MU_FLUSH_ON_CALL,
+                                    mu_sink_emitter, &s_recording);
+
+  // each call goes out as one write, however it was produced
+  MU_TEST(mu_printf(mu_sink_emitter, out, "[%5d|%-4s|%x]", -7, "ab", 255) == 15);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "") == 0);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%c", 'z') == 1);
+  MU_TEST(check_writes(2, (int[]){15, 1}));
+  MU_TEST(check_test_emitter("[   -7|ab  |ff]z"));
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_CALL] == 2);
+
+  static const int values[] = {1, 2, 3};
+  MU_TEST(mu_format_array(mu_sink_emitter, out, "%d", ",", values, 3) == 5);
+  MU_TEST(check_writes(1, (int[]){5}));
+  MU_TEST(check_test_emitter("1,2,3"));
+}
+
+void mu_buffered_emitter_test() {
+  PRINTF("...mu_buffered_emitter_test\r\n");
+  char buf[4];
+  mu_buffered_t buffered;
+  mu_sink_t *out = mu_buffered_init(&buffered, buf, sizeof(buf),
+                                    MU_FLUSH_ON_CALL, test_emitter, NULL);
+
+  // any emitter can be downstream
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s=%d", "seven", 7) == 7);
+  MU_TEST(check_test_emitter("seven=7"));
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_FULL] == 1);
+  MU_TEST(buffered.stats.flushes[MU_FLUSH_CALL] == 1);
+}
+
+void mu_buffered_test() {
+  PRINTF("begin tests...\r\n");
+  mu_buffered_full_test();
+  mu_buffered_newline_test();
+  mu_buffered_call_test();
+  mu_buffered_emitter_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_buffered_test();
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * mu_cobs.c
+ *
+ * gcc -Wall -O2 -c mu_cobs.c mu_printf.c
+ */
+
+#include "mu_cobs.h"
+
+// =============================================================================
+// forward declarations
+
+char *cobs_reserve(mu_sink_t *sink, int *n);
+void cobs_commit(mu_sink_t *sink, int n);
+void cobs_end(mu_sink_t *sink);
+void cobs_send_block(mu_cobs_t *cobs, int length);
+
+static const mu_sink_vtable_t s_cobs_vtable = {
+  cobs_reserve,
+  cobs_commit,
+  cobs_end
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_cobs_init(mu_cobs_t *cobs, emitter_t emitter_fn, void *obj) {
+  cobs->sink.vtable = &s_cobs_vtable;
+  cobs->emitter_fn = emitter_fn;
+  cobs->emitter_arg = obj;
+  cobs->length = 0;
+  cobs->in_packet = false;
+  cobs->after_full = false;
+  return &cobs->sink;
+}
+
+int mu_cobs_decode(char *buf, int n) {
+  uint8_t const *src = (uint8_t const *)buf;
+  uint8_t const *end = src + n;
+  char *dst = buf;
+
+  // each block decodes to no more chars than it holds, so dst never passes src
+  while (src < end) {
+    int code = *src++;
+    int i;
+    if (code == 0 || code - 1 > end - src) {
+      return -1;
+    }
+    for (i=1; i<code; i++) {
+      if (*src == 0) {
+        return -1;
+      }
+      *dst++ = *src++;
+    }
+    // a block that is not full stands for a zero, except at the very end
+    if (code < 0xff && src < end) {
+      *dst++ = 0;
+    }
+  }
+  return dst - buf;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *cobs_reserve(mu_sink_t *sink, int *n) {
+  mu_cobs_t *cobs = (mu_cobs_t *)sink;
+  int room;
+
+  if (cobs->length == MU_COBS_BLOCK_SIZE) {
+    cobs_send_block(cobs, MU_COBS_BLOCK_SIZE);
+  }
+  room = MU_COBS_BLOCK_SIZE - cobs->length;
+  if (*n > room) {
+    *n = room;
+  }
+  return &cobs->block[1 + cobs->length];
+}
+
+void cobs_commit(mu_sink_t *sink, int n) {
+  mu_cobs_t *cobs = (mu_cobs_t *)sink;
+  char *p = &cobs->block[1 + cobs->length];
+  char *end = p + n;
+  char *zero;
+
+  cobs->in_packet = true;
+  // Text rarely holds a zero, so look for one with memchr and only then
+  // split the block: it ends at the zero, and what follows starts the next.
+  while ((zero = __builtin_memchr(p, 0, end - p)) != (void *)0) {
+    int after = end - zero - 1;
+    cobs_send_block(cobs, zero - &cobs->block[1]);
+    __builtin_memmove(&cobs->block[1], zero + 1, after);
+    p = &cobs->block[1];
+    end = p + after;
+  }
+  cobs->length = end - &cobs->block[1];
+}
+
+void cobs_end(mu_sink_t *sink) {
+  mu_cobs_t *cobs = (mu_cobs_t *)sink;
+
+  if (!cobs->in_packet) {
+    return;  // the call printed nothing
+  }
+  // the last block stands for no zero, and after a full block is not needed
+  if (cobs->length > 0 || !cobs->after_full) {
+    cobs_send_block(cobs, cobs->length);
+  }
+  mu_emit_char(cobs->emitter_fn, cobs->emitter_arg, 0);
+  cobs->in_packet = false;
+  cobs->after_full = false;
+  if (cobs->emitter_fn == mu_sink_emitter) {
+    mu_sink_t *downstream = cobs->emitter_arg;
+    if (downstream->vtable->end) {
+      downstream->vtable->end(downstream);
+    }
+  }
+}
+
+/*
+ * Send the block's code byte and its first length data bytes, and start a
+ * new block.
+ */
+void cobs_send_block(mu_cobs_t *cobs, int length) {
+  cobs->block[0] = length + 1;
+  mu_emit_block(cobs->emitter_fn, cobs->emitter_arg, cobs->block, length + 1);
+  cobs->after_full = length == MU_COBS_BLOCK_SIZE;
+  cobs->length = 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * mu_cobs - COBS-encode output on the fly
+ *
+ * Consistent Overhead Byte Stuffing removes every zero byte from a message,
+ * at a cost of one byte in 254, so that a zero can mark the end of each
+ * message on a serial link.  A mu_cobs_t is a sink (see mu_sink_t in
+ * mu_printf.h) that encodes the output of each mu_printf() call as it is
+ * written and passes it on to another emitter, followed by a zero.  A call
+ * that prints nothing sends nothing.
+ *
+ * COBS replaces each zero with the distance to the next one, so the encoder
+ * must look ahead: it holds at most one 254 byte block.  The formatter
+ * writes straight into that block, and each finished block goes downstream
+ * with one mu_emit_block(), so there is no message buffer and no second copy.
+ *
+ *   mu_cobs_t cobs;
+ *   mu_sink_t *out = mu_cobs_init(&cobs, uart_emitter, NULL);
+ *   mu_printf(mu_sink_emitter, out, "t=%d", t);  // one zero-terminated packet
+ */
+
+#ifndef SOURCE_MU_COBS_H_
+#define SOURCE_MU_COBS_H_
+
+#include "mu_printf.h"
+
+#define MU_COBS_BLOCK_SIZE 254  // most data bytes in one block
+
+typedef struct {
+  mu_sink_t sink;         // must come first
+  emitter_t emitter_fn;   // where encoded packets go
+  void *emitter_arg;      // user-supplied argument to emitter_fn
+  int length;             // data bytes in the block so far
+  bool in_packet;         // this call has written something
+  bool after_full;        // the last block sent was a full one
+  char block[1 + MU_COBS_BLOCK_SIZE];  // code byte, then data
+} mu_cobs_t;
+
+/*!
+ * @brief Set up cobs to encode each call's output as a packet for
+ * emitter_fn.
+ *
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_cobs_init(mu_cobs_t *cobs, emitter_t emitter_fn, void *obj);
+
+/*!
+ * @brief Decode one COBS packet, without its terminating zero, in place.
+ *
+ * @return The length of the decoded message, or -1 if buf is not valid COBS.
+ */
+int mu_cobs_decode(char *buf, int n);
+
+#endif /* SOURCE_MU_COBS_H_ */
@@ -0,0 +1,175 @@
+/*
+ * mu_cobs_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_cobs_test mu_cobs_test.c mu_cobs.c mu_printf.c && ./mu_cobs_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_cobs.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[1024];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf)) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+bool check_test_emitter(char const *expected, int n) {
+  bool match = test_index == n && memcmp(expected, test_buf, n) == 0;
+  test_index = 0;
+  return match;
+}
+
+// Encode n bytes as one packet, as if one mu_printf() call had printed them.
+void encode(mu_sink_t *out, char const *data, int n) {
+  mu_emit_block(mu_sink_emitter, out, data, n);
+  out->vtable->end(out);
+}
+
+// Fill buf with n bytes counting up from first.
+char *counting(char *buf, int first, int n) {
+  int i;
+  for (i=0; i<n; i++) {
+    buf[i] = first + i;
+  }
+  return buf;
+}
+
+// ======================================================================
+// tests
+
+void mu_cobs_encode_test() {
+  PRINTF("...mu_cobs_encode_test\r\n");
+  static char data[256];
+  static char expected[260];
+  mu_cobs_t cobs;
+  mu_sink_t *out = mu_cobs_init(&cobs, test_emitter, NULL);
+
+  // the examples from the COBS paper and its usual write-ups
+  encode(out, "\x00", 1);
+  MU_TEST(check_test_emitter("\x01\x01\x00", 3));
+  encode(out, "\x00\x00", 2);
+  MU_TEST(check_test_emitter("\x01\x01\x01\x00", 4));
+  encode(out, "\x00\x11\x00", 3);
+  MU_TEST(check_test_emitter("\x01\x02\x11\x01\x00", 5));
+  encode(out, "\x11\x22\x00\x33", 4);
+  MU_TEST(check_test_emitter("\x03\x11\x22\x02\x33\x00", 6));
+  encode(out, "\x11\x22\x33\x44", 4);
+  MU_TEST(check_test_emitter("\x05\x11\x22\x33\x44\x00", 6));
+  encode(out, "\x11\x00\x00\x00", 4);
+  MU_TEST(check_test_emitter("\x02\x11\x01\x01\x01\x00", 6));
+
+  // 01..fe: one full block
+  expected[0] = (char)0xff;
+  counting(&expected[1], 1, 254);
+  expected[255] = 0;
+  encode(out, counting(data, 1, 254), 254);
+  MU_TEST(check_test_emitter(expected, 256));
+
+  // 00..fe
+  expected[0] = 1;
+  expected[1] = (char)0xff;
+  counting(&expected[2], 1, 254);
+  expected[256] = 0;
+  encode(out, counting(data, 0, 255), 255);
+  MU_TEST(check_test_emitter(expected, 257));
+
+  // 01..ff: a full block, then one more
+  expected[0] = (char)0xff;
+  counting(&expected[1], 1, 254);
+  expected[255] = 2;
+  expected[256] = (char)0xff;
+  expected[257] = 0;
+  encode(out, counting(data, 1, 255), 255);
+  MU_TEST(check_test_emitter(expected, 258));
+
+  // 02..ff 00
+  expected[0] = (char)0xff;
+  counting(&expected[1], 2, 254);
+  expected[255] = 1;
+  expected[256] = 1;
+  expected[257] = 0;
+  encode(out, counting(data, 2, 255), 255);
+  MU_TEST(check_test_emitter(expected, 258));
+}
+
+void mu_cobs_printf_test() {
+  PRINTF("...mu_cobs_printf_test\r\n");
+  mu_cobs_t cobs;
+  mu_sink_t *out = mu_cobs_init(&cobs, test_emitter, NULL);
+
+  // one packet per call, however the formatter wrote it
+  MU_TEST(mu_printf(mu_sink_emitter, out, "t=%d%c%s", 42, 0, "ok") == 7);
+  MU_TEST(check_test_emitter("\x05t=42\x03ok\x00", 9));
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%c", 0) == 1);
+  MU_TEST(check_test_emitter("\x01\x01\x00", 3));
+  MU_TEST(mu_printf(mu_sink_emitter, out, "") == 0);
+  MU_TEST(check_test_emitter("", 0));
+}
+
+void mu_cobs_round_trip_test() {
+  PRINTF("...mu_cobs_round_trip_test\r\n");
+  static char data[700];
+  unsigned int seed = 1;
+  mu_cobs_t cobs;
+  mu_sink_t *out = mu_cobs_init(&cobs, test_emitter, NULL);
+  int i, n;
+
+  for (n=1; n<(int)sizeof(data); n+=37) {
+    for (i=0; i<n; i++) {
+      seed = seed * 1103515245 + 12345;
+      // mostly text, with zeros now and then
+      data[i] = (seed >> 16) % 8 == 0 ? 0 : 'a' + (seed >> 16) % 26;
+    }
+    test_index = 0;
+    encode(out, data, n);
+    MU_TEST(test_index > n && test_buf[test_index - 1] == 0);
+    MU_TEST(memchr(test_buf, 0, test_index - 1) == NULL);
+    MU_TEST(mu_cobs_decode(test_buf, test_index - 1) == n);
+    MU_TEST(memcmp(test_buf, data, n) == 0);
+  }
+  test_index = 0;
+
+  // malformed packets
+  char bad_code[] = {0x03, 0x11};
+  char bad_zero[] = {0x03, 0x11, 0x00};
+  MU_TEST(mu_cobs_decode(bad_code, sizeof(bad_code)) == -1);
+  MU_TEST(mu_cobs_decode(bad_zero, sizeof(bad_zero)) == -1);
+}
+
+void mu_cobs_test() {
+  PRINTF("begin tests...\r\n");
+  mu_cobs_encode_test();
+  mu_cobs_printf_test();
+  mu_cobs_round_trip_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_cobs_test();
+}
+
+#endif
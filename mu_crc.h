@@ -0,0 +1,31 @@
+/*
+ * mu_crc - CRC-32, eight bytes at a time
+ *
+ * The CRC is the one used by Ethernet, zlib and PNG (reflected polynomial
+ * 0xedb88320, initial value and final xor 0xffffffff).  mu_crc32_update()
+ * folds in eight bytes per step with the slice-by-8 method, at the price of
+ * an 8 KiB table in .rodata; parts with a CRC peripheral can use that instead
+ * wherever a mu_crc_fn is taken.
+ */
+
+#ifndef SOURCE_MU_CRC_H_
+#define SOURCE_MU_CRC_H_
+
+#include <stdint.h>
+
+/*!
+ * @brief Template for "update a CRC" method, e.g. one that drives a hardware
+ * CRC unit.  It must behave like mu_crc32_update().
+ */
+typedef uint32_t (*mu_crc_fn)(uint32_t crc, void const *buf, int n);
+
+/*!
+ * @brief Return the CRC-32 of the data so far (crc) followed by the n bytes
+ * at buf.
+ *
+ * Start with a crc of 0.  Data may be passed in pieces of any size:
+ * mu_crc32_update(mu_crc32_update(0, a, n), b, m) is the CRC of a then b.
+ */
+uint32_t mu_crc32_update(uint32_t crc, void const *buf, int n);
+
+#endif /* SOURCE_MU_CRC_H_ */
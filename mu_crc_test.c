@@ -0,0 +1,86 @@
+/*
+ * mu_crc_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_crc_test mu_crc_test.c mu_crc.c && ./mu_crc_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_crc.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+// the bit-at-a-time definition, to check the tables against
+uint32_t reference_crc32(uint32_t crc, void const *buf, int n) {
+  uint8_t const *p = buf;
+  int i;
+
+  crc = ~crc;
+  while (n-- > 0) {
+    crc ^= *p++;
+    for (i=0; i<8; i++) {
+      crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+    }
+  }
+  return ~crc;
+}
+
+// ======================================================================
+// tests
+
+void mu_crc32_update_test() {
+  PRINTF("...mu_crc32_update_test\r\n");
+  static char data[300];
+  int i, n, split;
+
+  MU_TEST(mu_crc32_update(0, "", 0) == 0);
+  MU_TEST(mu_crc32_update(0, "123456789", 9) == 0xcbf43926);
+  MU_TEST(mu_crc32_update(0, "The quick brown fox jumps over the lazy dog",
+                          43) == 0x414fa339);
+
+  for (i=0; i<(int)sizeof(data); i++) {
+    data[i] = i * 37 + (i >> 3);
+  }
+  // every length and alignment, and split anywhere
+  for (n=0; n<40; n++) {
+    for (i=0; i<8; i++) {
+      MU_TEST(mu_crc32_update(0, &data[i], n) ==
+              reference_crc32(0, &data[i], n));
+    }
+  }
+  uint32_t whole = reference_crc32(0, data, sizeof(data));
+  MU_TEST(mu_crc32_update(0, data, sizeof(data)) == whole);
+  for (split=0; split<=(int)sizeof(data); split+=13) {
+    uint32_t crc = mu_crc32_update(0, data, split);
+    MU_TEST(mu_crc32_update(crc, &data[split], sizeof(data) - split) == whole);
+  }
+}
+
+void mu_crc_test() {
+  PRINTF("begin tests...\r\n");
+  mu_crc32_update_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_crc_test();
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * mu_fanout.c
+ *
+ * gcc -Wall -O2 -c mu_fanout.c mu_printf.c
+ */
+
+#include "mu_fanout.h"
+
+#if MU_FANOUT_OUTPUTS > 32
+#error "MU_FANOUT_OUTPUTS must be at most 32"
+#endif
+
+// =============================================================================
+// forward declarations
+
+char *fanout_reserve(mu_sink_t *sink, int *n);
+void fanout_commit(mu_sink_t *sink, int n);
+void fanout_end(mu_sink_t *sink);
+void fanout_deliver(mu_fanout_t *fanout);
+int deliver_block(emitter_t emitter_fn, void *obj, char const *buf, int n);
+
+static const mu_sink_vtable_t s_fanout_vtable = {
+  fanout_reserve,
+  fanout_commit,
+  fanout_end
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_fanout_init(mu_fanout_t *fanout, char *buf, int size) {
+  fanout->sink.vtable = &s_fanout_vtable;
+  fanout->buf = buf;
+  fanout->size = size;
+  fanout->length = 0;
+  fanout->level = 0;
+  fanout->refused = 0;
+  fanout->n_outputs = 0;
+  return &fanout->sink;
+}
+
+int mu_fanout_add(mu_fanout_t *fanout,
+                  int level,
+                  emitter_t emitter_fn,
+                  void *obj) {
+  static const mu_fanout_output_t empty;
+  mu_fanout_output_t *output;
+
+  if (fanout->n_outputs == MU_FANOUT_OUTPUTS) {
+    return -1;
+  }
+  output = &fanout->outputs[fanout->n_outputs];
+  *output = empty;
+  output->emitter_fn = emitter_fn;
+  output->emitter_arg = obj;
+  output->level = level;
+  return fanout->n_outputs++;
+}
+
+int mu_fanout_printf(mu_fanout_t *fanout, int level, const char *fmt, ...) {
+  va_list ap;
+  int n_emitted;
+
+  va_start(ap, fmt);
+  n_emitted = mu_fanout_vprintf(fanout, level, fmt, ap);
+  va_end(ap);
+  return n_emitted;
+}
+
+int mu_fanout_vprintf(mu_fanout_t *fanout,
+                      int level,
+                      const char *fmt,
+                      va_list arg) {
+  int i;
+
+  for (i=0; i<fanout->n_outputs; i++) {
+    if (level >= fanout->outputs[i].level) {
+      break;
+    }
+  }
+  if (i == fanout->n_outputs) {
+    return 0;  // nobody is listening: don't format
+  }
+  fanout->level = level;
+  return mu_vprintf(mu_sink_emitter, &fanout->sink, fmt, arg);
+}
+
+// =============================================================================
+// =============================================================================
+
+char *fanout_reserve(mu_sink_t *sink, int *n) {
+  mu_fanout_t *fanout = (mu_fanout_t *)sink;
+
+  if (fanout->length == fanout->size) {
+    fanout_deliver(fanout);  // a long message: pass on what is staged so far
+  }
+  if (*n > fanout->size - fanout->length) {
+    *n = fanout->size - fanout->length;
+  }
+  return &fanout->buf[fanout->length];
+}
+
+void fanout_commit(mu_sink_t *sink, int n) {
+  ((mu_fanout_t *)sink)->length += n;
+}
+
+void fanout_end(mu_sink_t *sink) {
+  mu_fanout_t *fanout = (mu_fanout_t *)sink;
+  int i;
+
+  fanout_deliver(fanout);
+  for (i=0; i<fanout->n_outputs; i++) {
+    mu_fanout_output_t *output = &fanout->outputs[i];
+    if (fanout->level < output->level) {
+      continue;
+    }
+    if (fanout->refused & (1u << i)) {
+      output->dropped += 1;
+    } else {
+      output->messages += 1;
+    }
+    if (output->emitter_fn == mu_sink_emitter) {
+      mu_sink_t *downstream = output->emitter_arg;
+      if (downstream->vtable->end) {
+        downstream->vtable->end(downstream);
+      }
+    }
+  }
+  fanout->refused = 0;
+}
+
+/*
+ * Pass the staged chars to every output that wants this message and has not
+ * refused any of it, then empty the staging buffer.
+ */
+void fanout_deliver(mu_fanout_t *fanout) {
+  int n = fanout->length;
+  int i;
+
+  if (n == 0) {
+    return;
+  }
+  for (i=0; i<fanout->n_outputs; i++) {
+    mu_fanout_output_t *output = &fanout->outputs[i];
+    if (fanout->level < output->level || (fanout->refused & (1u << i))) {
+      continue;
+    }
+    if (deliver_block(output->emitter_fn, output->emitter_arg,
+                      fanout->buf, n) < n) {
+      fanout->refused |= 1u << i;
+    }
+  }
+  fanout->length = 0;
+}
+
+/*
+ * Like mu_emit_block(), but stop at the first char the destination refuses.
+ * Return the number of chars it took.
+ */
+int deliver_block(emitter_t emitter_fn, void *obj, char const *buf, int n) {
+  int n_taken = 0;
+
+  if (emitter_fn == mu_sink_emitter) {
+    mu_sink_t *sink = obj;
+    while (n_taken < n) {
+      int room = n - n_taken;
+      char *dst = sink->vtable->reserve(sink, &room);
+      if (room <= 0) {
+        break;
+      }
+      __builtin_memcpy(dst, &buf[n_taken], room);
+      sink->vtable->commit(sink, room);
+      n_taken += room;
+    }
+  } else {
+    while (n_taken < n && emitter_fn(obj, buf[n_taken])) {
+      n_taken++;
+    }
+  }
+  return n_taken;
+}
@@ -0,0 +1,96 @@
+/*
+ * mu_fanout - format once, deliver to several outputs
+ *
+ * Sending the same log line to a UART, a RAM recorder and a flash log with
+ * three mu_printf() calls formats it three times.  A mu_fanout_t is a sink
+ * (see mu_sink_t in mu_printf.h) that stages the formatted text in a
+ * caller-provided buffer and delivers those chars to each of its outputs.
+ *
+ * Each output has a level: it gets the messages whose level is at least
+ * that.  When no output wants a message, mu_fanout_printf() does not format
+ * it at all.
+ *
+ * An output that refuses a char (an emitter that returns 0, or a sink that
+ * grants no room) misses the rest of that message, and the message is
+ * counted as dropped for it; the other outputs are not affected.  The
+ * fan-out cannot interrupt an emitter that blocks, so a slow destination
+ * should refuse rather than wait, or sit behind a buffer of its own (e.g. a
+ * mu_buffered_t).
+ *
+ *   static char staging[128];
+ *   mu_fanout_t log;
+ *   mu_sink_t *out = mu_fanout_init(&log, staging, sizeof(staging));
+ *   mu_fanout_add(&log, LOG_DEBUG, mu_sink_emitter, recorder);
+ *   mu_fanout_add(&log, LOG_INFO, uart_emitter, NULL);
+ *   mu_fanout_add(&log, LOG_WARN, mu_sink_emitter, flash_log);
+ *   mu_fanout_printf(&log, LOG_INFO, "t=%d\n", t);
+ *
+ * Lines longer than the staging buffer are delivered in pieces.
+ */
+
+#ifndef SOURCE_MU_FANOUT_H_
+#define SOURCE_MU_FANOUT_H_
+
+#include "mu_printf.h"
+
+// most outputs in one fan-out
+#ifndef MU_FANOUT_OUTPUTS
+#define MU_FANOUT_OUTPUTS 4
+#endif
+
+typedef struct {
+  emitter_t emitter_fn;  // where this output's chars go
+  void *emitter_arg;     // user-supplied argument to emitter_fn
+  int level;             // least message level delivered
+  uint32_t messages;     // messages delivered in full
+  uint32_t dropped;      // messages cut short because the output refused
+} mu_fanout_output_t;
+
+typedef struct {
+  mu_sink_t sink;       // must come first
+  char *buf;            // the staging buffer
+  int size;             // chars in buf
+  int length;           // chars staged and not yet delivered
+  int level;            // level of the message being formatted
+  uint32_t refused;     // bit i set: output i refused part of this message
+  int n_outputs;
+  mu_fanout_output_t outputs[MU_FANOUT_OUTPUTS];
+} mu_fanout_t;
+
+/*!
+ * @brief Set up fanout, with no outputs, to stage text in buf.
+ *
+ * @return The sink, to be passed as obj with mu_sink_emitter.  Plain
+ * mu_printf() calls through it are delivered at the level of the last
+ * mu_fanout_printf() call (initially 0).
+ */
+mu_sink_t *mu_fanout_init(mu_fanout_t *fanout, char *buf, int size);
+
+/*!
+ * @brief Add an output that gets the messages of level or above.
+ *
+ * @return The index of the new output in fanout->outputs, or -1 if there are
+ * already MU_FANOUT_OUTPUTS.
+ */
+int mu_fanout_add(mu_fanout_t *fanout,
+                  int level,
+                  emitter_t emitter_fn,
+                  void *obj);
+
+/*!
+ * @brief Format a message of the given level once and deliver it to every
+ * output that wants it.
+ *
+ * @return Number of chars formatted, or 0 if no output wanted the message.
+ */
+int mu_fanout_printf(mu_fanout_t *fanout, int level, const char *fmt, ...);
+
+/*!
+ * @brief Identical to mu_fanout_printf(), but with pre-parsed arg list.
+ */
+int mu_fanout_vprintf(mu_fanout_t *fanout,
+                      int level,
+                      const char *fmt,
+                      va_list arg);
+
+#endif /* SOURCE_MU_FANOUT_H_ */
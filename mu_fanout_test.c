@@ -0,0 +1,174 @@
+/*
+ * mu_fanout_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_fanout_test mu_fanout_test.c mu_fanout.c mu_sink.c mu_printf.c && ./mu_fanout_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_fanout.h"
+#include "mu_printf.h"
+#include "mu_sink.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+// A char-at-a-time output that takes up to limit chars, then refuses.
+typedef struct {
+  char buf[256];
+  int length;
+  int limit;
+} test_output_t;
+
+int test_output_emitter(void *obj, char ch) {
+  test_output_t *out = obj;
+  if (out->length >= out->limit) {
+    return 0;
+  }
+  out->buf[out->length++] = ch;
+  return 1;
+}
+
+bool check_test_output(test_output_t *out, const char *expected) {
+  out->buf[out->length] = '\0';
+  out->length = 0;
+  return strcmp(expected, out->buf) == 0;
+}
+
+bool check_buffer_sink(mu_buffer_sink_t *sink, const char *expected) {
+  bool match = sink->length == (int)strlen(expected) &&
+               memcmp(sink->buf, expected, sink->length) == 0;
+  mu_buffer_sink_reset(sink);
+  return match;
+}
+
+enum {LOG_DEBUG, LOG_INFO, LOG_WARN};
+
+// ======================================================================
+// tests
+
+void mu_fanout_level_test() {
+  PRINTF("...mu_fanout_level_test\r\n");
+  char staging[32];
+  char recorder_buf[64];
+  mu_buffer_sink_t recorder;
+  test_output_t uart = {.limit = 256};
+  test_output_t flash = {.limit = 256};
+  mu_fanout_t fanout;
+
+  mu_sink_t *out = mu_fanout_init(&fanout, staging, sizeof(staging));
+  MU_TEST(mu_fanout_printf(&fanout, LOG_WARN, "nobody") == 0);
+  MU_TEST(mu_fanout_add(&fanout, LOG_DEBUG, mu_sink_emitter,
+          mu_buffer_sink_init(&recorder, recorder_buf, sizeof(recorder_buf)))
+          == 0);
+  MU_TEST(mu_fanout_add(&fanout, LOG_INFO, test_output_emitter, &uart) == 1);
+  MU_TEST(mu_fanout_add(&fanout, LOG_WARN, test_output_emitter, &flash) == 2);
+
+  MU_TEST(mu_fanout_printf(&fanout, LOG_DEBUG, "d=%d\n", 1) == 4);
+  MU_TEST(mu_fanout_printf(&fanout, LOG_INFO, "i=%s\n", "two") == 6);
+  MU_TEST(mu_fanout_printf(&fanout, LOG_WARN, "w=%x\n", 255) == 5);
+  MU_TEST(check_buffer_sink(&recorder, "d=1\ni=two\nw=ff\n"));
+  MU_TEST(check_test_output(&uart, "i=two\nw=ff\n"));
+  MU_TEST(check_test_output(&flash, "w=ff\n"));
+  MU_TEST(fanout.outputs[0].messages == 3);
+  MU_TEST(fanout.outputs[1].messages == 2);
+  MU_TEST(fanout.outputs[2].messages == 1);
+
+  // plain mu_printf() goes out at the last level used
+  MU_TEST(mu_printf(mu_sink_emitter, out, "[%3d]", 7) == 5);
+  MU_TEST(check_buffer_sink(&recorder, "[  7]"));
+  MU_TEST(check_test_output(&uart, "[  7]"));
+  MU_TEST(check_test_output(&flash, "[  7]"));
+
+  // messages longer than the staging buffer go out in pieces
+  MU_TEST(mu_fanout_printf(&fanout, LOG_INFO, "%s|%s",
+                           "0123456789abcdefghij", "0123456789abcdefghij") == 41);
+  MU_TEST(check_buffer_sink(&recorder,
+                            "0123456789abcdefghij|0123456789abcdefghij"));
+  MU_TEST(check_test_output(&uart,
+                            "0123456789abcdefghij|0123456789abcdefghij"));
+  MU_TEST(check_test_output(&flash, ""));
+}
+
+void mu_fanout_isolation_test() {
+  PRINTF("...mu_fanout_isolation_test\r\n");
+  char staging[8];
+  char recorder_buf[12];
+  mu_buffer_sink_t recorder;
+  test_output_t uart = {.limit = 3};
+  test_output_t flash = {.limit = 256};
+  mu_fanout_t fanout;
+
+  mu_fanout_init(&fanout, staging, sizeof(staging));
+  mu_fanout_add(&fanout, LOG_DEBUG, test_output_emitter, &uart);
+  mu_fanout_add(&fanout, LOG_DEBUG, mu_sink_emitter,
+                mu_buffer_sink_init(&recorder, recorder_buf,
+                                    sizeof(recorder_buf)));
+  mu_fanout_add(&fanout, LOG_DEBUG, test_output_emitter, &flash);
+
+  // the uart refuses after 3 chars and the recorder fills up after 12, but
+  // the flash log still gets every message in full
+  MU_TEST(mu_fanout_printf(&fanout, LOG_INFO, "abcdefghijkl") == 12);
+  MU_TEST(mu_fanout_printf(&fanout, LOG_INFO, "mn%d", 5) == 3);
+  MU_TEST(check_test_output(&uart, "abc"));
+  MU_TEST(check_buffer_sink(&recorder, "abcdefghijkl"));
+  MU_TEST(check_test_output(&flash, "abcdefghijklmn5"));
+  MU_TEST(fanout.outputs[0].messages == 0);
+  MU_TEST(fanout.outputs[0].dropped == 2);
+  MU_TEST(fanout.outputs[1].messages == 1);
+  MU_TEST(fanout.outputs[1].dropped == 1);
+  MU_TEST(fanout.outputs[2].messages == 2);
+  MU_TEST(fanout.outputs[2].dropped == 0);
+
+  // an output that recovers gets the next message
+  uart.limit = 256;
+  MU_TEST(mu_fanout_printf(&fanout, LOG_INFO, "ok") == 2);
+  MU_TEST(check_test_output(&uart, "ok"));
+  MU_TEST(fanout.outputs[0].messages == 1);
+}
+
+void mu_fanout_add_test() {
+  PRINTF("...mu_fanout_add_test\r\n");
+  char staging[8];
+  test_output_t out = {.limit = 256};
+  mu_fanout_t fanout;
+  int i;
+
+  mu_fanout_init(&fanout, staging, sizeof(staging));
+  for (i=0; i<MU_FANOUT_OUTPUTS; i++) {
+    MU_TEST(mu_fanout_add(&fanout, LOG_INFO, test_output_emitter, &out) == i);
+  }
+  MU_TEST(mu_fanout_add(&fanout, LOG_INFO, test_output_emitter, &out) == -1);
+  MU_TEST(mu_fanout_printf(&fanout, LOG_DEBUG, "x") == 0);
+  MU_TEST(mu_fanout_printf(&fanout, LOG_INFO, "y") == 1);
+  MU_TEST(out.length == MU_FANOUT_OUTPUTS);
+}
+
+void mu_fanout_test() {
+  PRINTF("begin tests...\r\n");
+  mu_fanout_level_test();
+  mu_fanout_isolation_test();
+  mu_fanout_add_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_fanout_test();
+}
+
+#endif
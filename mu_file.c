@@ -0,0 +1,203 @@
+/*
+ * mu_file.c
+ *
+ * gcc -Wall -O2 -pthread -c mu_file.c mu_printf.c
+ */
+
+#include "mu_file.h"
+#include <errno.h>
+#include <sys/uio.h>
+
+#if MU_FILE_BUFFERS < 2
+#error "MU_FILE_BUFFERS must be at least 2"
+#endif
+
+// =============================================================================
+// forward declarations
+
+char *file_reserve(mu_sink_t *sink, int *n);
+void file_commit(mu_sink_t *sink, int n);
+void file_hand_off(mu_file_t *file);
+void file_write(mu_file_t *file, int first, int n);
+void *file_writer(void *arg);
+
+static const mu_sink_vtable_t s_file_vtable = {
+  file_reserve,
+  file_commit,
+  (void *)0  // output waits for a full buffer or mu_file_flush()
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_file_init(mu_file_t *file, int fd, char *mem, int size,
+                        bool async) {
+  int i;
+
+  file->sink.vtable = &s_file_vtable;
+  file->fd = fd;
+  file->async = async;
+  file->error = 0;
+  file->size = size / MU_FILE_BUFFERS;
+  for (i=0; i<MU_FILE_BUFFERS; i++) {
+    file->buf[i] = &mem[i * file->size];
+    file->length[i] = 0;
+  }
+  file->filling = 0;
+  file->first_full = 0;
+  file->n_full = 0;
+  file->stopping = false;
+  if (async) {
+    pthread_mutex_init(&file->lock, NULL);
+    pthread_cond_init(&file->work, NULL);
+    pthread_cond_init(&file->room, NULL);
+    if (pthread_create(&file->writer, NULL, file_writer, file)) {
+      return (void *)0;
+    }
+  }
+  return &file->sink;
+}
+
+int mu_file_flush(mu_file_t *file) {
+  if (file->length[file->filling] > 0) {
+    file_hand_off(file);
+  }
+  if (file->async) {
+    pthread_mutex_lock(&file->lock);
+    while (file->n_full > 0) {
+      pthread_cond_wait(&file->room, &file->lock);
+    }
+    pthread_mutex_unlock(&file->lock);
+  } else if (file->n_full > 0) {
+    file_write(file, file->first_full, file->n_full);
+    file->first_full = file->filling;
+    file->n_full = 0;
+  }
+  return file->error ? -1 : 0;
+}
+
+int mu_file_close(mu_file_t *file) {
+  int result = mu_file_flush(file);
+
+  if (file->async) {
+    pthread_mutex_lock(&file->lock);
+    file->stopping = true;
+    pthread_cond_signal(&file->work);
+    pthread_mutex_unlock(&file->lock);
+    pthread_join(file->writer, NULL);
+    pthread_cond_destroy(&file->room);
+    pthread_cond_destroy(&file->work);
+    pthread_mutex_destroy(&file->lock);
+  }
+  return result;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *file_reserve(mu_sink_t *sink, int *n) {
+  mu_file_t *file = (mu_file_t *)sink;
+  int room;
+
+  if (file->length[file->filling] == file->size) {
+    file_hand_off(file);
+  }
+  room = file->size - file->length[file->filling];
+  if (*n > room) {
+    *n = room;
+  }
+  return &file->buf[file->filling][file->length[file->filling]];
+}
+
+void file_commit(mu_sink_t *sink, int n) {
+  mu_file_t *file = (mu_file_t *)sink;
+  file->length[file->filling] += n;
+}
+
+/*
+ * Pass the buffer being filled on to be written, and move on to the next
+ * one once it is free, writing or waiting as needed.  Buffers are used in
+ * turn, so the next one is free as soon as fewer than all of them are full.
+ */
+void file_hand_off(mu_file_t *file) {
+  if (!file->async) {
+    if (++file->n_full == MU_FILE_BUFFERS) {
+      // every buffer is full: one writev() for the lot
+      file_write(file, file->first_full, MU_FILE_BUFFERS);
+      file->n_full = 0;
+    }
+  } else {
+    pthread_mutex_lock(&file->lock);
+    file->n_full += 1;
+    pthread_cond_signal(&file->work);
+    while (file->n_full == MU_FILE_BUFFERS) {
+      pthread_cond_wait(&file->room, &file->lock);
+    }
+    pthread_mutex_unlock(&file->lock);
+  }
+  file->filling = (file->filling + 1) % MU_FILE_BUFFERS;
+}
+
+/*
+ * Write n full buffers, starting with buffer first, with as few writev()
+ * calls as the kernel allows, and empty them.
+ */
+void file_write(mu_file_t *file, int first, int n) {
+  struct iovec iov[MU_FILE_BUFFERS];
+  struct iovec *next = iov;
+  int i;
+
+  for (i=0; i<n; i++) {
+    int b = (first + i) % MU_FILE_BUFFERS;
+    iov[i].iov_base = file->buf[b];
+    iov[i].iov_len = file->length[b];
+    file->length[b] = 0;
+  }
+  while (n > 0 && file->error == 0) {
+    ssize_t written = writev(file->fd, next, n);
+    if (written < 0) {
+      if (errno != EINTR) {
+        file->error = errno;  // the output is lost
+      }
+      continue;
+    }
+    // skip what was written, which may end part way through a buffer
+    while (n > 0 && (size_t)written >= next->iov_len) {
+      written -= next->iov_len;
+      next++;
+      n--;
+    }
+    if (n > 0) {
+      next->iov_base = (char *)next->iov_base + written;
+      next->iov_len -= written;
+    }
+  }
+}
+
+/*
+ * The writer thread: write whatever buffers are full, all at once, until
+ * told to stop.
+ */
+void *file_writer(void *arg) {
+  mu_file_t *file = arg;
+
+  pthread_mutex_lock(&file->lock);
+  while (true) {
+    while (file->n_full == 0 && !file->stopping) {
+      pthread_cond_wait(&file->work, &file->lock);
+    }
+    if (file->n_full == 0) {
+      break;  // stopping, and nothing left to write
+    }
+    int first = file->first_full;
+    int n = file->n_full;
+    pthread_mutex_unlock(&file->lock);
+    file_write(file, first, n);
+    pthread_mutex_lock(&file->lock);
+    file->first_full = (first + n) % MU_FILE_BUFFERS;
+    file->n_full -= n;
+    pthread_cond_broadcast(&file->room);
+  }
+  pthread_mutex_unlock(&file->lock);
+  return (void *)0;
+}
@@ -0,0 +1,88 @@
+/*
+ * mu_file - buffered output to a file descriptor, written with writev()
+ *
+ * Host only (POSIX).  A putchar() or fputc() emitter makes one library call
+ * per char.  A mu_file_t is a sink (see mu_sink_t in mu_printf.h) that
+ * formats straight into large buffers and writes several of them with a
+ * single writev().
+ *
+ * The caller's memory is split into MU_FILE_BUFFERS buffers that are filled
+ * in turn.  In synchronous mode, output is written once every buffer is
+ * full.  In asynchronous mode a writer thread writes each buffer as soon as
+ * it is full, while formatting goes on in the next one, so formatting
+ * overlaps I/O; mu_printf() waits only when the writer has fallen a whole
+ * set of buffers behind.  Any buffers that are full when the writer wakes
+ * go out in one writev().
+ *
+ *   static char mem[256 * 1024];
+ *   mu_file_t log;
+ *   mu_sink_t *out = mu_file_init(&log, STDOUT_FILENO, mem, sizeof(mem), true);
+ *   mu_printf(mu_sink_emitter, out, "t=%d\n", t);
+ *   ...
+ *   mu_file_close(&log);
+ *
+ * Output is held until a buffer fills; mu_file_flush() writes it now.  A
+ * mu_file_t must only be written from one thread at a time.
+ *
+ * (io_uring would let the kernel take the writes without a thread of our
+ * own, but needs liburing and a recent kernel; a writer thread gives the
+ * same overlap with nothing but pthreads.)
+ */
+
+#ifndef SOURCE_MU_FILE_H_
+#define SOURCE_MU_FILE_H_
+
+#include "mu_printf.h"
+#include <pthread.h>
+
+// number of buffers the caller's memory is split into (at least 2)
+#ifndef MU_FILE_BUFFERS
+#define MU_FILE_BUFFERS 2
+#endif
+
+typedef struct {
+  mu_sink_t sink;                   // must come first
+  int fd;                           // where output goes
+  bool async;                       // written by the writer thread
+  int error;                        // errno of the first failed write, or 0
+  char *buf[MU_FILE_BUFFERS];       // the buffers, used in turn
+  int length[MU_FILE_BUFFERS];      // chars in each
+  int size;                         // chars in one buffer
+  int filling;                      // the buffer being filled
+  int first_full;                   // oldest buffer waiting to be written
+  int n_full;                       // buffers waiting to be written
+  bool stopping;                    // the writer thread should exit
+  pthread_t writer;
+  pthread_mutex_t lock;             // guards first_full, n_full, stopping
+  pthread_cond_t work;              // signalled when a buffer fills
+  pthread_cond_t room;              // signalled when buffers are written
+} mu_file_t;
+
+/*!
+ * @brief Set up file to write to fd through buffers carved out of mem.
+ *
+ * @param file The sink.
+ * @param fd An open file descriptor.  It is not closed by mu_file_close().
+ * @param mem, size Memory for the buffers.
+ * @param async Write from a thread of its own rather than from the caller.
+ * @return The sink, to be passed as obj with mu_sink_emitter, or NULL if
+ * the writer thread could not be started.
+ */
+mu_sink_t *mu_file_init(mu_file_t *file, int fd, char *mem, int size,
+                        bool async);
+
+/*!
+ * @brief Write everything printed so far, and wait until it is written.
+ *
+ * @return 0, or -1 if a write has failed (see file->error).
+ */
+int mu_file_flush(mu_file_t *file);
+
+/*!
+ * @brief Flush, and stop the writer thread.
+ *
+ * @return As for mu_file_flush().
+ */
+int mu_file_close(mu_file_t *file);
+
+#endif /* SOURCE_MU_FILE_H_ */
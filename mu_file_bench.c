@@ -0,0 +1,132 @@
+/*
+ * mu_file_bench.c - logging to a file: stdio against mu_file
+ *
+ * gcc -Wall -O2 -pthread -o mu_file_bench mu_file_bench.c mu_file.c mu_mmap.c mu_sink.c mu_printf.c && ./mu_file_bench [n_records [path]]
+ *
+ * Writes the same n_records log lines (default 1000000) to path (default a
+ * temporary file, removed afterwards) four ways, and reports records/s and
+ * MB/s for each of:
+ *
+ *   fprintf      the C library's fprintf() to a FILE
+ *   fputc        mu_printf() with a fputc() emitter, as in the README
+ *   mu_file      mu_printf() into a mu_file_t, written with writev()
+ *   mu_file -a   the same, written by the writer thread
+ *   mu_mmap      mu_mmap_log_printf() into the file mapped into memory
+ *
+ * Each run truncates the file first and includes the final flush.
+ */
+
+#include "mu_file.h"
+#include "mu_mmap.h"
+#include "mu_printf.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FILE_MEM_SIZE (256 * 1024)
+
+static char s_mem[FILE_MEM_SIZE];
+
+double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int fputc_emitter(void *obj, char ch) {
+  fputc(ch, (FILE *)obj);
+  return 1;
+}
+
+#define LOG_FORMAT "%d.%03d dev=%s id=%d status=%08x t=%.2f\n"
+#define LOG_ARGS(i) \
+  (i) / 1000, (i) % 1000, names[(i) % 4], (i) * 7, (unsigned int)(i) * 40503u, \
+  ((i) % 1000) * 0.125 - 40.0
+
+static char const *names[] = {"pump", "valve", "sensor", "gateway"};
+
+/*
+ * Write n_records lines to fd (or path) in the given mode.  Returns the
+ * chars written, or -1 on an error.
+ */
+long run(int mode, int fd, char const *path, int n_records) {
+  long bytes = 0;
+  int i;
+
+  if (ftruncate(fd, 0) || lseek(fd, 0, SEEK_SET)) {
+    return -1;
+  }
+  if (mode < 2) {
+    FILE *f = fdopen(dup(fd), "w");
+    if (f == NULL) {
+      return -1;
+    }
+    for (i=0; i<n_records; i++) {
+      if (mode == 0) {
+        bytes += fprintf(f, LOG_FORMAT, LOG_ARGS(i));
+      } else {
+        bytes += mu_printf(fputc_emitter, f, LOG_FORMAT, LOG_ARGS(i));
+      }
+    }
+    return fclose(f) ? -1 : bytes;
+  }
+
+  if (mode == 4) {
+    mu_mmap_log_t log;
+    if (mu_mmap_log_open(&log, path, (size_t)n_records * 128, 64 << 20)) {
+      return -1;
+    }
+    for (i=0; i<n_records; i++) {
+      bytes += mu_mmap_log_printf(&log, LOG_FORMAT, LOG_ARGS(i));
+    }
+    return mu_mmap_log_close(&log) ? -1 : bytes;
+  }
+
+  mu_file_t file;
+  mu_sink_t *out = mu_file_init(&file, fd, s_mem, FILE_MEM_SIZE, mode == 3);
+  if (out == NULL) {
+    return -1;
+  }
+  for (i=0; i<n_records; i++) {
+    bytes += mu_printf(mu_sink_emitter, out, LOG_FORMAT, LOG_ARGS(i));
+  }
+  return mu_file_close(&file) ? -1 : bytes;
+}
+
+int main(int argc, char **argv) {
+  static char const *modes[] = {
+    "fprintf", "fputc", "mu_file", "mu_file -a", "mu_mmap"
+  };
+  int n_records = argc > 1 ? atoi(argv[1]) : 1000000;
+  char path[] = "/tmp/mu_file_bench.XXXXXX";
+  int fd = argc > 2 ? open(argv[2], O_RDWR | O_CREAT, 0644) : mkstemp(path);
+  int mode;
+
+  if (fd < 0) {
+    perror(argc > 2 ? argv[2] : path);
+    return 1;
+  }
+  printf("%d records\n", n_records);
+  printf("%-12s %10s %10s %8s\n", "mode", "seconds", "Mrec/s", "MB/s");
+  for (mode=0; mode<5; mode++) {
+    double t0 = now_seconds();
+    long bytes = run(mode, fd, argc > 2 ? argv[2] : path, n_records);
+    double seconds = now_seconds() - t0;
+    if (bytes < 0) {
+      perror(modes[mode]);
+      return 1;
+    }
+    printf("%-12s %10.3f %10.2f %8.1f\n",
+           modes[mode],
+           seconds,
+           n_records / seconds * 1e-6,
+           bytes / seconds * 1e-6);
+  }
+  close(fd);
+  if (argc <= 2) {
+    unlink(path);
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * mu_file_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -pthread -o mu_file_test mu_file_test.c mu_file.c mu_printf.c && ./mu_file_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_file.h"
+#include "mu_printf.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+// what was printed, to compare with what reached the file
+static char s_expected[200000];
+static int s_expected_length;
+static char s_actual[200000];
+
+int expected_emitter(void *obj, char ch) {
+  s_expected[s_expected_length++] = ch;
+  return 1;
+}
+
+// Compare the whole file with everything printed to it.
+bool check_file(FILE *f) {
+  rewind(f);
+  size_t n = fread(s_actual, 1, sizeof(s_actual), f);
+  return n == (size_t)s_expected_length &&
+         memcmp(s_actual, s_expected, n) == 0;
+}
+
+// Print the same lines to out and to the expected copy.
+void print_lines(mu_sink_t *out, int n) {
+  int i;
+  for (i=0; i<n; i++) {
+    mu_printf(mu_sink_emitter, out, "%d.%03d dev=%s t=%.2f\n",
+              i / 1000, i % 1000, i & 1 ? "pump" : "valve", i * 0.25);
+    mu_printf(expected_emitter, NULL, "%d.%03d dev=%s t=%.2f\n",
+              i / 1000, i % 1000, i & 1 ? "pump" : "valve", i * 0.25);
+  }
+}
+
+// ======================================================================
+// tests
+
+void mu_file_mode_test(bool async) {
+  PRINTF("...mu_file_mode_test(%s)\r\n", async ? "async" : "sync");
+  static char mem[1000];
+  FILE *f = tmpfile();
+  mu_file_t file;
+
+  s_expected_length = 0;
+  mu_sink_t *out = mu_file_init(&file, fileno(f), mem, sizeof(mem), async);
+  MU_TEST(out != NULL);
+
+  // nothing is written until a buffer fills, or on a flush
+  print_lines(out, 3);
+  MU_TEST(lseek(fileno(f), 0, SEEK_END) == 0);
+  MU_TEST(mu_file_flush(&file) == 0);
+  MU_TEST(check_file(f));
+  MU_TEST(mu_file_flush(&file) == 0);
+
+  // many buffers' worth, and a string longer than a buffer
+  print_lines(out, 5000);
+  static char long_string[1200];
+  memset(long_string, 'x', sizeof(long_string) - 1);
+  mu_printf(mu_sink_emitter, out, "%s|", long_string);
+  mu_printf(expected_emitter, NULL, "%s|", long_string);
+  MU_TEST(mu_file_close(&file) == 0);
+  MU_TEST(check_file(f));
+  fclose(f);
+}
+
+void mu_file_error_test() {
+  PRINTF("...mu_file_error_test\r\n");
+  static char mem[64];
+  mu_file_t file;
+
+  mu_sink_t *out = mu_file_init(&file, -1, mem, sizeof(mem), false);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s", "no such file") == 12);
+  MU_TEST(mu_file_close(&file) == -1);
+  MU_TEST(file.error == EBADF);
+}
+
+void mu_file_test() {
+  PRINTF("begin tests...\r\n");
+  mu_file_mode_test(false);
+  mu_file_mode_test(true);
+  mu_file_error_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_file_test();
+}
+
+#endif
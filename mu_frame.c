@@ -0,0 +1,115 @@
+/*
+ * mu_frame.c
+ *
+ * gcc -Wall -O2 -c mu_frame.c mu_crc.c mu_printf.c
+ */
+
+#include "mu_frame.h"
+
+// =============================================================================
+// forward declarations
+
+char *frame_reserve(mu_sink_t *sink, int *n);
+void frame_commit(mu_sink_t *sink, int n);
+void frame_end(mu_sink_t *sink);
+void frame_emit(mu_frame_t *frame, char const *buf, int n);
+
+static const mu_sink_vtable_t s_frame_vtable = {
+  frame_reserve,
+  frame_commit,
+  frame_end
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_frame_init(mu_frame_t *frame,
+                         char const *header,
+                         int header_length,
+                         mu_crc_fn crc_fn,
+                         emitter_t emitter_fn,
+                         void *obj) {
+  frame->sink.vtable = &s_frame_vtable;
+  frame->emitter_fn = emitter_fn;
+  frame->emitter_arg = obj;
+  frame->crc_fn = crc_fn ? crc_fn : mu_crc32_update;
+  frame->header = header;
+  frame->header_length = header_length;
+  frame->in_frame = false;
+  return &frame->sink;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *frame_reserve(mu_sink_t *sink, int *n) {
+  mu_frame_t *frame = (mu_frame_t *)sink;
+
+  if (!frame->in_frame) {
+    // the first output of a call starts the frame
+    frame->in_frame = true;
+    frame->crc = 0;
+    frame->length = 0;
+    frame_emit(frame, frame->header, frame->header_length);
+  }
+  if (*n > MU_FRAME_MAX_PAYLOAD - (int)frame->length) {
+    *n = MU_FRAME_MAX_PAYLOAD - frame->length;  // the frame is full
+  }
+  if (frame->emitter_fn == mu_sink_emitter) {
+    mu_sink_t *downstream = frame->emitter_arg;
+    frame->reserved = downstream->vtable->reserve(downstream, n);
+  } else {
+    if (*n > MU_FRAME_CHUNK_SIZE) {
+      *n = MU_FRAME_CHUNK_SIZE;
+    }
+    frame->reserved = frame->chunk;
+  }
+  return frame->reserved;
+}
+
+void frame_commit(mu_sink_t *sink, int n) {
+  mu_frame_t *frame = (mu_frame_t *)sink;
+
+  frame->crc = frame->crc_fn(frame->crc, frame->reserved, n);
+  frame->length += n;
+  if (frame->emitter_fn == mu_sink_emitter) {
+    mu_sink_t *downstream = frame->emitter_arg;
+    downstream->vtable->commit(downstream, n);
+  } else {
+    mu_emit_block(frame->emitter_fn, frame->emitter_arg, frame->chunk, n);
+  }
+}
+
+void frame_end(mu_sink_t *sink) {
+  mu_frame_t *frame = (mu_frame_t *)sink;
+  char trailer[MU_FRAME_TRAILER_SIZE];
+  uint32_t crc;
+
+  if (!frame->in_frame) {
+    return;  // the call printed nothing
+  }
+  trailer[0] = frame->length;
+  trailer[1] = frame->length >> 8;
+  crc = frame->crc_fn(frame->crc, trailer, 2);
+  trailer[2] = crc;
+  trailer[3] = crc >> 8;
+  trailer[4] = crc >> 16;
+  trailer[5] = crc >> 24;
+  mu_emit_block(frame->emitter_fn, frame->emitter_arg, trailer,
+                MU_FRAME_TRAILER_SIZE);
+  frame->in_frame = false;
+  if (frame->emitter_fn == mu_sink_emitter) {
+    mu_sink_t *downstream = frame->emitter_arg;
+    if (downstream->vtable->end) {
+      downstream->vtable->end(downstream);
+    }
+  }
+}
+
+/*
+ * Send n chars that are part of the frame but not of the payload.
+ */
+void frame_emit(mu_frame_t *frame, char const *buf, int n) {
+  frame->crc = frame->crc_fn(frame->crc, buf, n);
+  mu_emit_block(frame->emitter_fn, frame->emitter_arg, buf, n);
+}
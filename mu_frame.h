@@ -0,0 +1,76 @@
+/*
+ * mu_frame - wrap each mu_printf() call in a frame with a CRC
+ *
+ * A mu_frame_t is a sink (see mu_sink_t in mu_printf.h) that passes the
+ * output of each call on to another emitter as one frame:
+ *
+ *   header          the caller's header bytes (a sync word, a message type...)
+ *   payload         the formatted text
+ *   length          payload length, 2 bytes, least significant first: at
+ *                   most MU_FRAME_MAX_PAYLOAD (65535)
+ *   crc             CRC-32 of everything before it, 4 bytes, LSB first
+ *
+ * The CRC is updated on the payload as it is written, while the chars are
+ * still in cache, so the text is neither formatted into a buffer first nor
+ * read a second time.  When the downstream emitter is mu_sink_emitter, the
+ * payload is written straight into the downstream sink's memory.
+ *
+ * The length comes after the payload so that it need not be known in
+ * advance.  A receiver finds frame boundaries from the header and a byte
+ * stuffing layer below, such as COBS or SLIP.  A call that prints more than
+ * MU_FRAME_MAX_PAYLOAD chars has the rest dropped, as by a full sink, so its
+ * frame stays valid; mu_printf() still counts them.
+ *
+ *   static const char header[] = {0xa5, 0x01};
+ *   mu_frame_t frame;
+ *   mu_sink_t *out = mu_frame_init(&frame, header, sizeof(header), NULL,
+ *                                  uart_emitter, NULL);
+ *   mu_printf(mu_sink_emitter, out, "t=%d", t);  // one frame
+ */
+
+#ifndef SOURCE_MU_FRAME_H_
+#define SOURCE_MU_FRAME_H_
+
+#include "mu_crc.h"
+#include "mu_printf.h"
+
+// chars staged at a time when the downstream emitter is not a sink
+#ifndef MU_FRAME_CHUNK_SIZE
+#define MU_FRAME_CHUNK_SIZE 32
+#endif
+
+#define MU_FRAME_TRAILER_SIZE 6  // length and crc
+#define MU_FRAME_MAX_PAYLOAD 0xffff  // what the length field can hold
+
+typedef struct {
+  mu_sink_t sink;           // must come first
+  emitter_t emitter_fn;     // where frames go
+  void *emitter_arg;        // user-supplied argument to emitter_fn
+  mu_crc_fn crc_fn;         // mu_crc32_update() or a hardware equivalent
+  char const *header;       // sent at the start of every frame
+  int header_length;
+  bool in_frame;            // a frame has been started
+  char *reserved;           // where the current reservation points
+  uint32_t crc;             // CRC of the frame so far
+  uint32_t length;          // payload chars so far
+  char chunk[MU_FRAME_CHUNK_SIZE];
+} mu_frame_t;
+
+/*!
+ * @brief Set up frame to send each call's output as a frame to emitter_fn.
+ *
+ * @param frame The sink.
+ * @param header, header_length Bytes that start every frame.
+ * @param crc_fn The CRC routine, or NULL for mu_crc32_update().
+ * @param emitter_fn Where frames go.
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_frame_init(mu_frame_t *frame,
+                         char const *header,
+                         int header_length,
+                         mu_crc_fn crc_fn,
+                         emitter_t emitter_fn,
+                         void *obj);
+
+#endif /* SOURCE_MU_FRAME_H_ */
@@ -0,0 +1,162 @@
+/*
+ * mu_frame_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_frame_test mu_frame_test.c mu_frame.c mu_crc.c mu_sink.c mu_printf.c && ./mu_frame_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_frame.h"
+#include "mu_printf.h"
+#include "mu_sink.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf)) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+static const char s_header[] = {(char)0xa5, 0x01};
+
+/*
+ * Check that buf holds exactly one frame with the given payload, and that its
+ * length and CRC fields are right.
+ */
+bool check_frame(char const *buf, int n, const char *payload) {
+  int payload_length = strlen(payload);
+  int body = sizeof(s_header) + payload_length;
+  uint8_t const *trailer = (uint8_t const *)&buf[body];
+  uint32_t crc = mu_crc32_update(0, buf, body + 2);
+
+  return n == body + MU_FRAME_TRAILER_SIZE &&
+         memcmp(buf, s_header, sizeof(s_header)) == 0 &&
+         memcmp(&buf[sizeof(s_header)], payload, payload_length) == 0 &&
+         trailer[0] == (payload_length & 0xff) &&
+         trailer[1] == (payload_length >> 8) &&
+         trailer[2] == (crc & 0xff) &&
+         trailer[3] == ((crc >> 8) & 0xff) &&
+         trailer[4] == ((crc >> 16) & 0xff) &&
+         trailer[5] == (crc >> 24);
+}
+
+bool check_test_emitter(const char *payload) {
+  bool match = check_frame(test_buf, test_index, payload);
+  test_index = 0;
+  return match;
+}
+
+// counts calls, to show that a hook can take the CRC's place
+int s_crc_calls;
+
+uint32_t counting_crc(uint32_t crc, void const *buf, int n) {
+  s_crc_calls += 1;
+  return mu_crc32_update(crc, buf, n);
+}
+
+// ======================================================================
+// tests
+
+void mu_frame_emitter_test() {
+  PRINTF("...mu_frame_emitter_test\r\n");
+  mu_frame_t frame;
+  mu_sink_t *out = mu_frame_init(&frame, s_header, sizeof(s_header), NULL,
+                                 test_emitter, NULL);
+
+  MU_TEST(mu_printf(mu_sink_emitter, out, "t=%d v=%.2f", -12, 3.14159) == 12);
+  MU_TEST(check_test_emitter("t=-12 v=3.14"));
+
+  // a payload longer than the staging chunk
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s%s%5x",
+                    "0123456789abcdefghij", "klmnopqrstuvwxyz", 255) == 41);
+  MU_TEST(check_test_emitter("0123456789abcdefghijklmnopqrstuvwxyz   ff"));
+
+  // a call with no output sends no frame
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s", "") == 0);
+  MU_TEST(test_index == 0);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "") == 0);
+  MU_TEST(test_index == 0);
+}
+
+void mu_frame_sink_test() {
+  PRINTF("...mu_frame_sink_test\r\n");
+  char buf[128];
+  mu_buffer_sink_t downstream;
+  mu_frame_t frame;
+  mu_sink_t *out = mu_frame_init(&frame, s_header, sizeof(s_header),
+                                 counting_crc, mu_sink_emitter,
+                                 mu_buffer_sink_init(&downstream, buf,
+                                                     sizeof(buf)));
+
+  // the payload is written into the downstream sink's memory
+  s_crc_calls = 0;
+  MU_TEST(mu_printf(mu_sink_emitter, out, "id=%d name=%s", 7, "pump") == 14);
+  MU_TEST(check_frame(buf, downstream.length, "id=7 name=pump"));
+  MU_TEST(s_crc_calls > 0);
+  mu_buffer_sink_reset(&downstream);
+
+  // frames follow each other
+  mu_printf(mu_sink_emitter, out, "a");
+  mu_printf(mu_sink_emitter, out, "bc");
+  MU_TEST(check_frame(buf, 9, "a"));
+  MU_TEST(check_frame(&buf[9], downstream.length - 9, "bc"));
+}
+
+void mu_frame_long_test() {
+  PRINTF("...mu_frame_long_test\r\n");
+  static char text[MU_FRAME_MAX_PAYLOAD + 100];
+  static char buf[MU_FRAME_MAX_PAYLOAD + 100];
+  mu_buffer_sink_t downstream;
+  mu_frame_t frame;
+  mu_sink_t *out = mu_frame_init(&frame, s_header, sizeof(s_header), NULL,
+                                 mu_sink_emitter,
+                                 mu_buffer_sink_init(&downstream, buf,
+                                                     sizeof(buf)));
+
+  // the length field has 16 bits: a longer call is cut to a valid frame
+  memset(text, 'x', sizeof(text) - 1);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s", text) ==
+          (int)sizeof(text) - 1);
+  text[MU_FRAME_MAX_PAYLOAD] = '\0';
+  MU_TEST(check_frame(buf, downstream.length, text));
+
+  // and the next call starts a new frame
+  mu_buffer_sink_reset(&downstream);
+  mu_printf(mu_sink_emitter, out, "ok");
+  MU_TEST(check_frame(buf, downstream.length, "ok"));
+}
+
+void mu_frame_test() {
+  PRINTF("begin tests...\r\n");
+  mu_frame_emitter_test();
+  mu_frame_sink_test();
+  mu_frame_long_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_frame_test();
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * mu_lzss.c
+ *
+ * gcc -Wall -O2 -c mu_lzss.c mu_printf.c
+ */
+
+#include "mu_lzss.h"
+
+#define NO_POSITION 0xffff
+
+// =============================================================================
+// forward declarations
+
+char *lzss_reserve(mu_sink_t *sink, int *n);
+void lzss_commit(mu_sink_t *sink, int n);
+void lzss_encode(mu_lzss_t *lzss, int end);
+void lzss_slide(mu_lzss_t *lzss);
+unsigned int lzss_hash(char const *p);
+void lzss_item(mu_lzss_t *lzss, bool is_match, int a, int b);
+int lzss_send_group(mu_lzss_t *lzss);
+
+static const mu_sink_vtable_t s_lzss_vtable = {
+  lzss_reserve,
+  lzss_commit,
+  (void *)0  // history carries over: see mu_lzss_flush()
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_lzss_init(mu_lzss_t *lzss, emitter_t emitter_fn, void *obj) {
+  int i;
+
+  lzss->sink.vtable = &s_lzss_vtable;
+  lzss->emitter_fn = emitter_fn;
+  lzss->emitter_arg = obj;
+  lzss->length = 0;
+  lzss->position = 0;
+  lzss->group_length = 1;
+  lzss->n_items = 0;
+  lzss->group[0] = 0;
+  lzss->bytes_in = 0;
+  lzss->bytes_out = 0;
+  for (i=0; i<(1 << MU_LZSS_HASH_BITS); i++) {
+    lzss->recent[i] = NO_POSITION;
+  }
+  return &lzss->sink;
+}
+
+int mu_lzss_flush(mu_lzss_t *lzss) {
+  uint32_t before = lzss->bytes_out;
+
+  lzss_encode(lzss, lzss->length);
+  if (lzss->n_items > 0) {
+    lzss_item(lzss, true, 0, 0);  // ends the group
+    if (lzss->n_items > 0) {
+      lzss_send_group(lzss);  // not already sent as the eighth item
+    }
+  }
+  if (lzss->emitter_fn == mu_sink_emitter) {
+    mu_sink_t *downstream = lzss->emitter_arg;
+    if (downstream->vtable->end) {
+      downstream->vtable->end(downstream);
+    }
+  }
+  return lzss->bytes_out - before;
+}
+
+int mu_lzss_decode(char const *src, int n, char *dst, int size) {
+  uint8_t const *p = (uint8_t const *)src;
+  uint8_t const *end = p + n;
+  int length = 0;
+
+  while (p < end) {
+    int flags = *p++;
+    int item;
+    for (item=0; item<8 && p<end; item++) {
+      if ((flags & (1 << item)) == 0) {
+        if (length == size) {
+          return -1;
+        }
+        dst[length++] = *p++;
+        continue;
+      }
+      if (end - p < 2) {
+        return -1;
+      }
+      int offset = p[0] | (p[1] >> 4) << 8;
+      int count = (p[1] & 0xf) + MU_LZSS_MIN_MATCH;
+      p += 2;
+      if (offset == 0) {
+        break;  // the group ends here
+      }
+      if (offset > length || count > size - length) {
+        return -1;
+      }
+      // byte by byte: the source may overlap what is being written
+      while (count-- > 0) {
+        dst[length] = dst[length - offset];
+        length++;
+      }
+    }
+  }
+  return length;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *lzss_reserve(mu_sink_t *sink, int *n) {
+  mu_lzss_t *lzss = (mu_lzss_t *)sink;
+  int room;
+
+  if (lzss->length == MU_LZSS_BUFFER_SIZE) {
+    lzss_slide(lzss);
+  }
+  room = MU_LZSS_BUFFER_SIZE - lzss->length;
+  if (*n > room) {
+    *n = room;
+  }
+  return &lzss->buf[lzss->length];
+}
+
+void lzss_commit(mu_sink_t *sink, int n) {
+  mu_lzss_t *lzss = (mu_lzss_t *)sink;
+
+  lzss->length += n;
+  lzss->bytes_in += n;
+  // encode what has a full match's worth of lookahead behind it
+  lzss_encode(lzss, lzss->length - MU_LZSS_MAX_MATCH + 1);
+}
+
+/*
+ * Encode the chars from position up to (at least) end.
+ */
+void lzss_encode(mu_lzss_t *lzss, int end) {
+  char const *buf = lzss->buf;
+
+  while (lzss->position < end) {
+    int position = lzss->position;
+    int available = lzss->length - position;
+    int best = 0;
+    int candidate = NO_POSITION;
+
+    if (available >= MU_LZSS_MIN_MATCH) {
+      uint16_t *slot = &lzss->recent[lzss_hash(&buf[position])];
+      candidate = *slot;
+      *slot = position;
+    }
+    if (candidate != NO_POSITION && position - candidate < MU_LZSS_WINDOW) {
+      int limit = available < MU_LZSS_MAX_MATCH ? available
+                                                : MU_LZSS_MAX_MATCH;
+      while (best < limit && buf[candidate + best] == buf[position + best]) {
+        best++;
+      }
+    }
+    if (best < MU_LZSS_MIN_MATCH) {
+      lzss_item(lzss, false, buf[position], 0);
+      lzss->position = position + 1;
+      continue;
+    }
+    lzss_item(lzss, true, position - candidate, best);
+    lzss->position = position + best;
+    // index the positions the match covers, so later text can match them
+    while (++position < lzss->position &&
+           position + MU_LZSS_MIN_MATCH <= lzss->length) {
+      lzss->recent[lzss_hash(&buf[position])] = position;
+    }
+  }
+}
+
+/*
+ * Drop the oldest MU_LZSS_WINDOW chars from the buffer.  Everything that is
+ * kept is encoded but the last MU_LZSS_MAX_MATCH chars or so, and a full
+ * window of history remains behind them.
+ */
+void lzss_slide(mu_lzss_t *lzss) {
+  int i;
+
+  __builtin_memmove(lzss->buf, &lzss->buf[MU_LZSS_WINDOW],
+                    lzss->length - MU_LZSS_WINDOW);
+  lzss->length -= MU_LZSS_WINDOW;
+  lzss->position -= MU_LZSS_WINDOW;
+  for (i=0; i<(1 << MU_LZSS_HASH_BITS); i++) {
+    int recent = lzss->recent[i];
+    if (recent != NO_POSITION) {
+      lzss->recent[i] = recent >= MU_LZSS_WINDOW ? recent - MU_LZSS_WINDOW
+                                                 : NO_POSITION;
+    }
+  }
+}
+
+// Multiplicative hash of the 3 chars at p.
+unsigned int lzss_hash(char const *p) {
+  uint32_t key = (uint8_t)p[0] << 16 | (uint8_t)p[1] << 8 | (uint8_t)p[2];
+  return (key * 2654435761u) >> (32 - MU_LZSS_HASH_BITS);
+}
+
+/*
+ * Add a literal char a, or a match of offset a and length b, to the group,
+ * and send the group when it is full.
+ */
+void lzss_item(mu_lzss_t *lzss, bool is_match, int a, int b) {
+  char *group = lzss->group;
+
+  if (is_match) {
+    group[0] |= 1 << lzss->n_items;
+    group[lzss->group_length++] = a;
+    group[lzss->group_length++] = (a >> 8) << 4 |
+                                  (b ? b - MU_LZSS_MIN_MATCH : 0);
+  } else {
+    group[lzss->group_length++] = a;
+  }
+  if (++lzss->n_items == 8) {
+    lzss_send_group(lzss);
+  }
+}
+
+int lzss_send_group(mu_lzss_t *lzss) {
+  int n = lzss->group_length;
+
+  mu_emit_block(lzss->emitter_fn, lzss->emitter_arg, lzss->group, n);
+  lzss->bytes_out += n;
+  lzss->group[0] = 0;
+  lzss->group_length = 1;
+  lzss->n_items = 0;
+  return n;
+}
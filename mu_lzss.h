@@ -0,0 +1,103 @@
+/*
+ * mu_lzss - compress output on the fly
+ *
+ * Log text repeats itself: the same formats, the same field names, values
+ * that change in their last digits.  A mu_lzss_t is a sink (see mu_sink_t in
+ * mu_printf.h) that compresses its output with LZSS and passes the
+ * compressed bytes on to another emitter, such as a flash log or a link.
+ * It uses a fixed amount of RAM, all of it inside the mu_lzss_t: about
+ * 2 * MU_LZSS_WINDOW plus 2 << MU_LZSS_HASH_BITS bytes.
+ *
+ * The formatter writes into the window buffer, and each string that
+ * occurred in the last MU_LZSS_WINDOW chars is replaced by its distance and
+ * length.  Candidates are found by hashing 3 chars into a table of recent
+ * positions, with one probe per position, so the cost per char is small and
+ * bounded.
+ *
+ * History carries over from one mu_printf() call to the next, which is where
+ * short log lines find their matches, so compressed bytes go downstream in
+ * groups as they are ready rather than at the end of each call.  Call
+ * mu_lzss_flush() when everything written so far must be decodable, e.g.
+ * before a flash page is closed or the device sleeps.
+ *
+ * The stream is a series of groups.  A group is a flag byte followed by up
+ * to eight items, flag bit 0 (the LSB) describing the first: 0 is a literal
+ * char, 1 a match of two bytes,
+ *
+ *   offset & 0xff, (offset >> 8) << 4 | (length - MU_LZSS_MIN_MATCH)
+ *
+ * that copies length chars starting offset chars back.  A match with an
+ * offset of 0 ends its group early; mu_lzss_flush() uses it.
+ * mu_lzss_decode() reverses all this.
+ *
+ *   static mu_lzss_t lzss;
+ *   mu_sink_t *out = mu_lzss_init(&lzss, flash_emitter, NULL);
+ *   mu_printf(mu_sink_emitter, out, "t=%d\n", t);
+ *   ...
+ *   mu_lzss_flush(&lzss);
+ */
+
+#ifndef SOURCE_MU_LZSS_H_
+#define SOURCE_MU_LZSS_H_
+
+#include "mu_printf.h"
+
+// log2 of the window: how far back matches are found (at most 12)
+#ifndef MU_LZSS_WINDOW_BITS
+#define MU_LZSS_WINDOW_BITS 10
+#endif
+
+// log2 of the number of entries in the table of recent positions
+#ifndef MU_LZSS_HASH_BITS
+#define MU_LZSS_HASH_BITS 9
+#endif
+
+#if MU_LZSS_WINDOW_BITS > 12
+#error "MU_LZSS_WINDOW_BITS must be at most 12"
+#endif
+
+#define MU_LZSS_WINDOW (1 << MU_LZSS_WINDOW_BITS)
+#define MU_LZSS_MIN_MATCH 3
+#define MU_LZSS_MAX_MATCH 18
+#define MU_LZSS_BUFFER_SIZE (2 * MU_LZSS_WINDOW + MU_LZSS_MAX_MATCH)
+
+typedef struct {
+  mu_sink_t sink;        // must come first
+  emitter_t emitter_fn;  // where compressed bytes go
+  void *emitter_arg;     // user-supplied argument to emitter_fn
+  int length;            // chars in buf
+  int position;          // first char in buf not yet encoded
+  int group_length;      // bytes in group, flag byte included
+  int n_items;           // items in group
+  uint32_t bytes_in;     // chars compressed
+  uint32_t bytes_out;    // compressed bytes sent
+  uint16_t recent[1 << MU_LZSS_HASH_BITS];  // last position of each hash
+  char group[1 + 8 * 2];
+  char buf[MU_LZSS_BUFFER_SIZE];            // history, then new chars
+} mu_lzss_t;
+
+/*!
+ * @brief Set up lzss, with empty history, to compress output for
+ * emitter_fn.
+ *
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_lzss_init(mu_lzss_t *lzss, emitter_t emitter_fn, void *obj);
+
+/*!
+ * @brief Compress and send everything written so far.  History is kept, so
+ * compression goes on as before.
+ *
+ * @return Number of compressed bytes sent.
+ */
+int mu_lzss_flush(mu_lzss_t *lzss);
+
+/*!
+ * @brief Decompress the n bytes at src into dst.
+ *
+ * @return The number of chars decompressed, or -1 if src is not a valid
+ * stream or does not fit in size chars.
+ */
+int mu_lzss_decode(char const *src, int n, char *dst, int size);
+
+#endif /* SOURCE_MU_LZSS_H_ */
@@ -0,0 +1,208 @@
+/*
+ * mu_lzss_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_lzss_test mu_lzss_test.c mu_lzss.c mu_sink.c mu_printf.c && ./mu_lzss_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_lzss.h"
+#include "mu_printf.h"
+#include "mu_sink.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+// what went in, what came out, and what it decodes to
+static char s_plain[65536];
+static int s_plain_length;
+static char s_packed[65536];
+static char s_unpacked[65536];
+
+int plain_emitter(void *obj, char ch) {
+  s_plain[s_plain_length++] = ch;
+  return 1;
+}
+
+bool check_round_trip(mu_buffer_sink_t *packed) {
+  int n = mu_lzss_decode(packed->buf, packed->length, s_unpacked,
+                         sizeof(s_unpacked));
+  return n == s_plain_length && memcmp(s_unpacked, s_plain, n) == 0;
+}
+
+// Print a log line to both the compressor and the plain copy.
+void log_line(mu_sink_t *out, unsigned int r, unsigned int t) {
+  static char const *modules[] = {"adc", "radio", "power", "fs", "sched"};
+
+  switch(r % 4) {
+  case 0:
+    mu_printf(mu_sink_emitter, out, "[%d] %s: temp=%.2f C\n",
+              t, modules[r % 5], (int)(r % 6000) / 100.0 - 20.0);
+    mu_printf(plain_emitter, NULL, "[%d] %s: temp=%.2f C\n",
+              t, modules[r % 5], (int)(r % 6000) / 100.0 - 20.0);
+    break;
+  case 1:
+    mu_printf(mu_sink_emitter, out, "reg %08x = %08x\n",
+              0x40000000 + (r % 256) * 4, r * 2654435761u);
+    mu_printf(plain_emitter, NULL, "reg %08x = %08x\n",
+              0x40000000 + (r % 256) * 4, r * 2654435761u);
+    break;
+  case 2:
+    mu_printf(mu_sink_emitter, out, "heap free=%d min=%d\n",
+              r % 65536, r % 16384);
+    mu_printf(plain_emitter, NULL, "heap free=%d min=%d\n",
+              r % 65536, r % 16384);
+    break;
+  default:
+    mu_printf(mu_sink_emitter, out, "watchdog kicked\n");
+    mu_printf(plain_emitter, NULL, "watchdog kicked\n");
+    break;
+  }
+}
+
+// ======================================================================
+// tests
+
+void mu_lzss_round_trip_test() {
+  PRINTF("...mu_lzss_round_trip_test\r\n");
+  static mu_lzss_t lzss;
+  mu_buffer_sink_t packed;
+  unsigned int seed = 1;
+  unsigned int t = 1000;
+  int i;
+
+  mu_sink_t *out = mu_lzss_init(&lzss, mu_sink_emitter,
+                                mu_buffer_sink_init(&packed, s_packed,
+                                                    sizeof(s_packed)));
+  s_plain_length = 0;
+  MU_TEST(mu_lzss_flush(&lzss) == 0);
+
+  // many windows' worth of log, so that the buffer slides
+  for (i=0; i<2000; i++) {
+    seed = seed * 1103515245 + 12345;
+    t += (seed >> 8) % 50;
+    log_line(out, seed >> 8, t);
+  }
+  MU_TEST(mu_lzss_flush(&lzss) > 0);
+  MU_TEST(lzss.bytes_in == (uint32_t)s_plain_length);
+  MU_TEST(lzss.bytes_out == (uint32_t)packed.length);
+  MU_TEST(check_round_trip(&packed));
+  // log text compresses well, even with a small window
+  MU_TEST(packed.length * 3 < s_plain_length * 2);
+
+  // after a flush, compression goes on
+  mu_printf(mu_sink_emitter, out, "watchdog kicked\n");
+  mu_printf(plain_emitter, NULL, "watchdog kicked\n");
+  MU_TEST(mu_lzss_flush(&lzss) <= 6);
+  MU_TEST(check_round_trip(&packed));
+}
+
+void mu_lzss_literal_test() {
+  PRINTF("...mu_lzss_literal_test\r\n");
+  static mu_lzss_t lzss;
+  static char data[3000];
+  mu_buffer_sink_t packed;
+  unsigned int seed = 7;
+  int i;
+
+  mu_sink_t *out = mu_lzss_init(&lzss, mu_sink_emitter,
+                                mu_buffer_sink_init(&packed, s_packed,
+                                                    sizeof(s_packed)));
+  // text without repeats (all byte values) costs one bit in eight extra
+  for (i=0; i<(int)sizeof(data); i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = seed >> 16;
+  }
+  mu_emit_block(mu_sink_emitter, out, data, sizeof(data));
+  memcpy(s_plain, data, sizeof(data));
+  s_plain_length = sizeof(data);
+  mu_lzss_flush(&lzss);
+  MU_TEST(packed.length <= (int)sizeof(data) * 9 / 8 + 4);
+  MU_TEST(check_round_trip(&packed));
+
+  // runs become overlapping matches
+  mu_buffer_sink_reset(&packed);
+  out = mu_lzss_init(&lzss, mu_sink_emitter, &packed.sink);
+  mu_printf(mu_sink_emitter, out, "%40s|", "");
+  s_plain_length = 0;
+  mu_printf(plain_emitter, NULL, "%40s|", "");
+  mu_lzss_flush(&lzss);
+  MU_TEST(packed.length < 12);
+  MU_TEST(check_round_trip(&packed));
+}
+
+void mu_lzss_flush_test() {
+  PRINTF("...mu_lzss_flush_test\r\n");
+  static mu_lzss_t lzss;
+  mu_buffer_sink_t packed;
+  int pending;
+  int expected;
+
+  // a flush sends each group once, however many items it holds
+  for (pending=0; pending<=8; pending++) {
+    mu_sink_t *out = mu_lzss_init(&lzss, mu_sink_emitter,
+                                  mu_buffer_sink_init(&packed, s_packed,
+                                                      sizeof(s_packed)));
+    s_plain_length = 0;
+    mu_emit_block(mu_sink_emitter, out, "abcdefgh", pending);
+    mu_emit_block(plain_emitter, NULL, "abcdefgh", pending);
+    // flags, literals and an end marker, which a full group goes without
+    expected = pending == 0 ? 0 : pending < 8 ? 1 + pending + 2 : 1 + pending;
+    MU_TEST(mu_lzss_flush(&lzss) == expected);
+    mu_printf(mu_sink_emitter, out, "XYZ");
+    mu_printf(plain_emitter, NULL, "XYZ");
+    mu_lzss_flush(&lzss);
+    MU_TEST(lzss.bytes_out == (uint32_t)packed.length);
+    MU_TEST(check_round_trip(&packed));
+  }
+}
+
+void mu_lzss_decode_test() {
+  PRINTF("...mu_lzss_decode_test\r\n");
+  char out[8];
+
+  MU_TEST(mu_lzss_decode("", 0, out, sizeof(out)) == 0);
+  MU_TEST(mu_lzss_decode("\x00" "abc", 4, out, sizeof(out)) == 3);
+  MU_TEST(memcmp(out, "abc", 3) == 0);
+  // "ab" then 4 chars from 2 back
+  MU_TEST(mu_lzss_decode("\x04" "ab\x02\x01", 5, out, sizeof(out)) == 6);
+  MU_TEST(memcmp(out, "ababab", 6) == 0);
+  // a group ended early, then another
+  MU_TEST(mu_lzss_decode("\x02" "a\x00\x00\x00" "b", 6, out, sizeof(out)) == 2);
+  MU_TEST(memcmp(out, "ab", 2) == 0);
+
+  // a match reaching before the start, a cut-off match, too little room
+  MU_TEST(mu_lzss_decode("\x02" "a\x02\x00", 4, out, sizeof(out)) == -1);
+  MU_TEST(mu_lzss_decode("\x02" "a\x01", 3, out, sizeof(out)) == -1);
+  MU_TEST(mu_lzss_decode("\x02" "a\x01\x0f", 4, out, sizeof(out)) == -1);
+}
+
+void mu_lzss_test() {
+  PRINTF("begin tests...\r\n");
+  mu_lzss_round_trip_test();
+  mu_lzss_literal_test();
+  mu_lzss_flush_test();
+  mu_lzss_decode_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_lzss_test();
+}
+
+#endif
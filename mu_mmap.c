@@ -0,0 +1,163 @@
+/*
+ * mu_mmap.c
+ *
+ * gcc -Wall -O2 -pthread -c mu_mmap.c mu_sink.c mu_printf.c
+ */
+
+#include "mu_mmap.h"
+#include "mu_sink.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// =============================================================================
+// forward declarations
+
+bool mmap_log_grow(mu_mmap_log_t *log, size_t end);
+void mmap_log_full_at(mu_mmap_log_t *log, size_t start);
+
+// =============================================================================
+// Code
+
+int mu_mmap_log_open(mu_mmap_log_t *log,
+                     char const *path,
+                     size_t max_size,
+                     size_t grow_size) {
+  size_t page_size = sysconf(_SC_PAGESIZE);
+
+  log->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (log->fd < 0) {
+    return -1;
+  }
+  // Map it all now, so the mapping never moves under a writer.  Pages past
+  // the end of the file are not touched until the file has grown over them.
+  log->base = mmap((void *)0, max_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   log->fd, 0);
+  if (log->base == MAP_FAILED) {
+    close(log->fd);
+    return -1;
+  }
+  log->max_size = max_size;
+  log->grow_size = (grow_size + page_size - 1) / page_size * page_size;
+  log->offset = 0;
+  log->file_size = 0;
+  log->full_at = max_size;
+  log->dropped = 0;
+  pthread_mutex_init(&log->grow_lock, NULL);
+  return 0;
+}
+
+char *mu_mmap_log_reserve(mu_mmap_log_t *log, int n) {
+  size_t start = __atomic_fetch_add(&log->offset, n, __ATOMIC_RELAXED);
+  size_t end = start + n;
+
+  if (end > __atomic_load_n(&log->file_size, __ATOMIC_ACQUIRE) &&
+      !mmap_log_grow(log, end)) {
+    __atomic_fetch_add(&log->dropped, n, __ATOMIC_RELAXED);
+    mmap_log_full_at(log, start);
+    return (void *)0;
+  }
+  return &log->base[start];
+}
+
+int mu_mmap_log_printf(mu_mmap_log_t *log, const char *fmt, ...) {
+  va_list ap;
+  int n_emitted;
+
+  va_start(ap, fmt);
+  n_emitted = mu_mmap_log_vprintf(log, fmt, ap);
+  va_end(ap);
+  return n_emitted;
+}
+
+int mu_mmap_log_vprintf(mu_mmap_log_t *log, const char *fmt, va_list arg) {
+  char staging[MU_MMAP_STAGING_SIZE];
+  mu_buffer_sink_t sink;
+  va_list again;
+  char *buf;
+  int n;
+
+  // Most messages are short: format into the stack, where it is cheapest,
+  // and learn the length as a side effect.  A sink that is full still
+  // counts what it drops, so a longer message is formatted a second time
+  // straight into the log.
+  va_copy(again, arg);
+  n = mu_vprintf(mu_sink_emitter,
+                 mu_buffer_sink_init(&sink, staging, sizeof(staging)),
+                 fmt, arg);
+  buf = mu_mmap_log_reserve(log, n);
+  if (buf != (void *)0) {
+    if (n <= (int)sizeof(staging)) {
+      __builtin_memcpy(buf, staging, n);
+    } else {
+      mu_vprintf(mu_sink_emitter, mu_buffer_sink_init(&sink, buf, n), fmt,
+                 again);
+    }
+  }
+  va_end(again);
+  return n;
+}
+
+int mu_mmap_log_sync(mu_mmap_log_t *log) {
+  size_t length = __atomic_load_n(&log->offset, __ATOMIC_RELAXED);
+  size_t file_size = __atomic_load_n(&log->file_size, __ATOMIC_ACQUIRE);
+
+  return msync(log->base, length < file_size ? length : file_size, MS_ASYNC);
+}
+
+int mu_mmap_log_close(mu_mmap_log_t *log) {
+  size_t length = log->offset < log->full_at ? log->offset : log->full_at;
+  int result = 0;
+
+  if (munmap(log->base, log->max_size) || ftruncate(log->fd, length)) {
+    result = -1;
+  }
+  if (close(log->fd)) {
+    result = -1;
+  }
+  pthread_mutex_destroy(&log->grow_lock);
+  return result;
+}
+
+// =============================================================================
+// =============================================================================
+
+/*
+ * Grow the file to cover the first end bytes, if the mapping reaches that
+ * far.  Several writers may get here at once; the first grows the file far
+ * enough for the others.  Returns false if the bytes cannot be had.
+ */
+bool mmap_log_grow(mu_mmap_log_t *log, size_t end) {
+  bool ok = true;
+
+  if (end > log->max_size) {
+    return false;
+  }
+  pthread_mutex_lock(&log->grow_lock);
+  if (end > log->file_size) {
+    size_t size = (end + log->grow_size - 1) / log->grow_size * log->grow_size;
+    if (size > log->max_size) {
+      size = log->max_size;
+    }
+    if (ftruncate(log->fd, size) == 0) {
+      __atomic_store_n(&log->file_size, size, __ATOMIC_RELEASE);
+    } else {
+      ok = false;
+    }
+  }
+  pthread_mutex_unlock(&log->grow_lock);
+  return ok;
+}
+
+/*
+ * Note that a reservation starting at start failed.  Every later one fails
+ * too, so the log ends at the earliest such start.
+ */
+void mmap_log_full_at(mu_mmap_log_t *log, size_t start) {
+  size_t full_at = __atomic_load_n(&log->full_at, __ATOMIC_RELAXED);
+
+  while (start < full_at &&
+         !__atomic_compare_exchange_n(&log->full_at, &full_at, start, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
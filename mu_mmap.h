@@ -0,0 +1,108 @@
+/*
+ * mu_mmap - a log file that threads append to without system calls
+ *
+ * Host only (POSIX, 64 bit).  A mu_mmap_log_t maps a log file into memory
+ * and appends each message to the mapping.  Appending takes no lock and
+ * makes no system call:
+ *
+ *   - the message is formatted into MU_MMAP_STAGING_SIZE chars on the
+ *     stack, which also gives its exact length;
+ *   - an atomic add on the shared offset reserves that many bytes, so
+ *     threads never write over each other and messages never interleave;
+ *   - the message is copied into the reserved bytes.  One that did not fit
+ *     on the stack is formatted again, straight into them.
+ *
+ * (Formatting straight into the log after mu_vmeasure() avoids the copy,
+ * but measuring costs nearly as much as formatting, and the copy of a short
+ * message that is still in L1 costs far less.)
+ *
+ * The whole of max_size is mapped when the log is opened, so the mapping
+ * never moves; the file itself grows in steps of grow_size, with
+ * ftruncate(), whenever a reservation crosses its end.  That is the only
+ * time a lock is taken.  Writing to the mapping makes pages dirty and the
+ * kernel writes them back in its own time; mu_mmap_log_sync() asks for that
+ * now, and may be called periodically if wanted.
+ *
+ *   mu_mmap_log_t log;
+ *   mu_mmap_log_open(&log, "capture.log", 1L << 34, 64 << 20);
+ *   // from any thread
+ *   mu_mmap_log_printf(&log, "%d.%03d dev=%s\n", s, ms, name);
+ *   ...
+ *   mu_mmap_log_close(&log);   // trims the file to what was written
+ */
+
+#ifndef SOURCE_MU_MMAP_H_
+#define SOURCE_MU_MMAP_H_
+
+#include "mu_printf.h"
+#include <pthread.h>
+#include <stddef.h>
+
+// chars of a message formatted on the stack before it is copied to the log
+#ifndef MU_MMAP_STAGING_SIZE
+#define MU_MMAP_STAGING_SIZE 256
+#endif
+
+typedef struct {
+  int fd;                    // the log file
+  char *base;                // the mapping, max_size bytes
+  size_t max_size;           // most bytes the log can hold
+  size_t grow_size;          // how much the file grows at a time
+  size_t offset;             // next free byte; updated atomically
+  size_t file_size;          // current file size; read atomically
+  size_t full_at;            // where the log filled up; updated atomically
+  size_t dropped;            // bytes that did not fit; updated atomically
+  pthread_mutex_t grow_lock; // held while the file grows
+} mu_mmap_log_t;
+
+/*!
+ * @brief Create (or truncate) the file at path and map it for logging.
+ *
+ * @param log The log.
+ * @param path Where the log goes.
+ * @param max_size Most bytes the log can hold: address space to reserve.
+ * @param grow_size Bytes the file grows by when it fills (rounded up to
+ *        whole pages).
+ * @return 0, or -1 with errno set.
+ */
+int mu_mmap_log_open(mu_mmap_log_t *log,
+                     char const *path,
+                     size_t max_size,
+                     size_t grow_size);
+
+/*!
+ * @brief Reserve n bytes at the end of the log.  Thread safe.
+ *
+ * @return Where the bytes go, or NULL if the log is full or could not grow.
+ */
+char *mu_mmap_log_reserve(mu_mmap_log_t *log, int n);
+
+/*!
+ * @brief Append a formatted message to the log.  Thread safe.
+ *
+ * @return Number of chars in the message.  A message that does not fit is
+ * dropped, and counted in log->dropped.
+ */
+int mu_mmap_log_printf(mu_mmap_log_t *log, const char *fmt, ...);
+
+/*!
+ * @brief Identical to mu_mmap_log_printf(), but with pre-parsed arg list.
+ */
+int mu_mmap_log_vprintf(mu_mmap_log_t *log, const char *fmt, va_list arg);
+
+/*!
+ * @brief Start writing the log out to the file, without waiting (MS_ASYNC).
+ *
+ * @return 0, or -1 with errno set.
+ */
+int mu_mmap_log_sync(mu_mmap_log_t *log);
+
+/*!
+ * @brief Unmap the log, trim the file to the messages written, and close
+ * it.  No thread may still be writing.
+ *
+ * @return 0, or -1 with errno set.
+ */
+int mu_mmap_log_close(mu_mmap_log_t *log);
+
+#endif /* SOURCE_MU_MMAP_H_ */
@@ -0,0 +1,163 @@
+/*
+ * mu_mmap_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -pthread -o mu_mmap_test mu_mmap_test.c mu_mmap.c mu_sink.c mu_printf.c && ./mu_mmap_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_mmap.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+#define N_THREADS 4
+#define N_LINES 20000
+
+typedef struct {
+  mu_mmap_log_t *log;
+  int id;
+} writer_t;
+
+void *writer_fn(void *arg) {
+  writer_t const *writer = arg;
+  int i;
+  for (i=0; i<N_LINES; i++) {
+    mu_mmap_log_printf(writer->log, "w%d n=%d %s t=%.2f\n", writer->id, i,
+                       i & 1 ? "pump" : "valve", i * 0.5);
+  }
+  return NULL;
+}
+
+// Read the whole file at path into a new string; *n is its length.
+char *read_log(char const *path, long *n) {
+  FILE *f = fopen(path, "r");
+  fseek(f, 0, SEEK_END);
+  *n = ftell(f);
+  rewind(f);
+  char *text = malloc(*n + 1);
+  *n = fread(text, 1, *n, f);
+  text[*n] = '\0';
+  fclose(f);
+  return text;
+}
+
+// ======================================================================
+// tests
+
+void mu_mmap_threads_test() {
+  PRINTF("...mu_mmap_threads_test\r\n");
+  char path[] = "/tmp/mu_mmap_test.XXXXXX";
+  pthread_t threads[N_THREADS];
+  writer_t writers[N_THREADS];
+  int next[N_THREADS] = {0};
+  mu_mmap_log_t log;
+  bool well_formed = true;
+  long n;
+  int i;
+
+  close(mkstemp(path));
+  MU_TEST(mu_mmap_log_open(&log, path, 1 << 26, 4096) == 0);
+  for (i=0; i<N_THREADS; i++) {
+    writers[i].log = &log;
+    writers[i].id = i;
+    pthread_create(&threads[i], NULL, writer_fn, &writers[i]);
+  }
+  for (i=0; i<N_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  MU_TEST(mu_mmap_log_sync(&log) == 0);
+  MU_TEST(log.dropped == 0);
+  MU_TEST(mu_mmap_log_close(&log) == 0);
+
+  // every line is whole, and each thread's lines are all there, in order
+  char *text = read_log(path, &n);
+  char *line = text;
+  while (line < text + n) {
+    char *end = strchr(line, '\n');
+    int id, seq;
+    char expected[64];
+    if (end == NULL || sscanf(line, "w%d n=%d", &id, &seq) != 2 ||
+        id < 0 || id >= N_THREADS || seq != next[id]) {
+      well_formed = false;
+      break;
+    }
+    snprintf(expected, sizeof(expected), "w%d n=%d %s t=%.2f\n", id, seq,
+             seq & 1 ? "pump" : "valve", seq * 0.5);
+    well_formed &= strncmp(line, expected, end + 1 - line) == 0;
+    next[id] += 1;
+    line = end + 1;
+  }
+  MU_TEST(well_formed);
+  for (i=0; i<N_THREADS; i++) {
+    MU_TEST(next[i] == N_LINES);
+  }
+  free(text);
+  unlink(path);
+}
+
+void mu_mmap_full_test() {
+  PRINTF("...mu_mmap_full_test\r\n");
+  char path[] = "/tmp/mu_mmap_test.XXXXXX";
+  mu_mmap_log_t log;
+  long n;
+  int i;
+
+  close(mkstemp(path));
+  MU_TEST(mu_mmap_log_open(&log, path, 100, 1) == 0);
+  // 10 chars a line: 10 lines fit, the rest are dropped
+  for (i=0; i<12; i++) {
+    MU_TEST(mu_mmap_log_printf(&log, "line %04d\n", i) == 10);
+  }
+  MU_TEST(log.dropped == 20);
+  char *reserved = mu_mmap_log_reserve(&log, 1);
+  MU_TEST(reserved == NULL);
+  MU_TEST(mu_mmap_log_close(&log) == 0);
+
+  char *text = read_log(path, &n);
+  MU_TEST(n == 100);
+  MU_TEST(strncmp(text, "line 0000\n", 10) == 0);
+  MU_TEST(strncmp(&text[90], "line 0009\n", 10) == 0);
+  free(text);
+
+  // a line that straddles the end does not leave part of itself behind
+  MU_TEST(mu_mmap_log_open(&log, path, 15, 4096) == 0);
+  mu_mmap_log_printf(&log, "line %04d\n", 0);
+  mu_mmap_log_printf(&log, "line %04d\n", 1);
+  MU_TEST(mu_mmap_log_close(&log) == 0);
+  text = read_log(path, &n);
+  MU_TEST(n == 10);
+  free(text);
+  unlink(path);
+}
+
+void mu_mmap_test() {
+  PRINTF("begin tests...\r\n");
+  mu_mmap_threads_test();
+  mu_mmap_full_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_mmap_test();
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * mu_packet.c
+ *
+ * gcc -Wall -O2 -c mu_packet.c mu_printf.c
+ */
+
+#include "mu_packet.h"
+
+// =============================================================================
+// forward declarations
+
+char *packet_reserve(mu_sink_t *sink, int *n);
+void packet_commit(mu_sink_t *sink, int n);
+void packet_end(mu_sink_t *sink);
+int packet_send(mu_packet_t *packet);
+
+static const mu_sink_vtable_t s_packet_vtable = {
+  packet_reserve,
+  packet_commit,
+  packet_end
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_packet_init(mu_packet_t *packet,
+                          char *buf,
+                          int mtu,
+                          uint32_t max_delay,
+                          mu_clock_fn clock_fn,
+                          void *clock_arg,
+                          emitter_t emitter_fn,
+                          void *obj) {
+  packet->sink.vtable = &s_packet_vtable;
+  packet->emitter_fn = emitter_fn;
+  packet->emitter_arg = obj;
+  packet->clock_fn = clock_fn;
+  packet->clock_arg = clock_arg;
+  packet->buf = buf;
+  packet->mtu = mtu;
+  packet->length = 0;
+  packet->max_delay = max_delay;
+  packet->opened_at = 0;
+  packet->full_packets = 0;
+  packet->late_packets = 0;
+  return &packet->sink;
+}
+
+int mu_packet_poll(mu_packet_t *packet) {
+  uint32_t now;
+
+  if (packet->length == 0) {
+    return 0;
+  }
+  now = packet->clock_fn(packet->clock_arg);
+  if (now - packet->opened_at < packet->max_delay) {
+    return 0;
+  }
+  packet->late_packets += 1;
+  return packet_send(packet);
+}
+
+int mu_packet_flush(mu_packet_t *packet) {
+  return packet_send(packet);
+}
+
+// =============================================================================
+// =============================================================================
+
+char *packet_reserve(mu_sink_t *sink, int *n) {
+  mu_packet_t *packet = (mu_packet_t *)sink;
+  int room = packet->mtu - packet->length;
+
+  // Grant no more than fits, so that long output is split into full packets
+  // rather than sent early to make room.
+  if (*n > room) {
+    *n = room;
+  }
+  return &packet->buf[packet->length];
+}
+
+void packet_commit(mu_sink_t *sink, int n) {
+  mu_packet_t *packet = (mu_packet_t *)sink;
+
+  if (n <= 0) {
+    return;
+  }
+  if (packet->length == 0) {
+    packet->opened_at = packet->clock_fn(packet->clock_arg);
+  }
+  packet->length += n;
+  if (packet->length == packet->mtu) {
+    packet->full_packets += 1;
+    packet_send(packet);
+  }
+}
+
+void packet_end(mu_sink_t *sink) {
+  mu_packet_poll((mu_packet_t *)sink);
+}
+
+/*
+ * Send whatever is in the packet.  An empty packet is not sent.
+ */
+int packet_send(mu_packet_t *packet) {
+  int n = packet->length;
+
+  if (n == 0) {
+    return 0;
+  }
+  mu_emit_block(packet->emitter_fn, packet->emitter_arg, packet->buf, n);
+  packet->length = 0;
+  return n;
+}
@@ -0,0 +1,89 @@
+/*
+ * mu_packet - gather output into fixed-size packets for USB and radio links
+ *
+ * A USB full-speed bulk endpoint moves 64 bytes in about the time it takes to
+ * move one, and a radio pays its wake-up and preamble per packet, so sending
+ * each mu_printf() call as its own transfer wastes the link.  A mu_packet_t
+ * is a sink (see mu_sink_t in mu_printf.h) that fills packets of mtu chars
+ * and sends each one with a single mu_emit_block() to another emitter.
+ *
+ * A packet goes out as soon as it is full.  A packet that is not full goes
+ * out once max_delay ticks have passed since its first char was written:
+ * this is checked at the end of every mu_printf() call and by
+ * mu_packet_poll(), which should be called from the main loop or a timer so
+ * that the last output is not held up indefinitely.
+ *
+ * Time comes from a user-supplied clock, so any tick (SysTick, an RTC, a
+ * fake clock in a test) will do.  Ticks are compared with unsigned
+ * subtraction and may wrap.
+ *
+ *   static char buf[64];
+ *   mu_packet_t cdc;
+ *   mu_sink_t *out = mu_packet_init(&cdc, buf, sizeof(buf), 2,
+ *                                   millis, NULL, cdc_emitter, NULL);
+ *   mu_printf(mu_sink_emitter, out, "t=%d\n", t);
+ *   ...
+ *   mu_packet_poll(&cdc);
+ */
+
+#ifndef SOURCE_MU_PACKET_H_
+#define SOURCE_MU_PACKET_H_
+
+#include "mu_printf.h"
+
+// the user's clock: returns the current time in ticks
+typedef uint32_t (*mu_clock_fn)(void *arg);
+
+typedef struct {
+  mu_sink_t sink;         // must come first
+  emitter_t emitter_fn;   // where packets go
+  void *emitter_arg;      // user-supplied argument to emitter_fn
+  mu_clock_fn clock_fn;   // the time source
+  void *clock_arg;        // user-supplied argument to clock_fn
+  char *buf;              // the packet being filled
+  int mtu;                // chars in a full packet
+  int length;             // chars in the packet so far
+  uint32_t max_delay;     // ticks a packet may wait before it is sent
+  uint32_t opened_at;     // time the packet's first char was written
+  uint32_t full_packets;  // packets sent because they were full
+  uint32_t late_packets;  // packets sent because their deadline passed
+} mu_packet_t;
+
+/*!
+ * @brief Set up packet to send packets of mtu chars, assembled in buf, to
+ * emitter_fn.
+ *
+ * @param packet The sink.
+ * @param buf A buffer of at least mtu chars.
+ * @param mtu Chars in a full packet.
+ * @param max_delay Ticks a partly filled packet may wait.  0 sends every
+ *        partial packet at the end of the mu_printf() call that wrote it.
+ * @param clock_fn, clock_arg The time source.
+ * @param emitter_fn Where the packets go.
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_packet_init(mu_packet_t *packet,
+                          char *buf,
+                          int mtu,
+                          uint32_t max_delay,
+                          mu_clock_fn clock_fn,
+                          void *clock_arg,
+                          emitter_t emitter_fn,
+                          void *obj);
+
+/*!
+ * @brief Send the packet being filled if its deadline has passed.
+ *
+ * @return The number of chars sent.
+ */
+int mu_packet_poll(mu_packet_t *packet);
+
+/*!
+ * @brief Send the packet being filled now, whether or not it is full.
+ *
+ * @return The number of chars sent.
+ */
+int mu_packet_flush(mu_packet_t *packet);
+
+#endif /* SOURCE_MU_PACKET_H_ */
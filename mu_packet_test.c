@@ -0,0 +1,176 @@
+/*
+ * mu_packet_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_packet_test mu_packet_test.c mu_packet.c mu_printf.c && ./mu_packet_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_packet.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+bool check_test_emitter(const char *expected) {
+  test_buf[test_index] = '\0';
+  test_index = 0;
+  return strcmp(expected, test_buf) == 0;
+}
+
+// A downstream sink that appends to test_buf and records the size of each
+// packet.
+int packets[16];
+int n_packets;
+
+char *recording_reserve(mu_sink_t *sink, int *n) {
+  return &test_buf[test_index];
+}
+
+void recording_commit(mu_sink_t *sink, int n) {
+  test_index += n;
+  packets[n_packets++] = n;
+}
+
+static const mu_sink_vtable_t s_recording_vtable = {
+  recording_reserve,
+  recording_commit,
+  NULL
+};
+static mu_sink_t s_recording = {&s_recording_vtable};
+
+bool check_packets(int n, int const *expected) {
+  bool match = n == n_packets &&
+               memcmp(packets, expected, n * sizeof(int)) == 0;
+  n_packets = 0;
+  return match;
+}
+
+// a clock that only moves when the test says so
+uint32_t fake_clock_fn(void *arg) {
+  return *(uint32_t *)arg;
+}
+
+// ======================================================================
+// tests
+
+void mu_packet_full_test() {
+  PRINTF("...mu_packet_full_test\r\n");
+  char buf[8];
+  uint32_t now = 0;
+  mu_packet_t packet;
+  mu_sink_t *out = mu_packet_init(&packet, buf, sizeof(buf), 10,
+                                  fake_clock_fn, &now,
+                                  mu_sink_emitter, &s_recording);
+
+  // long output is cut into full packets, the rest waits
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s|%d", "0123456789", 12345) == 16);
+  MU_TEST(check_packets(2, (int[]){8, 8}));
+  MU_TEST(check_test_emitter("0123456789|12345"));
+  MU_TEST(mu_printf(mu_sink_emitter, out, "abc") == 3);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "defgh") == 5);
+  MU_TEST(check_packets(1, (int[]){8}));
+  MU_TEST(check_test_emitter("abcdefgh"));
+  MU_TEST(packet.full_packets == 3);
+  MU_TEST(packet.late_packets == 0);
+
+  // explicit flush
+  MU_TEST(mu_printf(mu_sink_emitter, out, "xy") == 2);
+  MU_TEST(mu_packet_flush(&packet) == 2);
+  MU_TEST(mu_packet_flush(&packet) == 0);
+  MU_TEST(check_packets(1, (int[]){2}));
+  MU_TEST(check_test_emitter("xy"));
+}
+
+void mu_packet_deadline_test() {
+  PRINTF("...mu_packet_deadline_test\r\n");
+  char buf[64];
+  uint32_t now = 100;
+  mu_packet_t packet;
+  mu_sink_t *out = mu_packet_init(&packet, buf, sizeof(buf), 10,
+                                  fake_clock_fn, &now,
+                                  mu_sink_emitter, &s_recording);
+
+  // calls within the deadline coalesce
+  MU_TEST(mu_printf(mu_sink_emitter, out, "a=%d\n", 1) == 4);
+  now = 105;
+  MU_TEST(mu_printf(mu_sink_emitter, out, "b=%d\n", 2) == 4);
+  MU_TEST(mu_packet_poll(&packet) == 0);
+  MU_TEST(check_packets(0, packets));
+
+  // the deadline runs from the first char of the packet
+  now = 110;
+  MU_TEST(mu_packet_poll(&packet) == 8);
+  MU_TEST(check_packets(1, (int[]){8}));
+  MU_TEST(check_test_emitter("a=1\nb=2\n"));
+
+  // a call that ends after the deadline sends the packet itself
+  MU_TEST(mu_printf(mu_sink_emitter, out, "c") == 1);
+  now = 125;
+  MU_TEST(mu_printf(mu_sink_emitter, out, "d") == 1);
+  MU_TEST(check_packets(1, (int[]){2}));
+  MU_TEST(packet.late_packets == 2);
+
+  // an empty packet has no deadline
+  now = 500;
+  MU_TEST(mu_packet_poll(&packet) == 0);
+  MU_TEST(check_packets(0, packets));
+
+  // the clock may wrap
+  now = 0xfffffffa;
+  MU_TEST(mu_printf(mu_sink_emitter, out, "e") == 1);
+  now = 2;
+  MU_TEST(mu_packet_poll(&packet) == 0);
+  now = 4;
+  MU_TEST(mu_packet_poll(&packet) == 1);
+  MU_TEST(check_packets(1, (int[]){1}));
+  MU_TEST(check_test_emitter("cde"));
+}
+
+void mu_packet_no_delay_test() {
+  PRINTF("...mu_packet_no_delay_test\r\n");
+  char buf[16];
+  uint32_t now = 0;
+  mu_packet_t packet;
+  mu_sink_t *out = mu_packet_init(&packet, buf, sizeof(buf), 0,
+                                  fake_clock_fn, &now,
+                                  mu_sink_emitter, &s_recording);
+
+  // with no delay each call is one packet, however it was produced
+  MU_TEST(mu_printf(mu_sink_emitter, out, "[%4d|%-3s]", 7, "ab") == 10);
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%c", 'z') == 1);
+  MU_TEST(check_packets(2, (int[]){10, 1}));
+  MU_TEST(check_test_emitter("[   7|ab ]z"));
+}
+
+void mu_packet_test() {
+  PRINTF("begin tests...\r\n");
+  mu_packet_full_test();
+  mu_packet_deadline_test();
+  mu_packet_no_delay_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_packet_test();
+}
+
+#endif
@@ -0,0 +1,245 @@
+/*
+ * mu_parallel.c
+ *
+ * gcc -Wall -O2 -pthread -c mu_parallel.c
+ */
+
+#include "mu_parallel.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MU_PARALLEL_MAX_WORKERS 256
+#define MU_PARALLEL_INITIAL_BUFFER 4096
+
+typedef struct {
+  mu_parallel_job_t const *job;
+  size_t first;      // index of first record in this worker's slice
+  size_t last;       // one past the last record
+  char *buf;         // formatted output of the slice
+  size_t len;
+  size_t capacity;
+  bool failed;       // ran out of memory
+  char *dst;         // join phase: where this worker's output goes
+} worker_t;
+
+// =============================================================================
+// forward declarations
+
+int parallel_worker_emitter(void *obj, char ch);
+void *parallel_format_worker(void *arg);
+void *parallel_copy_worker(void *arg);
+int parallel_run_workers(worker_t *workers, int n_workers,
+                         void *(*fn)(void *));
+int parallel_start_job(mu_parallel_job_t const *job, worker_t *workers);
+void parallel_free_workers(worker_t *workers, int n_workers);
+double parallel_now_seconds();
+
+// =============================================================================
+// Code
+
+int mu_parallel_format(mu_parallel_job_t const *job,
+                       emitter_t emitter_fn,
+                       void *obj,
+                       mu_parallel_stats_t *stats) {
+  worker_t workers[MU_PARALLEL_MAX_WORKERS];
+  double t0 = parallel_now_seconds();
+  int n_workers = parallel_start_job(job, workers);
+  int i;
+
+  if (n_workers < 0) {
+    return -1;
+  }
+  double t1 = parallel_now_seconds();
+  size_t n_bytes = 0;
+  for (i=0; i<n_workers; i++) {
+    // mu_emit_block() takes an int count, so hand over INT_MAX at a time
+    char const *buf = workers[i].buf;
+    size_t len = workers[i].len;
+    while (len > 0) {
+      int n = len > INT_MAX ? INT_MAX : (int)len;
+      mu_emit_block(emitter_fn, obj, buf, n);
+      buf += n;
+      len -= n;
+    }
+    n_bytes += workers[i].len;
+  }
+  double t2 = parallel_now_seconds();
+  parallel_free_workers(workers, n_workers);
+
+  if (stats) {
+    stats->n_workers = n_workers;
+    stats->n_records = job->n_records;
+    stats->n_bytes = n_bytes;
+    stats->format_seconds = t1 - t0;
+    stats->join_seconds = t2 - t1;
+  }
+  return 0;
+}
+
+long mu_parallel_format_buffer(mu_parallel_job_t const *job,
+                               char *dst,
+                               size_t capacity,
+                               mu_parallel_stats_t *stats) {
+  worker_t workers[MU_PARALLEL_MAX_WORKERS];
+  double t0 = parallel_now_seconds();
+  int n_workers = parallel_start_job(job, workers);
+  int i;
+
+  if (n_workers < 0) {
+    return -1;
+  }
+  double t1 = parallel_now_seconds();
+  // exclusive prefix sum of the lengths gives each worker its offset
+  size_t offset = 0;
+  for (i=0; i<n_workers; i++) {
+    workers[i].dst = dst + offset;
+    offset += workers[i].len;
+  }
+  if (offset > capacity ||
+      parallel_run_workers(workers, n_workers, parallel_copy_worker)) {
+    parallel_free_workers(workers, n_workers);
+    return -1;
+  }
+  double t2 = parallel_now_seconds();
+  parallel_free_workers(workers, n_workers);
+
+  if (stats) {
+    stats->n_workers = n_workers;
+    stats->n_records = job->n_records;
+    stats->n_bytes = offset;
+    stats->format_seconds = t1 - t0;
+    stats->join_seconds = t2 - t1;
+  }
+  return offset;
+}
+
+// =============================================================================
+// =============================================================================
+
+/*
+ * Split the job into per-worker slices and format them.  Returns the number
+ * of workers used, or -1 on failure (in which case nothing needs freeing).
+ */
+int parallel_start_job(mu_parallel_job_t const *job, worker_t *workers) {
+  int n_workers = job->n_workers;
+  int i;
+
+  if (n_workers <= 0) {
+    n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (n_workers < 1) {
+    n_workers = 1;
+  }
+  if (n_workers > MU_PARALLEL_MAX_WORKERS) {
+    n_workers = MU_PARALLEL_MAX_WORKERS;
+  }
+  if ((size_t)n_workers > job->n_records && job->n_records > 0) {
+    n_workers = job->n_records;
+  }
+
+  for (i=0; i<n_workers; i++) {
+    workers[i].job = job;
+    workers[i].first = job->n_records * i / n_workers;
+    workers[i].last = job->n_records * (i + 1) / n_workers;
+    workers[i].buf = NULL;
+    workers[i].len = 0;
+    workers[i].capacity = 0;
+    workers[i].failed = false;
+    workers[i].dst = NULL;
+  }
+  if (parallel_run_workers(workers, n_workers, parallel_format_worker)) {
+    parallel_free_workers(workers, n_workers);
+    return -1;
+  }
+  for (i=0; i<n_workers; i++) {
+    if (workers[i].failed) {
+      parallel_free_workers(workers, n_workers);
+      return -1;
+    }
+  }
+  return n_workers;
+}
+
+/*
+ * Run fn on every worker: workers 1..n-1 on their own threads, worker 0 on
+ * the calling thread.  Returns non-zero if a thread could not be started.
+ */
+int parallel_run_workers(worker_t *workers, int n_workers,
+                         void *(*fn)(void *)) {
+  pthread_t threads[MU_PARALLEL_MAX_WORKERS];
+  int n_started;
+  int err = 0;
+  int i;
+
+  for (n_started=1; n_started<n_workers; n_started++) {
+    if (pthread_create(&threads[n_started], NULL, fn, &workers[n_started])) {
+      err = -1;
+      break;
+    }
+  }
+  fn(&workers[0]);
+  for (i=1; i<n_started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  return err;
+}
+
+void *parallel_format_worker(void *arg) {
+  worker_t *worker = (worker_t *)arg;
+  mu_parallel_job_t const *job = worker->job;
+  char const *record = (char const *)job->records +
+      worker->first * job->record_size;
+  size_t i;
+
+  for (i=worker->first; i<worker->last; i++) {
+    job->format_fn(parallel_worker_emitter, worker, record, job->format_arg);
+    record += job->record_size;
+  }
+  return NULL;
+}
+
+void *parallel_copy_worker(void *arg) {
+  worker_t *worker = (worker_t *)arg;
+  if (worker->len > 0) {
+    memcpy(worker->dst, worker->buf, worker->len);
+  }
+  return NULL;
+}
+
+/*
+ * Append ch to the worker's buffer, doubling it as needed.
+ */
+int parallel_worker_emitter(void *obj, char ch) {
+  worker_t *worker = (worker_t *)obj;
+  if (worker->len == worker->capacity) {
+    size_t capacity = worker->capacity ?
+        worker->capacity * 2 : MU_PARALLEL_INITIAL_BUFFER;
+    char *buf = realloc(worker->buf, capacity);
+    if (buf == NULL) {
+      worker->failed = true;
+      return 0;
+    }
+    worker->buf = buf;
+    worker->capacity = capacity;
+  }
+  worker->buf[worker->len++] = ch;
+  return 1;
+}
+
+void parallel_free_workers(worker_t *workers, int n_workers) {
+  int i;
+  for (i=0; i<n_workers; i++) {
+    free(workers[i].buf);
+    workers[i].buf = NULL;
+  }
+}
+
+double parallel_now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
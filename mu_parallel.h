@@ -0,0 +1,81 @@
+/*
+ * mu_parallel - format large batches of records on a pool of host threads
+ *
+ * Host only (POSIX threads).  Each worker formats a contiguous slice of the
+ * batch into its own buffer through the ordinary emitter_t contract.  The
+ * buffers are then joined in record order at offsets given by a prefix sum
+ * of their lengths, so the output is identical to formatting the whole batch
+ * on one thread.
+ */
+
+#ifndef SOURCE_MU_PARALLEL_H_
+#define SOURCE_MU_PARALLEL_H_
+
+#include "mu_printf.h"
+#include <stddef.h>
+
+/*!
+ * @brief Template for "format one record" method
+ *
+ * Called concurrently from several workers, so it must only write through
+ * emitter_fn / obj and must not touch shared mutable state.  Returns the
+ * number of chars emitted.
+ */
+typedef int (*mu_record_formatter_t)(emitter_t emitter_fn,
+                                     void *obj,
+                                     void const *record,
+                                     void *arg);
+
+typedef struct {
+  mu_record_formatter_t format_fn;  // formats one record
+  void *format_arg;                 // user-supplied argument to format_fn
+  void const *records;              // the first record
+  size_t record_size;               // bytes from one record to the next
+  size_t n_records;                 // number of records in the batch
+  int n_workers;                    // 0 or less: one per online CPU
+} mu_parallel_job_t;
+
+typedef struct {
+  int n_workers;          // workers actually used
+  size_t n_records;       // records formatted
+  size_t n_bytes;         // chars in the joined output
+  double format_seconds;  // wall time of the parallel formatting phase
+  double join_seconds;    // wall time to hand the joined output over
+} mu_parallel_stats_t;
+
+/*!
+ * @brief Format a batch of records in parallel and emit them in order.
+ *
+ * The joined output is passed to emitter_fn with mu_emit_block(), one block
+ * per worker, in record order.
+ *
+ * @param job Describes the records and how to format them.
+ * @param emitter_fn Pointer to char emitter function for the joined output.
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @param stats If not NULL, receives sizes and timings for the batch.
+ * @return 0 on success, -1 if a buffer or thread could not be created.
+ */
+int mu_parallel_format(mu_parallel_job_t const *job,
+                       emitter_t emitter_fn,
+                       void *obj,
+                       mu_parallel_stats_t *stats);
+
+/*!
+ * @brief Format a batch of records in parallel into one contiguous buffer.
+ *
+ * Like mu_parallel_format(), except that after formatting every worker
+ * copies its own buffer to dst at its prefix sum offset, so the join runs
+ * in parallel too.  Nothing is written if the output would not fit.
+ *
+ * @param job Describes the records and how to format them.
+ * @param dst Destination buffer.  Not null terminated.
+ * @param capacity Size of dst.
+ * @param stats If not NULL, receives sizes and timings for the batch.
+ * @return Number of chars written, or -1 on error or if dst is too small.
+ */
+long mu_parallel_format_buffer(mu_parallel_job_t const *job,
+                               char *dst,
+                               size_t capacity,
+                               mu_parallel_stats_t *stats);
+
+#endif /* SOURCE_MU_PARALLEL_H_ */
@@ -0,0 +1,98 @@
+/*
+ * mu_parallel_bench.c - throughput scaling of mu_parallel_format_buffer()
+ *
+ * gcc -Wall -O2 -pthread -o mu_parallel_bench mu_parallel_bench.c mu_parallel.c mu_printf.c && ./mu_parallel_bench [n_records [max_workers]]
+ *
+ * Formats a synthetic batch of device records with 1, 2, 4 ... workers up to
+ * max_workers (default: the number of online CPUs), and reports records/s, MB/s and the speedup over
+ * a single worker.
+ */
+
+#include "mu_parallel.h"
+#include "mu_printf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+  unsigned int timestamp;
+  int id;
+  unsigned int status;
+  float temperature;
+  float voltage;
+  char const *name;
+} record_t;
+
+int format_record(emitter_t emitter_fn, void *obj, void const *r, void *arg) {
+  record_t const *record = (record_t const *)r;
+  return mu_printf(emitter_fn,
+                   obj,
+                   "%d.%03d dev=%s id=%d status=%08x t=%.2f v=%.3f\n",
+                   record->timestamp / 1000,
+                   record->timestamp % 1000,
+                   record->name,
+                   record->id,
+                   record->status,
+                   record->temperature,
+                   record->voltage);
+}
+
+int main(int argc, char **argv) {
+  static char const *names[] = {"pump", "valve", "sensor", "gateway"};
+  size_t n_records = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  int n_cpus = argc > 2 ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+  record_t *records = malloc(n_records * sizeof(record_t));
+  size_t capacity = n_records * 96;
+  char *dst = malloc(capacity);
+  mu_parallel_job_t job;
+  mu_parallel_stats_t stats;
+  double base_seconds = 0.0;
+  size_t i;
+  int n;
+
+  if (records == NULL || dst == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  for (i=0; i<n_records; i++) {
+    records[i].timestamp = i * 7;
+    records[i].id = (int)(i * 2654435761u) >> 8;
+    records[i].status = i * 40503u;
+    records[i].temperature = (i % 1000) * 0.125 - 40.0;
+    records[i].voltage = 3.3 + (i % 17) * 0.01;
+    records[i].name = names[i % 4];
+  }
+
+  job.format_fn = format_record;
+  job.format_arg = NULL;
+  job.records = records;
+  job.record_size = sizeof(record_t);
+  job.n_records = n_records;
+
+  printf("%zu records, up to %d workers\n", n_records, n_cpus);
+  printf("workers   seconds   Mrec/s     MB/s  speedup\n");
+  for (n=1; ; n = (n * 2 > n_cpus && n < n_cpus) ? n_cpus : n * 2) {
+    job.n_workers = n;
+    if (mu_parallel_format_buffer(&job, dst, capacity, &stats) < 0) {
+      fprintf(stderr, "mu_parallel_format_buffer failed\n");
+      return 1;
+    }
+    double seconds = stats.format_seconds + stats.join_seconds;
+    if (n == 1) {
+      base_seconds = seconds;
+    }
+    printf("%7d %9.4f %8.2f %8.1f %8.2f\n",
+           stats.n_workers,
+           seconds,
+           n_records / seconds * 1e-6,
+           stats.n_bytes / seconds * 1e-6,
+           base_seconds / seconds);
+    if (n >= n_cpus) {
+      break;
+    }
+  }
+
+  free(dst);
+  free(records);
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * mu_parallel_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -pthread -o mu_parallel_test mu_parallel_test.c mu_parallel.c mu_printf.c && ./mu_parallel_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_parallel.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+// ======================================================================
+// records and a buffer emitter
+
+typedef struct {
+  int id;
+  unsigned int status;
+  float temperature;
+} record_t;
+
+#define N_RECORDS 1000
+
+record_t records[N_RECORDS];
+char expected[N_RECORDS * 64];
+char actual[N_RECORDS * 64];
+int actual_index;
+
+int format_record(emitter_t emitter_fn, void *obj, void const *r, void *arg) {
+  record_t const *record = (record_t const *)r;
+  return mu_printf(emitter_fn,
+                   obj,
+                   "%s id=%d status=%08x t=%.2f\n",
+                   (char const *)arg,
+                   record->id,
+                   record->status,
+                   record->temperature);
+}
+
+int actual_emitter(void *obj, char ch) {
+  actual[actual_index++] = ch;
+  return 1;
+}
+
+typedef struct {
+  char *buf;
+  int index;
+} buffer_t;
+
+int buffer_emitter(void *obj, char ch) {
+  buffer_t *buffer = (buffer_t *)obj;
+  buffer->buf[buffer->index++] = ch;
+  return 1;
+}
+
+// ======================================================================
+// The unit tests
+
+void mu_parallel_format_test() {
+  PRINTF("...mu_parallel_format_test\r\n");
+  mu_parallel_job_t job;
+  mu_parallel_stats_t stats;
+  buffer_t buffer = {expected, 0};
+  int n_workers[] = {1, 2, 3, 7, 0};
+  int i;
+
+  for (i=0; i<N_RECORDS; i++) {
+    records[i].id = i * 37 - 500;
+    records[i].status = i * 2654435761u;
+    records[i].temperature = i * 0.25 - 40.0;
+  }
+  for (i=0; i<N_RECORDS; i++) {
+    format_record(buffer_emitter, &buffer, &records[i], "rec");
+  }
+
+  job.format_fn = format_record;
+  job.format_arg = "rec";
+  job.records = records;
+  job.record_size = sizeof(record_t);
+  job.n_records = N_RECORDS;
+
+  for (i=0; i<(int)(sizeof(n_workers)/sizeof(n_workers[0])); i++) {
+    job.n_workers = n_workers[i];
+
+    actual_index = 0;
+    MU_TEST(mu_parallel_format(&job, actual_emitter, NULL, &stats) == 0);
+    MU_TEST(stats.n_bytes == (size_t)buffer.index);
+    MU_TEST(stats.n_records == N_RECORDS);
+    MU_TEST(actual_index == buffer.index);
+    MU_TEST(memcmp(actual, expected, buffer.index) == 0);
+
+    memset(actual, 0, sizeof(actual));
+    MU_TEST(mu_parallel_format_buffer(&job, actual, sizeof(actual), &stats) ==
+            buffer.index);
+    MU_TEST(memcmp(actual, expected, buffer.index) == 0);
+  }
+
+  // too small a destination: nothing is written
+  job.n_workers = 4;
+  memset(actual, 0, sizeof(actual));
+  MU_TEST(mu_parallel_format_buffer(&job, actual, 100, NULL) == -1);
+  MU_TEST(actual[0] == 0);
+
+  // an empty batch
+  job.n_records = 0;
+  actual_index = 0;
+  MU_TEST(mu_parallel_format(&job, actual_emitter, NULL, &stats) == 0);
+  MU_TEST(stats.n_bytes == 0);
+  MU_TEST(actual_index == 0);
+}
+
+void mu_parallel_test() {
+  PRINTF("begin tests...\r\n");
+  mu_parallel_format_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_parallel_test();
+}
+
+#endif
@@ -7,8 +7,13 @@
  */
 
 #include "mu_printf.h"
+#include <limits.h>
 #include <stdarg.h>
 
+#if MU_PRINTF_ENABLE_PROFILE
+#include "mu_profile.h"
+#endif
+
 // happy gnu extensions
 #define MAX(a,b) ({ \
   __typeof__ (a) _a = (a); \
@@ -22,19 +27,150 @@
   _a < _b ? _a : _b; \
 })
 
+#if MU_PRINTF_ENABLE_FLOAT
+// Where the digits of a float lie, as found by float_layout().  The fields
+// are narrow to keep the frames of the %e and %f paths small.
+typedef struct {
+  float v;
+  int16_t precision;
+  int16_t top;          // the leading digit is at 10^(top-1)
+  int16_t carry_limit;  // rounding adds 1 to each digit at p <= carry_limit
+  bool carry_out;       // rounding carried into a new leading '1'
+} float_layout_t;
+#endif
+
 // =============================================================================
 // forward declarations
 
 char const *parse_decimal(uint8_t *val, char const *str);
+int sink_write(mu_sink_t *sink, char const *buf, char fill, int n);
+char *sink_reserve(emitter_t emitter_fn, void *obj, int n);
+void sink_commit(void *obj, int n);
+void sink_end(emitter_t emitter_fn, void *obj);
+int mu_strnlen(char const *str, int limit);
 int process_directive(mu_directive_t *directive, va_list arg);
 int process_c_directive(mu_directive_t *directive, unsigned int ch);
 int process_d_directive(mu_directive_t *directive, int v);
+#if MU_PRINTF_ENABLE_E
 int process_e_directive(mu_directive_t *directive, double v);
+#endif
+#if MU_PRINTF_ENABLE_FLOAT
 int process_f_directive(mu_directive_t *directive, double v);
+#endif
 int process_s_directive(mu_directive_t *directive, char const *str);
+int emit_s_text(mu_directive_t *directive, char const *str, int limit);
+int s_text_length(mu_directive_t *directive, char const *str, int limit, int max);
+#if MU_PRINTF_ENABLE_ESCAPE
+bool needs_escape(char ch);
+unsigned int clean_run(char const *str, unsigned int limit);
+int escape_char(char *buf, char ch, bool json);
+int escaped_length(char const *str, int limit, int max, bool json);
+#endif
+#if MU_PRINTF_ENABLE_STRUCTURED
+bool structured_name_char(char ch);
+#endif
 int process_u_directive(mu_directive_t *directive, unsigned int v, int base);
-int emit_float_aux(emitter_t emitter, void *obj, float v, int p10, bool round_up);
-
+char const *integer_prefix(mu_directive_t *directive, unsigned int v, bool is_negative, int base, unsigned int n_required);
+int measure_directive(mu_directive_t *directive, va_list arg);
+int measure_diox_directive(mu_directive_t *directive, unsigned int v, bool is_negative, int base);
+int measure_s_directive(mu_directive_t *directive, char const *str);
+#if MU_PRINTF_ENABLE_FLOAT
+int measure_f_directive(mu_directive_t *directive, double v);
+#endif
+#if MU_PRINTF_ENABLE_E
+int measure_e_directive(mu_directive_t *directive, double v);
+#endif
+#if MU_PRINTF_ENABLE_FLOAT
+char const *sign_prefix(mu_directive_t *directive, bool is_negative);
+#endif
+#if MU_PRINTF_ENABLE_E
+int e_layout(float_layout_t *layout, double v, unsigned int precision);
+#endif
+int pow2_shift(unsigned int base);
+char *format_pow2(char *end, unsigned int v, int shift, bool upper);
+char *format_decimal(char *end, unsigned int v);
+#if MU_PRINTF_ENABLE_STATS
+uint32_t stats_now(void);
+void stats_count(mu_stats_counter_t *counter, int n, uint32_t t0);
+void stats_conversion(char conversion, int n, uint32_t t0);
+void stats_format(char const *fmt, int n, uint32_t t0);
+#else
+// no instrumentation: the hooks compile to nothing
+#define stats_now() 0
+#define stats_conversion(conversion, n, t0) ((void)(t0))
+#define stats_format(fmt, n, t0) ((void)(fmt), (void)(t0))
+#endif
+#if MU_PRINTF_ENABLE_FLOAT
+double float_scale(int p);
+double float_scaled(float v, int p);
+unsigned int float_digits_at(float v, int p);
+int float_layout(float_layout_t *layout, float v, unsigned int precision);
+int float_layout_length(float_layout_t const *layout);
+int emit_float_layout(emitter_t emitter, void *obj, float_layout_t const *layout);
+#endif
+
+
+#define UINT_BITS ((int)(sizeof(unsigned int) * 8))
+
+// chars of a %s argument scanned per mu_emit_block() call
+#define STR_CHUNK_SIZE 32
+
+// A disabled flag or field width reads as a constant 0, so the code that
+// honors it folds away.
+#if MU_PRINTF_ENABLE_FLAGS
+#define PAD_FLAG(directive, name) ((directive)->flags.name)
+#define SET_FLAG(directive, name) ((directive)->flags.name = 1)
+#else
+#define PAD_FLAG(directive, name) 0
+#define SET_FLAG(directive, name) ((void)0)
+#endif
+
+#if MU_PRINTF_ENABLE_WIDTH
+#define FIELD_WIDTH(directive) ((directive)->width)
+#else
+#define FIELD_WIDTH(directive) 0
+#endif
+
+// A machine word of chars, read through a type that may alias them.
+typedef uintptr_t __attribute__((__may_alias__)) swar_word_t;
+
+#define SWAR_ONES ((swar_word_t)-1 / 0xff)  // 0x01 in every byte
+#define SWAR_HIGHS (SWAR_ONES * 0x80)       // 0x80 in every byte
+
+// nonzero if any byte of w is less than n, for n <= 0x80
+#define SWAR_HAS_LESS(w, n) (((w) - SWAR_ONES * (n)) & ~(w) & SWAR_HIGHS)
+
+// nonzero if any byte of w equals ch
+#define SWAR_HAS_BYTE(w, ch) SWAR_HAS_LESS((w) ^ (SWAR_ONES * (ch)), 1)
+
+// digit lookup tables for the power-of-two kernels
+static const char s_lower_digits[] = "0123456789abcdef";
+static const char s_upper_digits[] = "0123456789ABCDEF";
+
+// "00" through "99": decimal digits are converted two at a time
+static const char s_digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// 10^n for each n where it fits an unsigned int: the decimal digit count
+// thresholds for mu_count_digits()
+static const unsigned int s_pow10_table[] = {
+  1u, 10u, 100u, 1000u, 10000u,
+#if UINT_MAX > 0xffffu
+  100000u, 1000000u, 10000000u, 100000000u, 1000000000u
+#endif
+};
+
+#define POW10_TABLE_LENGTH \
+  ((int)(sizeof(s_pow10_table) / sizeof(s_pow10_table[0])))
 
 // ======================================================================
 // Code
@@ -43,6 +179,7 @@ int mu_null_emitter(void *obj, const char c) {
   return 1;
 }
 
+#if MU_PRINTF_ENABLE_FLOAT
 float mu_precision(float v, int ndigits) {
   if (v == 0.0) {
     return 0.0;
@@ -55,6 +192,7 @@ float mu_precision(float v, int ndigits) {
   float v3 = v2 / p10;
   return v3;
 }
+#endif
 
 int mu_emit_char(emitter_t emitter_fn, void *obj, const char c) {
   emitter_fn(obj, c);
@@ -68,6 +206,9 @@ int mu_emit_char(emitter_t emitter_fn, void *obj, const char c) {
 int mu_emit_pad(emitter_t emitter_fn, void *obj, const char c, int n) {
   int i;
 
+  if (emitter_fn == mu_sink_emitter) {
+    return n > 0 ? sink_write((mu_sink_t *)obj, (void *)0, c, n) : 0;
+  }
   for (i=0; i<n; i++) {
     mu_emit_char(emitter_fn, obj, c);
   }
@@ -76,24 +217,150 @@ int mu_emit_pad(emitter_t emitter_fn, void *obj, const char c, int n) {
 
 /*
  * Emit characters from str until a null is found or limit is reached, whichever
- * comes first.  A negative limit means no limit.
+ * comes first.  A negative limit means no limit.  No char at or beyond the
+ * limit is read, so str need not be null terminated when a limit is given.
+ *
+ * The string is passed to mu_emit_block() straight from str, STR_CHUNK_SIZE
+ * chars at a time: each chunk is scanned for the null and then emitted, so the
+ * cost follows the number of chars printed rather than the length of str.
  */
 int mu_emit_str(emitter_t emitter_fn, void *obj, const char *str, int limit) {
-  char ch;
+  unsigned int remaining = limit;  // a negative limit becomes "very large"
   int n_printed = 0;
-  while((ch = *str++) && (limit != 0)) {
-    n_printed += mu_emit_char(emitter_fn, obj, ch);
-    limit -= 1;
+
+  if (emitter_fn == mu_sink_emitter) {
+    // find the end a word at a time, then copy it in one piece
+    int n = mu_strnlen(str, limit < 0 ? 0x7fffffff : limit);
+    return sink_write((mu_sink_t *)obj, str, 0, n);
+  }
+  while (remaining > 0) {
+    int n_chunk = mu_strnlen(str, MIN(remaining, (unsigned int)STR_CHUNK_SIZE));
+    n_printed += mu_emit_block(emitter_fn, obj, str, n_chunk);
+    if (n_chunk < STR_CHUNK_SIZE) {
+      break;  // found the null or reached the limit
+    }
+    str += n_chunk;
+    remaining -= n_chunk;
   }
   return n_printed;
 }
 
+int mu_emit_block(emitter_t emitter_fn, void *obj, const char *buf, int n) {
+  int i;
+
+  if (emitter_fn == mu_sink_emitter) {
+    return sink_write((mu_sink_t *)obj, buf, 0, n);
+  }
+  for (i=0; i<n; i++) {
+    mu_emit_char(emitter_fn, obj, buf[i]);
+  }
+  return i;
+}
+
 int mu_strlen(char const *str) {
   int len = 0;
   while (*str++) len++;
   return len;
 }
 
+/*
+ * Return the length of str, but look at no more than limit chars.
+ */
+__attribute__((__no_sanitize_address__))
+int mu_strnlen(char const *str, int limit) {
+  int len = 0;
+
+  // a word at a time once aligned: see clean_run() for why this is safe
+  while (len < limit && ((uintptr_t)&str[len] % sizeof(swar_word_t)) != 0) {
+    if (str[len] == '\0') {
+      return len;
+    }
+    len++;
+  }
+  while (limit - len >= (int)sizeof(swar_word_t) &&
+         !SWAR_HAS_LESS(*(swar_word_t const *)&str[len], 1)) {
+    len += sizeof(swar_word_t);
+  }
+  while (len < limit && str[len]) len++;
+  return len;
+}
+
+int mu_sink_emitter(void *obj, char ch) {
+  mu_sink_t *sink = (mu_sink_t *)obj;
+  int n = 1;
+  char *dst = sink->vtable->reserve(sink, &n);
+
+  if (n > 0) {
+    *dst = ch;
+    sink->vtable->commit(sink, 1);
+  }
+  return 1;
+}
+
+/*
+ * Copy n chars from buf into sink, or n copies of fill if buf is NULL, taking
+ * as many reservations as the sink needs to provide the room.  Chars that
+ * find the sink full are dropped.  Returns n.
+ */
+int sink_write(mu_sink_t *sink, char const *buf, char fill, int n) {
+  int remaining = n;
+
+  while (remaining > 0) {
+    int room = remaining;
+    char *dst = sink->vtable->reserve(sink, &room);
+    if (room <= 0) {
+      break;  // full: drop the rest
+    }
+    if (room < 16) {
+      // too short to be worth a call to memcpy() or memset()
+      int i;
+      for (i=0; i<room; i++) {
+        dst[i] = buf ? *buf++ : fill;
+      }
+    } else if (buf) {
+      __builtin_memcpy(dst, buf, room);
+      buf += room;
+    } else {
+      __builtin_memset(dst, fill, room);
+    }
+    sink->vtable->commit(sink, room);
+    remaining -= room;
+  }
+  return n;
+}
+
+/*
+ * If emitter_fn is mu_sink_emitter, reserve room for exactly n chars in the
+ * sink and return a pointer to it, to be passed to sink_commit() once filled.
+ * Returns NULL for other emitters, or if the sink can't provide n chars in
+ * one piece, in which case the caller formats into its own buffer instead.
+ */
+char *sink_reserve(emitter_t emitter_fn, void *obj, int n) {
+  if (emitter_fn != mu_sink_emitter) {
+    return (void *)0;
+  }
+  mu_sink_t *sink = (mu_sink_t *)obj;
+  int room = n;
+  char *dst = sink->vtable->reserve(sink, &room);
+  return room >= n ? dst : (void *)0;
+}
+
+void sink_commit(void *obj, int n) {
+  mu_sink_t *sink = (mu_sink_t *)obj;
+  sink->vtable->commit(sink, n);
+}
+
+/*
+ * Tell a sink that the current call has written all of its output.
+ */
+void sink_end(emitter_t emitter_fn, void *obj) {
+  mu_sink_t *sink = (mu_sink_t *)obj;
+  if (emitter_fn == mu_sink_emitter && sink->vtable->end) {
+    sink->vtable->end(sink);
+  }
+}
+
+#if MU_PRINTF_ENABLE_FLOAT
 int mu_floor_log10(float x) {
   int p = 0;
   while (x < 1.0) {
@@ -112,8 +379,11 @@ float mu_pow10(int p) {
   if (p < 0) {
     float r1 = 1.0 / mu_pow10(-p);
     return r1;
+  } else if (p < POW10_TABLE_LENGTH) {
+    // exact in a float, so the same as the product below
+    return s_pow10_table[p];
   }
-  int x = 10;
+  float x = 10.0;  // 10^16 and up overflow an int
   float res = 1.0;
   while (p > 0) {
     if (p & 1) {
@@ -124,6 +394,7 @@ float mu_pow10(int p) {
   }
   return res;
 }
+#endif
 
 char int_to_digit(unsigned int v, int base, bool upper) {
   int rem = v % base;
@@ -136,54 +407,273 @@ char int_to_digit(unsigned int v, int base, bool upper) {
   }
 }
 
+/*
+ * Return log2(base) if base is 2, 4, 8 or 16, otherwise return 0.
+ */
+int pow2_shift(unsigned int base) {
+  switch(base) {
+  case 2: return 1;
+  case 4: return 2;
+  case 8: return 3;
+  case 16: return 4;
+  default: return 0;
+  }
+}
+
+int mu_count_digits(unsigned int v, unsigned int base) {
+  if (v == 0) {
+    return 0;
+  }
+  int n_bits = UINT_BITS - __builtin_clz(v);
+  int shift = pow2_shift(base);
+  if (shift) {
+    // one digit for every `shift` bits, rounded up
+    return (n_bits + shift - 1) / shift;
+  } else if (base == 10 && (n_bits * 1233) >> 12 < POW10_TABLE_LENGTH) {
+    // 1233/4096 approximates log10(2): estimate, then correct by one
+    int n = (n_bits * 1233) >> 12;
+    return n + (v >= s_pow10_table[n] ? 1 : 0);
+  }
+  int n = 0;
+  while (v) {
+    v /= base;
+    n++;
+  }
+  return n;
+}
+
 int mu_emit_integer(
     emitter_t emitter_fn,
     void *obj,
     unsigned int v,
     unsigned int base,
     bool upper) {
+  // digits are written backwards into buf: base 2 needs the most room
+  char buf[UINT_BITS];
+  char *end = buf + UINT_BITS;
+  char *p = end;
+  int shift = pow2_shift(base);
+  char *direct;
+
   if (v == 0) {
     return 0;
   }
-  int n = mu_emit_integer(emitter_fn, obj, v / base, base, upper);
-  mu_emit_char(emitter_fn, obj, int_to_digit(v, base, upper));
-  return n + 1;
+  // a sink with room gets the digits converted in place
+  int n_digits = emitter_fn == mu_sink_emitter ? mu_count_digits(v, base) : 0;
+  if ((direct = sink_reserve(emitter_fn, obj, n_digits))) {
+    end = direct + n_digits;
+    p = end;
+  }
+  if (shift) {
+    p = format_pow2(end, v, shift, upper);
+  } else if (base == 10) {
+    p = format_decimal(end, v);
+  } else {
+    while (v) {
+      *--p = int_to_digit(v, base, upper);
+      v /= base;
+    }
+  }
+  if (direct) {
+    sink_commit(obj, n_digits);
+    return n_digits;
+  }
+  return mu_emit_block(emitter_fn, obj, p, end - p);
+}
+
+/*
+ * Write the decimal digits of v so that the last digit lands just before end,
+ * converting two digits per step.  Returns a pointer to the first digit.
+ * Zero is written as "0".
+ */
+char *format_decimal(char *end, unsigned int v) {
+  while (v >= 100) {
+    unsigned int pair = (v % 100) * 2;
+    v /= 100;
+    *--end = s_digit_pairs[pair + 1];
+    *--end = s_digit_pairs[pair];
+  }
+  if (v >= 10) {
+    *--end = s_digit_pairs[v * 2 + 1];
+    *--end = s_digit_pairs[v * 2];
+  } else {
+    *--end = v + '0';
+  }
+  return end;
+}
+
+/*
+ * Write v in base 2^shift so that the last digit lands just before end.
+ * Returns a pointer to the first digit.  No division is needed: each digit is
+ * a shift and mask of v, looked up in a digit table.
+ */
+char *format_pow2(char *end, unsigned int v, int shift, bool upper) {
+  char const *digits = upper ? s_upper_digits : s_lower_digits;
+  unsigned int mask = (1u << shift) - 1;
+
+  do {
+    *--end = digits[v & mask];
+    v >>= shift;
+  } while (v);
+  return end;
+}
+
+#if MU_PRINTF_ENABLE_FLOAT
+/*
+ * Floats are emitted in two passes over the digit positions rather than by
+ * recursing once per digit.  The digit at 10^p is
+ *   ((unsigned)(v * 10^-p) + carry) % 10
+ * where the rounding carry enters at p = -precision and survives only through
+ * 9s.  float_layout() finds how far the carry travels and where the leading
+ * digit is, which is enough to know the length, usually in a handful of
+ * steps; emit_float_layout() then walks down from the leading digit, emitting
+ * digits as it goes.  Neither needs more than a fixed chunk buffer of stack,
+ * whatever the value or precision.
+ */
+#define FLOAT_CHUNK_SIZE 16
+// 10^39 exceeds FLT_MAX, so every finite float runs out of digits by then
+#define FLOAT_MAX_DECADE 39
+
+/*
+ * 10^p as a double.  A float scaled by it in float arithmetic rounds away
+ * digits past the seventh or so; in a double every digit a float has is kept.
+ */
+double float_scale(int p) {
+  unsigned int n = p < 0 ? -p : p;
+  double x = 10.0;
+  double res = 1.0;
+
+  while (n > 0) {
+    if (n & 1) {
+      res = res * x;
+    }
+    x = x * x;
+    n >>= 1;
+  }
+  return p < 0 ? 1.0 / res : res;
+}
+
+/*
+ * v * 10^-p, cut down to fit an unsigned int.  Only the last digit of the
+ * integer part is ever used, and whether the part is zero, so past UINT_MAX
+ * the part keeps its last digits above an offset that leaves it nonzero.
+ * Past 2^64 a double has no units digit left to keep, and the digit is 0.
+ * Kept out of line: inlined, it grows the frames of the float layout code.
+ */
+__attribute__((__noinline__))
+double float_scaled(float v, int p) {
+  double x = v * float_scale(-p);
+  unsigned int modulus = s_pow10_table[POW10_TABLE_LENGTH - 1];
+  uint64_t integer_part;
+
+  if (x <= UINT_MAX) {
+    return x;
+  } else if (x - x != 0) {
+    return 0;  // infinity or NaN: no digits
+  } else if (x >= 18446744073709551616.0) {
+    return modulus;
+  }
+  integer_part = x;
+  return modulus + integer_part % modulus + (x - integer_part);
+}
+
+// The integer part of v * 10^-p: its last digit is the digit of v at 10^p.
+unsigned int float_digits_at(float v, int p) {
+  return float_scaled(v, p);
 }
 
 int mu_emit_float(emitter_t emitter,
                   void *obj,
                   float v,
                   unsigned int precision) {
+  float_layout_t layout;
+
+  float_layout(&layout, v, precision);
+  return emit_float_layout(emitter, obj, &layout);
+}
+
+int float_layout(float_layout_t *layout, float v, unsigned int precision) {
   // preamble: decide if lowest order digit is subject to rounding
-  float scaled_v = v * mu_pow10(precision);
-  bool round_up = (scaled_v - (int)scaled_v) >= 0.5;
-  return emit_float_aux(emitter, obj, v, -precision, round_up);
-}
-
-// emit the digit in the 10^pow10 position after emitting higher-order digits
-int emit_float_aux(emitter_t emitter, void *obj, float v, int pow10, bool round_up) {
-  unsigned int scaled_vi = v * mu_pow10(-pow10);
-  if (scaled_vi == 0 && pow10 > 0) {
-    // Endgame: emit a final 1 if rounding carried over
-    if (round_up) {
-      mu_emit_char(emitter, obj, '1');
-      return 1;
-    } else {
-      return 0;
+  double scaled_v = float_scaled(v, -(int)precision);
+  bool carry = (scaled_v - (unsigned int)scaled_v) >= 0.5;
+  int p = -(int)precision;
+  int top;
+
+  layout->v = v;
+  layout->precision = precision;
+  layout->carry_limit = p - 1;
+  // the rounding carry travels up through 9s only, so this usually stops at
+  // the first digit
+  for (; carry && p <= FLOAT_MAX_DECADE; p++) {
+    unsigned int scaled_vi = float_digits_at(v, p);
+    if (scaled_vi == 0 && p > 0) {
+      break;
     }
+    layout->carry_limit = p;
+    carry = (scaled_vi % 10) == 9;
   }
-  // extract least significant digit at current power of 10
-  int digit = (scaled_vi + (round_up ? 1 : 0)) % 10;
-  // emit higher order digits
-  int n = emit_float_aux(emitter, obj, v, pow10 + 1, round_up && (digit == 0));
-  // is it time to print the decimal point?
-  if (pow10 == -1) {
-    mu_emit_char(emitter, obj,'.');
-    n += 1;
+  if (carry) {
+    // rounding carried into a new leading digit
+    top = p;
+  } else {
+    // The leading digit is at the lowest p > 0 (and above any carry) where
+    // v * 10^-p truncates to 0.  Start from the width of the integer part
+    // and step to the exact position; v * 10^-p never grows with p, so this
+    // takes a step or two at most.
+    int lowest = MAX(p, 1);
+    top = MAX(lowest, mu_count_digits(float_digits_at(v, 0), 10));
+    while (top > lowest && float_digits_at(v, top - 1) == 0) {
+      top--;
+    }
+    while (top <= FLOAT_MAX_DECADE && float_digits_at(v, top) != 0) {
+      top++;
+    }
+  }
+  layout->top = top;
+  layout->carry_out = carry;
+  return float_layout_length(layout);
+}
+
+int float_layout_length(float_layout_t const *layout) {
+  // digits, decimal point, and a leading '1' if rounding carried over
+  return (layout->top + layout->precision) +
+      (layout->precision > 0 ? 1 : 0) +
+      (layout->carry_out ? 1 : 0);
+}
+
+int emit_float_layout(emitter_t emitter, void *obj, float_layout_t const *layout) {
+  char chunk[FLOAT_CHUNK_SIZE];
+  // a sink with room for the whole number gets it written in place
+  char *direct = sink_reserve(emitter, obj, float_layout_length(layout));
+  char *out = direct ? direct : chunk;
+  int n_chunk = 0;
+  int n = 0;
+  int p;
+
+  if (layout->carry_out) {
+    out[n_chunk++] = '1';
+  }
+  for (p = layout->top - 1; p >= -layout->precision; p--) {
+    unsigned int scaled_vi = float_digits_at(layout->v, p);
+    int round_up = p <= layout->carry_limit ? 1 : 0;
+    // is it time to print the decimal point?
+    if (p == -1) {
+      out[n_chunk++] = '.';
+    }
+    out[n_chunk++] = (scaled_vi + round_up) % 10 + '0';
+    // leave room for a '.' and a digit on the next pass
+    if (!direct && n_chunk > FLOAT_CHUNK_SIZE - 2) {
+      n += mu_emit_block(emitter, obj, chunk, n_chunk);
+      n_chunk = 0;
+    }
+  }
+  if (direct) {
+    sink_commit(obj, n_chunk);
+    return n_chunk;
   }
-  mu_emit_char(emitter, obj, digit + '0');
-  return n + 1;
+  return n + mu_emit_block(emitter, obj, chunk, n_chunk);
 }
+#endif
 
 int mu_printf(emitter_t emitter_fn, void *obj, const char *fmt_s, ...) {
   va_list ap;
@@ -200,6 +690,8 @@ int mu_vprintf(emitter_t emitter_fn, void *obj, char const *fmt, va_list args) {
   char ch;
   mu_directive_t directive;
   int n_printed = 0;
+  char const *fmt_start = fmt;
+  uint32_t call_t0 = stats_now();
 
   directive.emitter_fn = emitter_fn;
   directive.emitter_arg = obj;
@@ -207,13 +699,25 @@ int mu_vprintf(emitter_t emitter_fn, void *obj, char const *fmt, va_list args) {
   // toplevel
   while ((ch = *fmt++)) {
     if ('%' == ch) {
+      uint32_t t0 = stats_now();
       fmt = mu_parse_directive(&directive, fmt);
-      n_printed += process_directive(&directive, args);
+      int n = process_directive(&directive, args);
+      stats_conversion(directive.conversion, n, t0);
+      n_printed += n;
     } else {
-      mu_emit_char(emitter_fn, obj, ch);  // process ordinary character
-      n_printed += 1;
+      // ordinary chars up to the next directive go out as one block
+      char const *literal = fmt - 1;
+      while (*fmt && *fmt != '%') {
+        fmt++;
+      }
+      n_printed += mu_emit_block(emitter_fn, obj, literal, fmt - literal);
     }
   }
+  sink_end(emitter_fn, obj);
+  stats_format(fmt_start, n_printed, call_t0);
+#if MU_PRINTF_ENABLE_PROFILE
+  mu_profile_record(fmt_start, n_printed);
+#endif
   return n_printed;
 }
 
@@ -224,25 +728,26 @@ char const *mu_parse_directive(mu_directive_t *directive, char const *fmt) {
   directive->width = 0;
   directive->precision = MU_PRECISION_NOT_GIVEN;
 
-  // parse #0- + flags...
+  // parse #0- + flags...  A disabled flag or width is still consumed, so the
+  // conversion and the arguments stay in step; it just has no effect.
   bool parsing_flags = true;
   while(parsing_flags) {
     ch = *fmt;
     switch(ch) {
     case '#':
-      directive->flags.alternate_form = 1;
+      SET_FLAG(directive, alternate_form);
       break;
     case '0':
-      directive->flags.pad_zero = 1;
+      SET_FLAG(directive, pad_zero);
       break;
     case '-':
-      directive->flags.pad_right = 1;
+      SET_FLAG(directive, pad_right);
       break;
     case ' ':
-      directive->flags.pad_space = 1;
+      SET_FLAG(directive, pad_space);
       break;
     case '+':
-      directive->flags.pad_plus = 1;
+      SET_FLAG(directive, pad_plus);
       break;
     default:
       parsing_flags = false;
@@ -251,12 +756,17 @@ char const *mu_parse_directive(mu_directive_t *directive, char const *fmt) {
       fmt++;
     }
   }
+#if MU_PRINTF_ENABLE_FLAGS
   // fix mutual exclusions
   if (directive->flags.pad_right) directive->flags.pad_zero = 0;
   if (directive->flags.pad_plus) directive->flags.pad_space = 0;
+#endif
 
   // parse field width
   fmt = parse_decimal(&directive->width, fmt);
+#if !MU_PRINTF_ENABLE_WIDTH
+  directive->width = 0;
+#endif
 
   // parse precision
   if (*fmt == '.') {
@@ -302,8 +812,10 @@ int process_directive(mu_directive_t *directive, va_list arg) {
   case '%':
     return process_c_directive(directive, '%');
 
+#if MU_PRINTF_ENABLE_BINARY
   case 'b':
     return process_u_directive(directive, va_arg(arg, unsigned int), 2);
+#endif
 
   case 'c':
     return process_c_directive(directive, va_arg(arg, unsigned int));
@@ -312,17 +824,25 @@ int process_directive(mu_directive_t *directive, va_list arg) {
   case 'i':
     return process_d_directive(directive, va_arg(arg, int));
 
+#if MU_PRINTF_ENABLE_E
   case 'E':
   case 'e':
     return process_e_directive(directive, va_arg(arg, double));
+#endif
 
+#if MU_PRINTF_ENABLE_FLOAT
   case 'F':
   case 'f':
     return process_f_directive(directive, va_arg(arg, double));
+#endif
 
   case 'o':
     return process_u_directive(directive, va_arg(arg, unsigned int), 8);
 
+#if MU_PRINTF_ENABLE_ESCAPE
+  case 'j':
+  case 'q':
+#endif
   case 's':
     return process_s_directive(directive, va_arg(arg, char const *));
 
@@ -345,6 +865,35 @@ int process_c_directive(mu_directive_t *directive, unsigned int ch) {
   return mu_emit_char(directive->emitter_fn, directive->emitter_arg, ch);
 }
 
+/*
+ * Return the sign or base prefix printed just before the digits of an
+ * integer.  n_required is the number of digits that will be printed.
+ */
+char const *integer_prefix(mu_directive_t *directive,
+                           unsigned int v,
+                           bool is_negative,
+                           int base,
+                           unsigned int n_required) {
+  if (is_negative) {
+    return "-";
+  } else if (n_required == 0) {
+    // precision = 0 and value = 0 -- no prefix
+  } else if (PAD_FLAG(directive, pad_plus)) {
+    return "+";
+  } else if (PAD_FLAG(directive, pad_space)) {
+    return " ";
+  } else if ((directive->flags.alternate_form) && (v != 0)) {
+    if (base == 2) {
+      return directive->flags.upper_case ? "0B" : "0b";
+    } else if (base == 8) {
+      return "0";
+    } else if (base == 16) {
+      return directive->flags.upper_case ? "0X" : "0x";
+    }
+  }
+  return "";
+}
+
 int process_diox_directive(mu_directive_t *directive,
                            unsigned int v,
                            bool is_negative,
@@ -353,7 +902,7 @@ int process_diox_directive(mu_directive_t *directive,
   unsigned int n_required;     // # of digits that must be printed
 
   // how many digits will be printed?
-  n_significant = mu_emit_integer(mu_null_emitter, (void *)0, v, base, false);
+  n_significant = mu_count_digits(v, base);
   if (directive->precision == MU_PRECISION_NOT_GIVEN) {
     n_required = MAX(1, n_significant);
   } else {
@@ -362,39 +911,16 @@ int process_diox_directive(mu_directive_t *directive,
   }
 
   // what are we printing just before the digits?
-  char *prefix = "";
-  char n_extra = 0;
-  if (is_negative) {
-    prefix = "-";
-    n_extra = 1;
-  } else if (n_required == 0) {
-    // precision = 0 and value = 0 -- no prefix
-  } else if (directive->flags.pad_plus) {
-    prefix = "+";
-    n_extra = 1;
-  } else if (directive->flags.pad_space) {
-    prefix = " ";
-    n_extra = 1;
-  } else if ((directive->flags.alternate_form) && (v != 0)) {
-    if (base == 2) {
-      prefix = (directive->flags.upper_case ? "0B" : "0b");
-      n_extra = 2;
-    } else if (base == 8) {
-      prefix = "0";
-      n_extra = 1;
-    } else if (base == 16) {
-      prefix = (directive->flags.upper_case ? "0X" : "0x");
-      n_extra = 2;
-    }
-  }
+  char const *prefix = integer_prefix(directive, v, is_negative, base, n_required);
+  char n_extra = mu_strlen(prefix);
 
   // how many pad characters will we print?
-  int padding = directive->width - n_required - n_extra;
+  int padding = FIELD_WIDTH(directive) - n_required - n_extra;
 
   // now output:
   int n_emitted = 0;
   // ...leading spaces
-  if (!directive->flags.pad_right && !directive->flags.pad_zero) {
+  if (!PAD_FLAG(directive, pad_right) && !PAD_FLAG(directive, pad_zero)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              ' ',
@@ -406,7 +932,7 @@ int process_diox_directive(mu_directive_t *directive,
                            prefix,
                            -1);
   // ...zero padding
-  if (directive->flags.pad_zero) {
+  if (PAD_FLAG(directive, pad_zero)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              '0',
@@ -424,7 +950,7 @@ int process_diox_directive(mu_directive_t *directive,
                        base,
                        directive->flags.upper_case);
 
-  if (directive->flags.pad_right) {
+  if (PAD_FLAG(directive, pad_right)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              ' ',
@@ -446,6 +972,48 @@ int process_d_directive(mu_directive_t *directive, int v) {
                                 10);
 }
 
+#if MU_PRINTF_ENABLE_FLOAT
+/*
+ * Return the sign printed before a float: "-", or "+" or " " if asked for.
+ */
+char const *sign_prefix(mu_directive_t *directive, bool is_negative) {
+  if (is_negative) {
+    return "-";
+  } else if (PAD_FLAG(directive, pad_plus)) {
+    return "+";
+  } else if (PAD_FLAG(directive, pad_space)) {
+    return " ";
+  }
+  return "";
+}
+#endif
+
+#if MU_PRINTF_ENABLE_E
+/*
+ * Lay out the mantissa of a non-negative v for %e and return its exponent.
+ * v is scaled so that 1.0 <= v < 10 (unless it is zero), and rescaled if
+ * rounding would carry the mantissa to 10, so 9.99 prints as 1.0e+01.
+ */
+int e_layout(float_layout_t *layout, double v, unsigned int precision) {
+  int exponent = 0;
+  if (v != 0.0) {
+    while (v >= 10) {
+      v = v / 10;
+      exponent += 1;
+    }
+    while (v < 1.0) {
+      v = v * 10;
+      exponent -= 1;
+    }
+  }
+  float_layout(layout, v, precision);
+  if (layout->carry_out) {
+    exponent += 1;
+    float_layout(layout, v / 10, precision);
+  }
+  return exponent;
+}
+
 /*
  * Process a float using n.nnne+xx format
  */
@@ -456,25 +1024,13 @@ int process_e_directive(mu_directive_t *directive, double v) {
   unsigned int exponent_width;
   int exponent;
   bool exponent_is_neg = false;
+  float_layout_t layout;
 
   if (directive->precision == MU_PRECISION_NOT_GIVEN) {
     directive->precision = 6;
   }
 
-  exponent = 0;
-  if (v != 0.0) {
-    // normalize v
-    while (v >= 10) {
-      v = v / 10;
-      exponent += 1;
-    }
-    while (v < 1.0) {
-      v = v * 10;
-      exponent -= 1;
-    }
-  }
-  // at this point, 1.0 <= v < 10 (unless v is zero), and exponent is the power
-  // of 10 that will restore it to its original value.
+  exponent = e_layout(&layout, v, directive->precision);
 
   // how wide is the mantissa?
   mantissa_width = 1 + directive->precision;
@@ -487,33 +1043,19 @@ int process_e_directive(mu_directive_t *directive, double v) {
     exponent = -exponent;
     exponent_is_neg = true;
   }
-  exponent_width = mu_emit_integer(mu_null_emitter,
-                                   (void *) 0,
-                                   exponent,
-                                   10,
-                                   false);
+  exponent_width = mu_count_digits(exponent, 10);
   // what prefix gets printed just before the mantissa?
-  char *prefix = "";
-  char n_extra = 0;
-  if (mantissa_is_neg) {
-    prefix = "-";
-    n_extra = 1;
-  } else if (directive->flags.pad_plus) {
-    prefix = "+";
-    n_extra = 1;
-  } else if (directive->flags.pad_space) {
-    prefix = " ";
-    n_extra = 1;
-  }
+  char const *prefix = sign_prefix(directive, mantissa_is_neg);
+  char n_extra = mu_strlen(prefix);
 
   // how many pad characters will we print?
-  int padding = directive->width - n_extra - mantissa_width - 2 -
+  int padding = FIELD_WIDTH(directive) - n_extra - mantissa_width - 2 -
       MAX(2, exponent_width);
 
   // now output:
   int n_emitted = 0;
   // ...leading spaces
-  if (!directive->flags.pad_right && !directive->flags.pad_zero) {
+  if (!PAD_FLAG(directive, pad_right) && !PAD_FLAG(directive, pad_zero)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              ' ',
@@ -525,17 +1067,16 @@ int process_e_directive(mu_directive_t *directive, double v) {
                            prefix,
                            -1);
   // ...zero padding
-  if (directive->flags.pad_zero) {
+  if (PAD_FLAG(directive, pad_zero)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              '0',
                              padding);
   }
   // ...the mantissa
-  n_emitted += mu_emit_float(directive->emitter_fn,
-                       directive->emitter_arg,
-                       v,
-                       directive->precision);
+  n_emitted += emit_float_layout(directive->emitter_fn,
+                                 directive->emitter_arg,
+                                 &layout);
   // ...any explicit trailing '.'
   if (directive->precision == 0 && directive->flags.alternate_form) {
     n_emitted += mu_emit_char(directive->emitter_fn,
@@ -553,13 +1094,13 @@ int process_e_directive(mu_directive_t *directive, double v) {
                            directive->emitter_arg,
                            '0',
                            2 - exponent_width);
-  n_emitted += mu_emit_integer(mu_null_emitter,
-                               (void *) 0,
+  n_emitted += mu_emit_integer(directive->emitter_fn,
+                               directive->emitter_arg,
                                exponent,
                                10,
                                false);
   // ...trailing padding
-  if (directive->flags.pad_right) {
+  if (PAD_FLAG(directive, pad_right)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              ' ',
@@ -568,7 +1109,9 @@ int process_e_directive(mu_directive_t *directive, double v) {
 
   return n_emitted;
 }
+#endif
 
+#if MU_PRINTF_ENABLE_FLOAT
 /*
  * Process a float
  */
@@ -576,26 +1119,17 @@ int process_f_directive(mu_directive_t *directive, double v) {
   bool is_negative = v < 0;
   if (is_negative) v = -v;
   unsigned int n_characters;  // # of chars in atof(v)
+  float_layout_t layout;
 
   if (directive->precision == MU_PRECISION_NOT_GIVEN) {
     directive->precision = 6;
   }
   // how many digits will be printed?
-  n_characters = mu_emit_float(mu_null_emitter, (void *)0, v, directive->precision);
+  n_characters = float_layout(&layout, v, directive->precision);
 
   // what are we printing just before the digits?
-  char *prefix = "";
-  char n_extra = 0;
-  if (is_negative) {
-    prefix = "-";
-    n_extra = 1;
-  } else if (directive->flags.pad_plus) {
-    prefix = "+";
-    n_extra = 1;
-  } else if (directive->flags.pad_space) {
-    prefix = " ";
-    n_extra = 1;
-  }
+  char const *prefix = sign_prefix(directive, is_negative);
+  char n_extra = mu_strlen(prefix);
 
   // are we going to print an explicit trailing '.'?
   if (directive->precision == 0 && directive->flags.alternate_form) {
@@ -603,12 +1137,12 @@ int process_f_directive(mu_directive_t *directive, double v) {
   }
 
   // how many pad characters will we print?
-  int padding = directive->width - n_characters - n_extra;
+  int padding = FIELD_WIDTH(directive) - n_characters - n_extra;
 
   // now output:
   int n_emitted = 0;
   // ...leading spaces
-  if (!directive->flags.pad_right && !directive->flags.pad_zero) {
+  if (!PAD_FLAG(directive, pad_right) && !PAD_FLAG(directive, pad_zero)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              ' ',
@@ -620,17 +1154,16 @@ int process_f_directive(mu_directive_t *directive, double v) {
                            prefix,
                            -1);
   // ...zero padding
-  if (directive->flags.pad_zero) {
+  if (PAD_FLAG(directive, pad_zero)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              '0',
                              padding);
   }
   // ... the value itself
-  n_emitted += mu_emit_float(directive->emitter_fn,
-                       directive->emitter_arg,
-                       v,
-                       directive->precision);
+  n_emitted += emit_float_layout(directive->emitter_fn,
+                                 directive->emitter_arg,
+                                 &layout);
   // ... explicit trailing '.'
   if (directive->precision == 0 && directive->flags.alternate_form) {
     n_emitted += mu_emit_char(directive->emitter_fn,
@@ -638,7 +1171,7 @@ int process_f_directive(mu_directive_t *directive, double v) {
                               '.');
   }
   // ... trailing padding
-  if (directive->flags.pad_right) {
+  if (PAD_FLAG(directive, pad_right)) {
     n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
                              ' ',
@@ -648,6 +1181,7 @@ int process_f_directive(mu_directive_t *directive, double v) {
   return n_emitted;
 
 }
+#endif
 
 /*
  * Process an unsigned integer in one of several bases...
@@ -657,35 +1191,984 @@ int process_u_directive(mu_directive_t *directive, unsigned int v, int base) {
 }
 
 int process_s_directive(mu_directive_t *directive, char const *str) {
-  // how many characters in str are we going to print?
-  int slimit = mu_strlen(str);
-  if ((directive->precision != MU_PRECISION_NOT_GIVEN) &&
-      (directive->precision < slimit)) {
-    slimit = directive->precision;
+  int limit = -1;  // no limit
+  int n_emitted = 0;
+
+  if (directive->precision != MU_PRECISION_NOT_GIVEN) {
+    limit = directive->precision;
   }
-  // how many pad chars are we going to print?
-  int padding = directive->width - slimit;
 
-  int n_emitted = 0;
+  if (FIELD_WIDTH(directive) == 0) {
+    // nothing to pad: stream the string without measuring it first
+    return emit_s_text(directive, str, limit);
+  }
 
-  if (directive->flags.pad_right) {
-    // output string then padding
-    n_emitted += mu_emit_str(directive->emitter_fn,
+  if (PAD_FLAG(directive, pad_right)) {
+    // output string then padding, which the printed count determines
+    n_emitted += emit_s_text(directive, str, limit);
+    n_emitted += mu_emit_pad(directive->emitter_fn,
+                             directive->emitter_arg,
+                             ' ',
+                             FIELD_WIDTH(directive) - n_emitted);
+  } else {
+    // output padding then string.  The padding only depends on whether the
+    // string is shorter than the field, so count no more than width chars.
+    n_emitted += mu_emit_pad(directive->emitter_fn,
                              directive->emitter_arg,
-                             str,
-                             slimit);
+                             ' ',
+                             FIELD_WIDTH(directive) -
+                               s_text_length(directive,
+                                             str,
+                                             limit,
+                                             FIELD_WIDTH(directive)));
+    n_emitted += emit_s_text(directive, str, limit);
   }
-  n_emitted += mu_emit_pad(directive->emitter_fn,
+  return n_emitted;
+}
+
+/*
+ * Emit the text of a %s argument, or its escaped form for %j and %q.  At most
+ * limit chars are taken from str (all of them if limit is negative).
+ */
+int emit_s_text(mu_directive_t *directive, char const *str, int limit) {
+#if MU_PRINTF_ENABLE_ESCAPE
+  if (directive->conversion != 's') {
+    return mu_emit_escaped(directive->emitter_fn,
                            directive->emitter_arg,
-                           ' ',
-                           padding);
-  if (!directive->flags.pad_right) {
-    // output padding then string
-    n_emitted += mu_emit_str(directive->emitter_fn,
-                             directive->emitter_arg,
-                             str,
-                             slimit);
+                           str,
+                           limit,
+                           directive->conversion == 'j');
+  }
+#endif
+  return mu_emit_str(directive->emitter_fn, directive->emitter_arg, str, limit);
+}
+
+/*
+ * Return the number of chars emit_s_text() would emit, but stop counting once
+ * max is reached.  A negative limit or max means no limit.
+ */
+int s_text_length(mu_directive_t *directive, char const *str, int limit, int max) {
+  unsigned int n;
+
+#if MU_PRINTF_ENABLE_ESCAPE
+  if (directive->conversion != 's') {
+    return escaped_length(str, limit, max, directive->conversion == 'j');
+  }
+#else
+  (void)directive;
+#endif
+  n = MIN((unsigned int)limit, (unsigned int)max);
+  return (n == (unsigned int)-1) ? mu_strlen(str) : mu_strnlen(str, n);
+}
+
+#if MU_PRINTF_ENABLE_ESCAPE
+// =============================================================================
+// escaped strings: %j (JSON) and %q (C)
+
+// the letters of the \a through \r escapes, for chars 0x07 through 0x0d
+static const char s_escape_letters[] = "abtnvfr";
+
+/*
+ * Return true if ch must be escaped: '"', '\\', DEL and the control chars,
+ * the terminating null among them.  Other chars, including the bytes of UTF-8
+ * sequences, are copied as they are.
+ */
+bool needs_escape(char ch) {
+  unsigned char c = ch;
+  return c < 0x20 || c == '"' || c == '\\' || c == 0x7f;
+}
+
+/*
+ * Return how many of the first limit chars of str need no escaping.
+ *
+ * Once str is word aligned, a whole word of chars is tested at a time with
+ * SWAR (SIMD within a register) arithmetic.  The word that holds the first
+ * char needing escape is finished a char at a time.  Words are only read when
+ * they lie wholly before limit, and an aligned word never crosses a page, so
+ * reading the chars after the null in the same word is harmless (though
+ * AddressSanitizer would report it, hence the attribute).
+ */
+__attribute__((__no_sanitize_address__))
+unsigned int clean_run(char const *str, unsigned int limit) {
+  unsigned int n = 0;
+
+  while (n < limit && ((uintptr_t)&str[n] % sizeof(swar_word_t)) != 0) {
+    if (needs_escape(str[n])) {
+      return n;
+    }
+    n += 1;
+  }
+  while (limit - n >= sizeof(swar_word_t)) {
+    swar_word_t w = *(swar_word_t const *)&str[n];
+    if (SWAR_HAS_LESS(w, 0x20) |
+        SWAR_HAS_BYTE(w, '"') |
+        SWAR_HAS_BYTE(w, '\\') |
+        SWAR_HAS_BYTE(w, 0x7f)) {
+      break;
+    }
+    n += sizeof(swar_word_t);
+  }
+  while (n < limit && !needs_escape(str[n])) {
+    n += 1;
+  }
+  return n;
+}
+
+/*
+ * Write the escape sequence for ch (a char for which needs_escape() is true)
+ * into buf, which must hold 6 chars, and return its length.  JSON has no \a,
+ * \v or octal escapes, so other control chars become \u00XX there, and \ooo
+ * (which, unlike \x, can't swallow a following hex digit) in C.
+ */
+int escape_char(char *buf, char ch, bool json) {
+  unsigned char c = ch;
+
+  buf[0] = '\\';
+  if (c == '"' || c == '\\') {
+    buf[1] = c;
+    return 2;
+  }
+  if (c >= '\a' && c <= '\r') {
+    buf[1] = s_escape_letters[c - '\a'];
+    if (!json || (buf[1] != 'a' && buf[1] != 'v')) {
+      return 2;
+    }
+  }
+  if (json) {
+    buf[1] = 'u';
+    buf[2] = '0';
+    buf[3] = '0';
+    buf[4] = s_lower_digits[c >> 4];
+    buf[5] = s_lower_digits[c & 0xf];
+    return 6;
+  }
+  buf[1] = '0' + (c >> 6);
+  buf[2] = '0' + ((c >> 3) & 7);
+  buf[3] = '0' + (c & 7);
+  return 4;
+}
+
+/*
+ * Runs of clean chars go to mu_emit_block() straight from str, so there is no
+ * separate pass and no temporary copy of the string.
+ */
+int mu_emit_escaped(emitter_t emitter_fn, void *obj, char const *str, int limit, bool json) {
+  unsigned int remaining = limit;  // a negative limit becomes "very large"
+  int n_emitted = 0;
+  char escape[6];
+
+  for (;;) {
+    unsigned int run = clean_run(str, remaining);
+    n_emitted += mu_emit_block(emitter_fn, obj, str, run);
+    str += run;
+    remaining -= run;
+    if (remaining == 0 || *str == '\0') {
+      break;
+    }
+    n_emitted += mu_emit_block(emitter_fn,
+                               obj,
+                               escape,
+                               escape_char(escape, *str++, json));
+    remaining -= 1;
   }
   return n_emitted;
 }
 
+/*
+ * Return the number of chars mu_emit_escaped() would emit, but stop counting
+ * once max is reached.  A negative max means no limit.
+ */
+int escaped_length(char const *str, int limit, int max, bool json) {
+  unsigned int remaining = limit;
+  unsigned int stop = max;
+  unsigned int n = 0;
+  char escape[6];
+
+  for (;;) {
+    unsigned int run = clean_run(str, MIN(remaining, stop - n));
+    n += run;
+    str += run;
+    remaining -= run;
+    if (remaining == 0 || n >= stop || *str == '\0') {
+      break;
+    }
+    n += escape_char(escape, *str++, json);
+    remaining -= 1;
+  }
+  return n;
+}
+#endif
+
+// =============================================================================
+// measuring output length
+
+int mu_measure(char const *fmt, ...) {
+  va_list ap;
+  int result;
+
+  va_start(ap, fmt);
+  result = mu_vmeasure(fmt, ap);
+  va_end(ap);
+
+  return result;
+}
+
+int mu_vmeasure(char const *fmt, va_list args) {
+  mu_directive_t directive;
+  int n_measured = 0;
+
+  // never called: measuring generates no characters
+  directive.emitter_fn = mu_null_emitter;
+  directive.emitter_arg = (void *)0;
+
+  while (*fmt) {
+    // a run of ordinary characters counts as its own length
+    char const *span = fmt;
+    while (*fmt && *fmt != '%') {
+      fmt++;
+    }
+    n_measured += fmt - span;
+    if (*fmt == '%') {
+      fmt = mu_parse_directive(&directive, fmt + 1);
+      n_measured += measure_directive(&directive, args);
+    }
+  }
+  return n_measured;
+}
+
+// =============================================================================
+// =============================================================================
+
+/*
+ * Return the number of chars process_directive() would emit, consuming the
+ * same argument.  Each measure_x_directive() mirrors process_x_directive():
+ * whatever the padding flags, a field is the larger of its width and its
+ * contents.
+ */
+int measure_directive(mu_directive_t *directive, va_list arg) {
+  switch(directive->conversion) {
+  case '%':
+    return 1;
+
+#if MU_PRINTF_ENABLE_BINARY
+  case 'b':
+    return measure_diox_directive(directive, va_arg(arg, unsigned int), false, 2);
+#endif
+
+  case 'c':
+    va_arg(arg, unsigned int);
+    return 1;
+
+  case 'd':
+  case 'i': {
+    int v = va_arg(arg, int);
+    bool is_negative = v < 0;
+    directive->flags.alternate_form = 0;  // %d doesn't honor %#d
+    return measure_diox_directive(directive, is_negative ? -v : v, is_negative, 10);
+  }
+
+#if MU_PRINTF_ENABLE_E
+  case 'e':
+    return measure_e_directive(directive, va_arg(arg, double));
+#endif
+
+#if MU_PRINTF_ENABLE_FLOAT
+  case 'f':
+    return measure_f_directive(directive, va_arg(arg, double));
+#endif
+
+  case 'o':
+    return measure_diox_directive(directive, va_arg(arg, unsigned int), false, 8);
+
+#if MU_PRINTF_ENABLE_ESCAPE
+  case 'j':
+  case 'q':
+#endif
+  case 's':
+    return measure_s_directive(directive, va_arg(arg, char const *));
+
+  case 'p':
+    directive->flags.alternate_form = true;
+    // fall through ---vvv
+  case 'x':
+    return measure_diox_directive(directive, va_arg(arg, unsigned int), false, 16);
+
+  default:
+    return 0;
+  }
+}
+
+int measure_diox_directive(mu_directive_t *directive,
+                           unsigned int v,
+                           bool is_negative,
+                           int base) {
+  // the digit count comes from the bit length of v: see mu_count_digits()
+  unsigned int n_significant = mu_count_digits(v, base);
+  unsigned int n_required;
+
+  if (directive->precision == MU_PRECISION_NOT_GIVEN) {
+    n_required = MAX(1, n_significant);
+  } else {
+    n_required = MAX(directive->precision, n_significant);
+  }
+  int n_extra = mu_strlen(integer_prefix(directive, v, is_negative, base, n_required));
+  return MAX(FIELD_WIDTH(directive), n_extra + (int)n_required);
+}
+
+int measure_s_directive(mu_directive_t *directive, char const *str) {
+  int limit = -1;
+
+  if (directive->precision != MU_PRECISION_NOT_GIVEN) {
+    // no need to look past the precision
+    limit = directive->precision;
+  }
+  return MAX(FIELD_WIDTH(directive), s_text_length(directive, str, limit, -1));
+}
+
+#if MU_PRINTF_ENABLE_FLOAT
+int measure_f_directive(mu_directive_t *directive, double v) {
+  bool is_negative = v < 0;
+  float_layout_t layout;
+
+  if (is_negative) v = -v;
+  if (directive->precision == MU_PRECISION_NOT_GIVEN) {
+    directive->precision = 6;
+  }
+  int n = float_layout(&layout, v, directive->precision) +
+      mu_strlen(sign_prefix(directive, is_negative));
+  if (directive->precision == 0 && directive->flags.alternate_form) {
+    n += 1;
+  }
+  return MAX(FIELD_WIDTH(directive), n);
+}
+#endif
+
+#if MU_PRINTF_ENABLE_E
+int measure_e_directive(mu_directive_t *directive, double v) {
+  bool is_negative = v < 0;
+  float_layout_t layout;
+
+  if (is_negative) v = -v;
+  if (directive->precision == MU_PRECISION_NOT_GIVEN) {
+    directive->precision = 6;
+  }
+  int exponent = e_layout(&layout, v, directive->precision);
+  int n_extra = mu_strlen(sign_prefix(directive, is_negative));
+  // 'e', sign and at least two exponent digits
+  int n_exponent = 2 + MAX(2, mu_count_digits(exponent < 0 ? -exponent : exponent, 10));
+  // as in process_e_directive(), padding assumes a one digit mantissa
+  int mantissa_width = 1 + directive->precision;
+  if (directive->precision > 0 || directive->flags.alternate_form) {
+    mantissa_width += 1;
+  }
+  int padding = FIELD_WIDTH(directive) - n_extra - mantissa_width - n_exponent;
+  int n = float_layout_length(&layout) + n_extra + n_exponent;
+  if (directive->precision == 0 && directive->flags.alternate_form) {
+    n += 1;
+  }
+  return MAX(padding, 0) + n;
+}
+#endif
+
+// =============================================================================
+// array formatting
+
+#define MU_ARRAY_STAGING_SIZE 64
+
+/*
+ * mu_format_array() formats into a staging block, which is handed to the
+ * user's emitter with mu_emit_block() whenever it fills.
+ */
+typedef struct {
+  emitter_t emitter_fn;
+  void *emitter_arg;
+  int index;
+  char buf[MU_ARRAY_STAGING_SIZE];
+} staging_t;
+
+/*
+ * Format one array element.  The directive's emitter is the staging block.
+ */
+typedef int (*array_kernel_t)(mu_directive_t *directive, void const *element);
+
+void staging_flush(staging_t *staging) {
+  mu_emit_block(staging->emitter_fn,
+                staging->emitter_arg,
+                staging->buf,
+                staging->index);
+  staging->index = 0;
+}
+
+int staging_emitter(void *obj, char ch) {
+  staging_t *staging = (staging_t *)obj;
+  if (staging->index == MU_ARRAY_STAGING_SIZE) {
+    staging_flush(staging);
+  }
+  staging->buf[staging->index++] = ch;
+  return 1;
+}
+
+/*
+ * Return a pointer to n contiguous free bytes in the staging block, flushing
+ * first if needed.  n must not exceed MU_ARRAY_STAGING_SIZE.
+ */
+char *staging_reserve(staging_t *staging, int n) {
+  if (staging->index + n > MU_ARRAY_STAGING_SIZE) {
+    staging_flush(staging);
+  }
+  return &staging->buf[staging->index];
+}
+
+int staging_write(staging_t *staging, char const *str, int n) {
+  int i;
+
+  for (i=0; i<n; i++) {
+    staging_emitter(staging, str[i]);
+  }
+  return n;
+}
+
+// "%d" with no flags, width or precision: convert straight into the block
+int array_plain_d_kernel(mu_directive_t *directive, void const *element) {
+  staging_t *staging = (staging_t *)directive->emitter_arg;
+  int v = *(int const *)element;
+  unsigned int u = v < 0 ? -(unsigned int)v : (unsigned int)v;
+  int n = MAX(1, mu_count_digits(u, 10)) + (v < 0 ? 1 : 0);
+  char *p = staging_reserve(staging, n);
+
+  if (v < 0) {
+    *p = '-';
+  }
+  format_decimal(p + n, u);
+  staging->index += n;
+  return n;
+}
+
+int array_d_kernel(mu_directive_t *directive, void const *element) {
+  return process_d_directive(directive, *(int const *)element);
+}
+
+#if MU_PRINTF_ENABLE_BINARY
+int array_b_kernel(mu_directive_t *directive, void const *element) {
+  return process_u_directive(directive, *(unsigned int const *)element, 2);
+}
+#endif
+
+int array_o_kernel(mu_directive_t *directive, void const *element) {
+  return process_u_directive(directive, *(unsigned int const *)element, 8);
+}
+
+int array_x_kernel(mu_directive_t *directive, void const *element) {
+  return process_u_directive(directive, *(unsigned int const *)element, 16);
+}
+
+#if MU_PRINTF_ENABLE_FLOAT
+/*
+ * Batch kernel for "%.<precision>f" over an array of floats.
+ *
+ * mu_emit_float() produces the digit at 10^p as
+ *   ((unsigned)(v * 10^-p) + carry) % 10
+ * walking up from p = -precision, where carry starts as the rounding bit and
+ * survives only through zero digits.  Here the same arithmetic runs across
+ * MU_FLOAT_BATCH lanes at once, one digit column per pass, so the inner loops
+ * are straight-line float multiplies and integer ops that the compiler can
+ * vectorize (e.g. SSE or AVX2 on a host, Helium or NEON on Cortex-M/A).
+ * Building with -DMU_FLOAT_BATCH=32 fills 256 bit vectors.  Since the
+ * arithmetic is identical, so is the output.
+ *
+ * Digits are stored column-major (column[c][lane]) so that each pass writes
+ * contiguous memory.  A lane whose scaled value does not fit in an int, or is
+ * not a number, is left to mu_emit_float().
+ */
+#ifndef MU_FLOAT_BATCH
+#define MU_FLOAT_BATCH 16  // lanes per pass: 16 suits 128 bit vectors
+#endif
+#define MU_FLOAT_BATCH_PRECISION_MAX 9
+// digits + '.' + carry digit: 10 integer digits when precision is 0
+#define FLOAT_BATCH_COLUMNS (MU_FLOAT_BATCH_PRECISION_MAX + 12)
+
+int float_batch(staging_t *staging,
+                float const *vs,
+                int count,
+                int precision,
+                char const *separator,
+                int separator_len) {
+  double scale[FLOAT_BATCH_COLUMNS];
+  char column[FLOAT_BATCH_COLUMNS][MU_FLOAT_BATCH];
+  float a[MU_FLOAT_BATCH];
+  unsigned int negative[MU_FLOAT_BATCH];
+  unsigned int in_range[MU_FLOAT_BATCH];
+  unsigned int carry[MU_FLOAT_BATCH];
+  unsigned int done[MU_FLOAT_BATCH];
+  unsigned int length[MU_FLOAT_BATCH];
+  double p10 = float_scale(precision);
+  int n_emitted = 0;
+  int base;
+  int lane;
+  int c;
+
+  // scale[c] multiplies v so that the digit at 10^(c - precision) is the
+  // least significant digit of the integer part
+  for (c=0; c<FLOAT_BATCH_COLUMNS; c++) {
+    scale[c] = float_scale(precision - c);
+  }
+
+  for (base=0; base<count; base+=MU_FLOAT_BATCH) {
+    int n_lanes = MIN(MU_FLOAT_BATCH, count - base);
+    unsigned int all_done;
+
+    // set up lanes: sign, magnitude and the rounding bit
+    for (lane=0; lane<MU_FLOAT_BATCH; lane++) {
+      a[lane] = lane < n_lanes ? vs[base + lane] : 0.0f;
+    }
+    for (lane=0; lane<MU_FLOAT_BATCH; lane++) {
+      double scaled;
+      negative[lane] = a[lane] < 0;
+      a[lane] = negative[lane] ? -a[lane] : a[lane];
+      scaled = a[lane] * p10;
+      in_range[lane] = scaled < 2147483648.0;  // false for NaN, too
+      a[lane] = in_range[lane] ? a[lane] : 0.0f;
+      scaled = in_range[lane] ? scaled : 0.0f;
+      carry[lane] = (scaled - (int)scaled) >= 0.5;
+      done[lane] = 0;
+      length[lane] = 0;
+    }
+
+    // generate one digit column per pass, least significant first
+    int col = 0;
+    for (c=0; ; c++) {
+      if (c == precision && precision > 0) {
+        for (lane=0; lane<MU_FLOAT_BATCH; lane++) {
+          column[col][lane] = '.';
+          length[lane] += 1;
+        }
+        col += 1;
+      }
+      all_done = 1;
+      for (lane=0; lane<MU_FLOAT_BATCH; lane++) {
+        unsigned int scaled_vi = (unsigned int)(int)(a[lane] * scale[c]);
+        unsigned int stop = (c > precision) & (scaled_vi == 0);
+        unsigned int digit = (scaled_vi + carry[lane]) % 10;
+        // branch free: the char is '1' when stopping on a carry, and a lane
+        // grows until it stops (by one more char if it carried)
+        column[col][lane] = '0' + digit + stop * (1 - digit);
+        length[lane] += (done[lane] ^ 1) & (carry[lane] | (stop ^ 1));
+        carry[lane] = carry[lane] & (digit == 0);
+        done[lane] |= stop;
+        all_done &= done[lane];
+      }
+      col += 1;
+      if (all_done) {
+        break;
+      }
+    }
+
+    // copy each lane's digits out, most significant first
+    for (lane=0; lane<n_lanes; lane++) {
+      if (base + lane > 0) {
+        n_emitted += staging_write(staging, separator, separator_len);
+      }
+      if (!in_range[lane]) {
+        float v = vs[base + lane];
+        if (v < 0) {
+          n_emitted += staging_emitter(staging, '-');
+          v = -v;
+        }
+        n_emitted += mu_emit_float(staging_emitter, staging, v, precision);
+        continue;
+      }
+      int n = length[lane] + negative[lane];
+      char *p = staging_reserve(staging, n);
+      if (negative[lane]) {
+        *p++ = '-';
+      }
+      for (c=length[lane]-1; c>=0; c--) {
+        *p++ = column[c][lane];
+      }
+      staging->index += n;
+      n_emitted += n;
+    }
+  }
+  return n_emitted;
+}
+
+#if MU_PRINTF_ENABLE_E
+int array_e_kernel(mu_directive_t *directive, void const *element) {
+  return process_e_directive(directive, *(float const *)element);
+}
+#endif
+
+int array_f_kernel(mu_directive_t *directive, void const *element) {
+  return process_f_directive(directive, *(float const *)element);
+}
+#endif
+
+int array_c_kernel(mu_directive_t *directive, void const *element) {
+  return process_c_directive(directive, *(unsigned char const *)element);
+}
+
+int array_s_kernel(mu_directive_t *directive, void const *element) {
+  return process_s_directive(directive, *(char const * const *)element);
+}
+
+int mu_format_array(emitter_t emitter_fn,
+                    void *obj,
+                    char const *fmt,
+                    char const *separator,
+                    void const *array,
+                    int count) {
+  mu_directive_t directive;
+  staging_t staging;
+  array_kernel_t kernel;
+#if MU_PRINTF_ENABLE_FLOAT
+  bool batch = false;
+#endif
+  int stride;
+  int i;
+
+  if (*fmt != '%') {
+    return 0;
+  }
+  mu_parse_directive(&directive, fmt + 1);
+
+  // choose the kernel once, rather than once per element
+  switch(directive.conversion) {
+  case 'd':
+  case 'i':
+    if (directive.flags.all == 0 &&
+        directive.width == 0 &&
+        directive.precision == MU_PRECISION_NOT_GIVEN) {
+      kernel = array_plain_d_kernel;
+    } else {
+      kernel = array_d_kernel;
+    }
+    stride = sizeof(int);
+    break;
+#if MU_PRINTF_ENABLE_BINARY
+  case 'b':
+    kernel = array_b_kernel;
+    stride = sizeof(unsigned int);
+    break;
+#endif
+  case 'o':
+    kernel = array_o_kernel;
+    stride = sizeof(unsigned int);
+    break;
+  case 'p':
+    directive.flags.alternate_form = true;
+    // fall through ---vvv
+  case 'x':
+    kernel = array_x_kernel;
+    stride = sizeof(unsigned int);
+    break;
+#if MU_PRINTF_ENABLE_E
+  case 'e':
+    kernel = array_e_kernel;
+    stride = sizeof(float);
+    break;
+#endif
+#if MU_PRINTF_ENABLE_FLOAT
+  case 'f':
+    if (directive.precision == MU_PRECISION_NOT_GIVEN) {
+      directive.precision = 6;
+    }
+    directive.flags.upper_case = 0;  // %F and %f print the same
+    // "%.Nf" with no flags or width goes to the batch kernel
+    batch = directive.flags.all == 0 &&
+        directive.width == 0 &&
+        directive.precision <= MU_FLOAT_BATCH_PRECISION_MAX;
+    kernel = array_f_kernel;
+    stride = sizeof(float);
+    break;
+#endif
+  case 'c':
+    kernel = array_c_kernel;
+    stride = sizeof(char);
+    break;
+#if MU_PRINTF_ENABLE_ESCAPE
+  case 'j':
+  case 'q':
+#endif
+  case 's':
+    kernel = array_s_kernel;
+    stride = sizeof(char const *);
+    break;
+  default:
+    return 0;
+  }
+
+  staging.emitter_fn = emitter_fn;
+  staging.emitter_arg = obj;
+  staging.index = 0;
+  directive.emitter_fn = staging_emitter;
+  directive.emitter_arg = &staging;
+
+  char const *element = (char const *)array;
+  int separator_len = mu_strlen(separator);
+  int n_emitted = 0;
+
+#if MU_PRINTF_ENABLE_FLOAT
+  if (batch) {
+    n_emitted = float_batch(&staging,
+                            (float const *)array,
+                            count,
+                            directive.precision,
+                            separator,
+                            separator_len);
+    staging_flush(&staging);
+    sink_end(emitter_fn, obj);
+    return n_emitted;
+  }
+#endif
+
+  for (i=0; i<count; i++) {
+    if (i > 0) {
+      n_emitted += staging_write(&staging, separator, separator_len);
+    }
+    n_emitted += kernel(&directive, element);
+    element += stride;
+  }
+  staging_flush(&staging);
+  sink_end(emitter_fn, obj);
+
+  return n_emitted;
+}
+
+#if MU_PRINTF_ENABLE_STRUCTURED
+// =============================================================================
+// structured output
+
+int mu_structured_compile(mu_structured_t *compiled,
+                          char const *fmt,
+                          mu_structured_style_t style) {
+  char const *literal = fmt;  // literal text since the previous directive
+  bool json = (style == MU_STRUCTURED_JSON);
+
+  compiled->style = style;
+  compiled->n_fields = 0;
+
+  while (*fmt) {
+    if (*fmt != '%') {
+      fmt++;
+      continue;
+    }
+    if (fmt[1] == '%') {
+      fmt += 2;  // a literal %
+      continue;
+    }
+    if (compiled->n_fields == MU_PRINTF_STRUCTURED_FIELDS) {
+      return -1;
+    }
+    mu_structured_field_t *field = &compiled->fields[compiled->n_fields];
+
+    // the name is the word just before the directive, as in "name=",
+    // "name: " or "name "
+    char const *end = fmt;
+    while (end > literal && end[-1] == ' ') {
+      end--;
+    }
+    if (end > literal && (end[-1] == '=' || end[-1] == ':')) {
+      end--;
+    }
+    char const *start = end;
+    while (start > literal && structured_name_char(start[-1])) {
+      start--;
+    }
+    if (start == end || end - start > 255) {
+      return -1;
+    }
+    field->name = start;
+    field->name_length = end - start;
+
+    fmt = mu_parse_directive(&field->directive, fmt + 1);
+    switch(field->directive.conversion) {
+    case 'd':
+    case 'i':
+#if MU_PRINTF_ENABLE_E
+    case 'e':
+#endif
+#if MU_PRINTF_ENABLE_FLOAT
+    case 'f':
+#endif
+      // a number stays a number: no '#', which would print "2." for %#.0f
+      field->directive.flags.alternate_form = 0;
+      field->quoted = false;
+      break;
+#if MU_PRINTF_ENABLE_BINARY
+    case 'b':
+#endif
+    case 'o':
+    case 'p':
+    case 'x':
+      field->quoted = json;
+      break;
+    case 'c':
+      field->quoted = true;
+      break;
+    case 's':
+    case 'j':
+    case 'q':
+      field->directive.conversion = 'j';
+      field->quoted = true;
+      break;
+    default:
+      return -1;
+    }
+    // padding would break the record
+    field->directive.width = 0;
+    field->directive.flags.pad_zero = 0;
+    field->directive.flags.pad_right = 0;
+    field->directive.flags.pad_space = 0;
+    field->directive.flags.pad_plus = 0;
+
+    compiled->n_fields += 1;
+    literal = fmt;
+  }
+  return compiled->n_fields;
+}
+
+int mu_structured_printf(emitter_t emitter_fn,
+                         void *obj,
+                         mu_structured_t const *compiled,
+                         ...) {
+  va_list ap;
+  int n_printed;
+
+  va_start(ap, compiled);
+  n_printed = mu_structured_vprintf(emitter_fn, obj, compiled, ap);
+  va_end(ap);
+  return n_printed;
+}
+
+int mu_structured_vprintf(emitter_t emitter_fn,
+                          void *obj,
+                          mu_structured_t const *compiled,
+                          va_list args) {
+  bool json = (compiled->style == MU_STRUCTURED_JSON);
+  int n_printed = 0;
+  int i;
+
+  if (json) {
+    n_printed += mu_emit_char(emitter_fn, obj, '{');
+  }
+  for (i=0; i<compiled->n_fields; i++) {
+    mu_structured_field_t const *field = &compiled->fields[i];
+    mu_directive_t directive = field->directive;
+    directive.emitter_fn = emitter_fn;
+    directive.emitter_arg = obj;
+
+    // "name": or name=
+    if (i > 0) {
+      n_printed += mu_emit_char(emitter_fn, obj, json ? ',' : ' ');
+    }
+    if (json) {
+      n_printed += mu_emit_char(emitter_fn, obj, '"');
+    }
+    n_printed += mu_emit_block(emitter_fn,
+                               obj,
+                               field->name,
+                               field->name_length);
+    n_printed += mu_emit_block(emitter_fn, obj, json ? "\":" : "=", json ? 2 : 1);
+
+    // the value
+    if (field->quoted) {
+      n_printed += mu_emit_char(emitter_fn, obj, '"');
+    }
+    if (directive.conversion == 'c') {
+      // escaped as a one char string
+      char str[2] = {(char)va_arg(args, unsigned int), '\0'};
+      directive.conversion = 'j';
+      n_printed += process_s_directive(&directive, str);
+    } else {
+      n_printed += process_directive(&directive, args);
+    }
+    if (field->quoted) {
+      n_printed += mu_emit_char(emitter_fn, obj, '"');
+    }
+  }
+  if (json) {
+    n_printed += mu_emit_char(emitter_fn, obj, '}');
+  }
+  sink_end(emitter_fn, obj);
+  return n_printed;
+}
+
+/*
+ * Return true if ch can be part of a field name.
+ */
+bool structured_name_char(char ch) {
+  return (ch >= 'a' && ch <= 'z') ||
+         (ch >= 'A' && ch <= 'Z') ||
+         (ch >= '0' && ch <= '9') ||
+         ch == '_' || ch == '.' || ch == '-' || ch == '/';
+}
+#endif
+
+// =============================================================================
+// instrumentation
+
+#if MU_PRINTF_ENABLE_STATS
+
+static mu_stats_t s_stats;
+static mu_cycle_counter_t s_cycle_counter;
+
+void mu_stats_set_cycle_counter(mu_cycle_counter_t counter) {
+  s_cycle_counter = counter;
+}
+
+void mu_stats_snapshot(mu_stats_t *snapshot) {
+  *snapshot = s_stats;
+}
+
+void mu_stats_reset(void) {
+  static const mu_stats_t zero;
+  s_stats = zero;
+}
+
+int mu_stats_index(char conversion) {
+  if (conversion >= 'A' && conversion <= 'Z') {
+    return conversion - 'A';
+  } else if (conversion >= 'a' && conversion <= 'z') {
+    return conversion - 'a';
+  }
+  return MU_STATS_OTHER;
+}
+
+uint32_t stats_now(void) {
+  return s_cycle_counter ? s_cycle_counter() : 0;
+}
+
+void stats_count(mu_stats_counter_t *counter, int n, uint32_t t0) {
+  counter->calls += 1;
+  counter->bytes += n;
+  // unsigned subtraction gives the right answer across one wrap-around
+  counter->cycles += (uint32_t)(stats_now() - t0);
+}
+
+void stats_conversion(char conversion, int n, uint32_t t0) {
+  stats_count(&s_stats.conversions[mu_stats_index(conversion)], n, t0);
+}
+
+/*
+ * Format strings are matched by address, so a string literal used from one
+ * call site always lands in the same slot.  Slots are claimed in order of
+ * first use; once they are all taken, new formats are only counted as
+ * dropped.
+ */
+void stats_format(char const *fmt, int n, uint32_t t0) {
+  int i;
+
+  for (i=0; i<MU_PRINTF_STATS_FORMATS; i++) {
+    mu_stats_format_t *format = &s_stats.formats[i];
+    if (format->fmt == (void *)0) {
+      format->fmt = fmt;
+    }
+    if (format->fmt == fmt) {
+      stats_count(&format->counter, n, t0);
+      return;
+    }
+  }
+  s_stats.formats_dropped += 1;
+}
+
+#endif
@@ -8,6 +8,7 @@
 #ifndef SOURCE_MU_PRINTF_H_
 #define SOURCE_MU_PRINTF_H_
 
+#include "mu_printf_config.h"
 #include <stdarg.h>
 #include <stdint.h>
 
@@ -20,6 +21,37 @@ typedef enum {false, true} bool;
  */
 typedef int (*emitter_t)(void *obj, char ch);
 
+typedef struct mu_sink mu_sink_t;
+
+/*!
+ * @brief Methods of a zero-copy sink.
+ *
+ * reserve() returns a pointer to room for up to *n chars in the sink's own
+ * memory (a DMA buffer, a ring slot...) and sets *n to how many chars fit
+ * there, which may be fewer than asked for, or 0 if the sink is full.
+ * commit() then makes the first n chars written there part of the output.
+ * A reservation that is not committed is simply abandoned: the next
+ * reserve() starts at the same place.
+ *
+ * end(), which may be NULL, is called when a mu_printf() (or
+ * mu_structured_printf() or mu_format_array()) call has written all of its
+ * output, so that a sink can pass on a complete message.
+ */
+typedef struct {
+  char *(*reserve)(mu_sink_t *sink, int *n);
+  void (*commit)(mu_sink_t *sink, int n);
+  void (*end)(mu_sink_t *sink);
+} mu_sink_vtable_t;
+
+/*!
+ * @brief A zero-copy sink.  Embed it as the first member of the sink's own
+ * state, and pass mu_sink_emitter with a pointer to it wherever an emitter_t
+ * and its obj are expected.
+ */
+struct mu_sink {
+  mu_sink_vtable_t const *vtable;
+};
+
 typedef union {
   uint8_t all;             // all flag bits at once
   struct {
@@ -59,6 +91,32 @@ int mu_null_emitter(void *obj, const char c);
  */
 int mu_emit_char(emitter_t emitter_fn, void *obj, const char c);
 
+/*!
+ * @brief Emit a block of n characters.
+ *
+ * Formatting routines that produce several characters at once hand them over
+ * through this call rather than one mu_emit_char() at a time.
+ *
+ * @param emitter_fn Pointer to char emitter function
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @param buf The characters to emit.
+ * @param n The number of characters in buf.
+ * @return The number of characters emitted.
+ */
+int mu_emit_block(emitter_t emitter_fn, void *obj, const char *buf, int n);
+
+/*!
+ * @brief Emitter for zero-copy sinks: obj is a mu_sink_t *.
+ *
+ * Called on its own it writes one char through reserve() and commit().  But
+ * mu_emit_block(), mu_emit_pad() and the integer and float conversions
+ * recognize it, and write their chars straight into reserved sink memory:
+ * digits are converted in place and literal text and strings are copied
+ * once, from the format or argument.  Chars that find the sink full are
+ * dropped, but still counted in the return value of mu_printf().
+ */
+int mu_sink_emitter(void *obj, char ch);
+
 /*
  * These are technically internal routines, but exposed here primarily
  * for testability, and secondarily since they might be useful in some
@@ -79,6 +137,25 @@ int mu_emit_char(emitter_t emitter_fn, void *obj, const char c);
  */
 int mu_emit_pad(emitter_t emitter_fn, void *obj, const char c, int n);
 
+#if MU_PRINTF_ENABLE_ESCAPE
+/*!
+ * @brief Emit a string escaped as by %j or %q.
+ *
+ * @param emitter_fn Pointer to char emitter function
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @param str The string to escape.
+ * @param limit Emit at most limit chars of str, or all of it if negative.
+ * @param json Escape for JSON (%j) rather than for C (%q).
+ * @return The number of characters emitted.
+ */
+int mu_emit_escaped(emitter_t emitter_fn,
+                    void *obj,
+                    char const *str,
+                    int limit,
+                    bool json);
+#endif
+
+#if MU_PRINTF_ENABLE_FLOAT
 /*!
  * @brief Return floor(log10(x)).
  *
@@ -101,10 +178,29 @@ float mu_pow10(int p);
  * @brief Limit a number to a given number of fractional digits
  */
 float mu_precision(float v, int ndigits);
+#endif
+
+/*!
+ * @brief Return the number of digits in v when printed in the given base.
+ *
+ * Consistent with mu_emit_integer(), zero has no digits.  Bases 2, 4, 8 and
+ * 16 are computed from the bit length of v (count leading zeros), as is base
+ * 10 (with a single table lookup to correct the estimate).
+ *
+ * @param v The value whose digits are counted.
+ * @param base Base in which v would be printed.
+ * @return Number of digits in v.
+ */
+int mu_count_digits(unsigned int v, unsigned int base);
 
 /*!
  * @brief Print an unsigned integer.
  *
+ * Bases 2, 4, 8 and 16 use a shift and mask kernel rather than dividing once
+ * per digit.  Digits are generated iteratively into a buffer of
+ * sizeof(unsigned int) * 8 chars on the stack and handed to emitter_fn with
+ * mu_emit_block(), so stack use does not depend on v or base.
+ *
  * @param emitter_fn Pointer to char emitter function
  * @param obj Pointer-sized user specified arg passed to emitter_fn
  * @param v Integer value to emit. Assumed non-negative.
@@ -119,11 +215,17 @@ int mu_emit_integer(
     unsigned int base,
     bool upper);
 
+#if MU_PRINTF_ENABLE_FLOAT
 /*!
  * @brief Print a formatted float
  *
  * Note: when precision is 0, the decimal point is suppressed.
  *
+ * Digits are generated iteratively and handed to emitter_fn in chunks of at
+ * most 16 chars, so stack use is a fixed frame (the chunk plus a few words of
+ * layout) whatever v and precision are.  mu_wcet_budget.txt records the
+ * measured bound for whole directives.
+ *
  * @param emitter_fn Pointer to char emitter function
  * @param obj Pointer-sized user specified arg passed to emitter_fn
  * @param v Integer value to emit.  Assumed to be non-negative.
@@ -135,6 +237,7 @@ int mu_emit_float(
     void *obj,
     float v,
     unsigned int precision);
+#endif
 
 int mu_printf(emitter_t emitter_fn, void *obj, const char *fmt_s, ...);
 
@@ -143,6 +246,183 @@ int mu_printf(emitter_t emitter_fn, void *obj, const char *fmt_s, ...);
  */
 int mu_vprintf(emitter_t emitter_fn, void *obj, char const *fmt, va_list arg);
 
+/*!
+ * @brief Return the number of chars mu_printf() would emit, without
+ * formatting anything.
+ *
+ * Literal text is measured a run at a time and each directive by a length
+ * function (the digit count of an integer comes from its bit length, a
+ * string is only scanned up to its precision, a float's length from the
+ * position of its leading digit), so the cost grows with the number of
+ * directives rather than the length of the output.  Useful for reserving
+ * space before formatting into it.
+ */
+int mu_measure(const char *fmt_s, ...);
+
+/*!
+ * @brief Identical to mu_measure(), but with pre-parsed arg list.
+ */
+int mu_vmeasure(char const *fmt, va_list arg);
+
+#if MU_PRINTF_ENABLE_STATS
+/*!
+ * @brief Template for a free-running cycle counter, e.g. one that reads
+ * DWT->CYCCNT on Cortex-M or rdtsc on x86.
+ *
+ * Wrap-around is handled as long as a single mu_printf() call takes less than
+ * one period of the counter.
+ */
+typedef uint32_t (*mu_cycle_counter_t)(void);
+
+typedef struct {
+  uint32_t calls;   // times the conversion or format was processed
+  uint32_t bytes;   // chars emitted
+  uint64_t cycles;  // cycles spent, as read from the cycle counter
+} mu_stats_counter_t;
+
+typedef struct {
+  char const *fmt;  // the format string, matched by address.  NULL if unused.
+  mu_stats_counter_t counter;
+} mu_stats_format_t;
+
+// conversions 'a' through 'z' (either case) have their own counters, '%' and
+// anything unknown share the last one
+#define MU_STATS_OTHER 26
+#define MU_STATS_N_CONVERSIONS 27
+
+typedef struct {
+  mu_stats_counter_t conversions[MU_STATS_N_CONVERSIONS];
+  mu_stats_format_t formats[MU_PRINTF_STATS_FORMATS];
+  uint32_t formats_dropped;  // calls whose format found no free slot
+} mu_stats_t;
+
+/*!
+ * @brief Set the cycle counter used for cycle accounting.
+ *
+ * Until one is set (or if counter is NULL), calls and bytes are still
+ * counted but cycles stay at zero.
+ */
+void mu_stats_set_cycle_counter(mu_cycle_counter_t counter);
+
+/*!
+ * @brief Copy the current counters into snapshot.
+ *
+ * The copy is not atomic: if mu_printf() can run in an interrupt, take the
+ * snapshot with that interrupt masked.  A format's counters include the
+ * cycles and bytes of its directives, plus its literal text.
+ */
+void mu_stats_snapshot(mu_stats_t *snapshot);
+
+/*!
+ * @brief Zero all counters.  The cycle counter setting is kept.
+ */
+void mu_stats_reset(void);
+
+/*!
+ * @brief Return the index into mu_stats_t.conversions for a conversion char.
+ */
+int mu_stats_index(char conversion);
+#endif
+
+/*!
+ * @brief Format every element of an array with a single directive.
+ *
+ * fmt holds a single directive such as "%d" or "%8.3f".  It is parsed once
+ * and applied to each of the count elements of array, with separator emitted
+ * between elements.  Output is collected in a small staging block and passed
+ * to emitter_fn with mu_emit_block().  The element type follows from the
+ * conversion:
+ *
+ *   %d %i          int
+ *   %b %o %x %p    unsigned int
+ *   %e %f          float
+ *   %c             char
+ *   %s %j %q       char const *
+ *
+ * @param emitter_fn Pointer to char emitter function
+ * @param obj Pointer-sized user specified arg passed to emitter_fn
+ * @param fmt A single % directive.
+ * @param separator String emitted between elements.
+ * @param array Pointer to the first element.
+ * @param count Number of elements in array.
+ * @return Number of chars emitted, or 0 if fmt is not a supported directive.
+ */
+int mu_format_array(emitter_t emitter_fn,
+                    void *obj,
+                    char const *fmt,
+                    char const *separator,
+                    void const *array,
+                    int count);
+
+#if MU_PRINTF_ENABLE_STRUCTURED
+typedef enum {
+  MU_STRUCTURED_JSON,    // {"temp":21.5,"id":7}
+  MU_STRUCTURED_LOGFMT,  // temp=21.5 id=7
+} mu_structured_style_t;
+
+typedef struct {
+  char const *name;          // field name, pointing into the format string
+  uint8_t name_length;       // chars in name
+  bool quoted;               // value is written between double quotes
+  mu_directive_t directive;  // the parsed directive for the value
+} mu_structured_field_t;
+
+typedef struct {
+  mu_structured_style_t style;
+  int n_fields;
+  mu_structured_field_t fields[MU_PRINTF_STRUCTURED_FIELDS];
+} mu_structured_t;
+
+/*!
+ * @brief Compile fmt into a structured format that renders as a JSON object
+ * or a logfmt record.
+ *
+ * Each directive in fmt becomes a field, named by the word of literal text
+ * just before it, less a trailing '=' or ':' and spaces.  "temp=%.1f id=%d"
+ * and "temp: %.1f, id: %d" both have fields "temp" and "id".  A name is made of letters, digits and "_.-/", so that it
+ * never needs escaping.  Other literal text is not part of the record.
+ *
+ * Values are typed by conversion.  %d %i %e %f are numbers and are never
+ * quoted.  %s %j %q and %c are strings, always quoted and escaped as for %j.
+ * %b %o %x %p are quoted in JSON but not in logfmt.  Precision and upper
+ * case are honored, and '#' for %b %o %x %p; width, the padding flags and
+ * '#' on a number are dropped, as they would break the record.
+ *
+ * fmt must outlive compiled, which points into it.
+ *
+ * @param compiled Receives the compiled format.
+ * @param fmt The format string.
+ * @param style MU_STRUCTURED_JSON or MU_STRUCTURED_LOGFMT.
+ * @return The number of fields, or -1 if a directive has no name or an
+ * unsupported conversion, or there are more than MU_PRINTF_STRUCTURED_FIELDS.
+ */
+int mu_structured_compile(mu_structured_t *compiled,
+                          char const *fmt,
+                          mu_structured_style_t style);
+
+/*!
+ * @brief Render one record of a compiled format, taking the values from the
+ * args as mu_printf() would.
+ *
+ * The record is written in one pass, values through the same code as
+ * mu_printf(), with no trailing newline.
+ *
+ * @return Number of chars emitted.
+ */
+int mu_structured_printf(emitter_t emitter_fn,
+                         void *obj,
+                         mu_structured_t const *compiled,
+                         ...);
+
+/*!
+ * @brief Identical to mu_structured_printf(), but with pre-parsed arg list.
+ */
+int mu_structured_vprintf(emitter_t emitter_fn,
+                          void *obj,
+                          mu_structured_t const *compiled,
+                          va_list arg);
+#endif
+
 /*!
  * Extract the parameters of a %...<c> directive.  Returns pointer to the
  * first char following the directive.
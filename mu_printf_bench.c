@@ -0,0 +1,300 @@
+/*
+ * mu_printf_bench.c - per-conversion micro-benchmarks against snprintf()
+ *
+ * gcc -Wall -O2 -o mu_printf_bench mu_printf_bench.c mu_printf.c && ./mu_printf_bench > bench_output.txt
+ *
+ * Each case formats one value into a RAM buffer, once with mu_printf() and
+ * once with the host C library's snprintf().  The loop count is calibrated
+ * so each measurement runs for at least MIN_SECONDS, and the best of
+ * N_REPEATS measurements is reported.  Results go to stdout as JSON, with a
+ * readable summary on stderr.
+ *
+ * Usage: mu_printf_bench [-o file.json] [-f filter] [-s]
+ *   -o  write JSON to file rather than stdout
+ *   -f  only run cases whose name contains filter
+ *   -s  have mu_printf() write into the buffer as a zero-copy sink
+ *       (mu_sink_emitter) rather than through a char emitter
+ */
+
+#include "mu_printf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_SECONDS 0.02
+#define N_REPEATS 5
+#define BENCH_BUF_SIZE 512
+
+typedef enum { ARG_NONE, ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_STRING } arg_type_t;
+
+typedef struct {
+  char const *name;
+  char const *fmt;
+  arg_type_t type;
+  int i;
+  unsigned int u;
+  double d;
+  char const *s;
+} bench_case_t;
+
+typedef struct {
+  double ns_per_call;
+  double bytes_per_sec;
+  int bytes;
+} bench_result_t;
+
+// =============================================================================
+// the cases
+
+static char long_string[257];
+
+#define INT_CASE(name, fmt, v) {name, fmt, ARG_INT, v, 0, 0.0, NULL}
+#define UINT_CASE(name, fmt, v) {name, fmt, ARG_UINT, 0, v, 0.0, NULL}
+#define DOUBLE_CASE(name, fmt, v) {name, fmt, ARG_DOUBLE, 0, 0, v, NULL}
+#define STRING_CASE(name, fmt, v) {name, fmt, ARG_STRING, 0, 0, 0.0, v}
+#define LITERAL_CASE(name, fmt) {name, fmt, ARG_NONE, 0, 0, 0.0, NULL}
+
+static bench_case_t s_cases[] = {
+  INT_CASE("d_zero", "%d", 0),
+  INT_CASE("d_small", "%d", 42),
+  INT_CASE("d_large", "%d", 2147483647),
+  INT_CASE("d_negative", "%d", -1234567),
+  INT_CASE("d_plus_width", "%+8d", 1234),
+  INT_CASE("d_left_width", "%-8d", 1234),
+  INT_CASE("d_zero_pad", "%08d", -1234),
+  INT_CASE("d_precision", "%.6d", 1234),
+
+  UINT_CASE("x_plain", "%x", 0xdeadbeef),
+  UINT_CASE("x_zero_pad", "%08x", 0xbeef),
+  UINT_CASE("x_alternate", "%#x", 0xbeef),
+  UINT_CASE("x_upper", "%X", 0xdeadbeef),
+  UINT_CASE("o_plain", "%o", 0xdeadbeef),
+
+  STRING_CASE("s_short", "%s", "hello"),
+  STRING_CASE("s_long", "%s", long_string),
+  STRING_CASE("s_width", "%20s", "hello"),
+  STRING_CASE("s_left_width", "%-20s", "hello"),
+  STRING_CASE("s_precision", "%.8s", long_string),
+
+  DOUBLE_CASE("f_plain", "%f", 3.14159),
+  DOUBLE_CASE("f_precision", "%.2f", -273.15),
+  DOUBLE_CASE("f_width", "%10.3f", 42.125),
+  DOUBLE_CASE("f_plus", "%+f", 1.5),
+  DOUBLE_CASE("f_zero_pad", "%08.2f", -3.75),
+  DOUBLE_CASE("f_large", "%.1f", 98765.4),
+
+  DOUBLE_CASE("e_plain", "%e", 123456.0),
+  DOUBLE_CASE("e_precision", "%.3e", 0.000123),
+  DOUBLE_CASE("e_width", "%12.2e", 6.5),
+
+  LITERAL_CASE("literal_only",
+               "The quick brown fox jumps over the lazy dog.\n"),
+  INT_CASE("literal_heavy",
+           "sensor reading complete, status nominal, count=%d\n", 17),
+};
+
+#define N_CASES (sizeof(s_cases) / sizeof(s_cases[0]))
+
+// =============================================================================
+// timing
+
+static char s_buf[BENCH_BUF_SIZE];
+static int s_index;
+static volatile int s_sink;
+
+int bench_emitter(void *obj, char ch) {
+  s_buf[s_index++] = ch;
+  return 1;
+}
+
+// the same buffer as a zero-copy sink
+char *bench_sink_reserve(mu_sink_t *sink, int *n) {
+  return &s_buf[s_index];
+}
+
+void bench_sink_commit(mu_sink_t *sink, int n) {
+  s_index += n;
+}
+
+static const mu_sink_vtable_t s_bench_sink_vtable = {
+  bench_sink_reserve,
+  bench_sink_commit,
+  NULL
+};
+static mu_sink_t s_bench_sink = {&s_bench_sink_vtable};
+
+static emitter_t s_emitter_fn = bench_emitter;
+static void *s_emitter_arg = NULL;
+
+double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Format the case n times, with mu_printf() if use_mu, else with snprintf().
+ * Returns the length of the last result.
+ */
+int run_case(bench_case_t const *bc, long n, bool use_mu) {
+  int len = 0;
+  long i;
+
+#define RUN_LOOP(...)                                                 \
+  for (i=0; i<n; i++) {                                               \
+    if (use_mu) {                                                     \
+      s_index = 0;                                                    \
+      len = mu_printf(s_emitter_fn, s_emitter_arg, bc->fmt,           \
+                      ##__VA_ARGS__);                                 \
+    } else {                                                          \
+      len = snprintf(s_buf, BENCH_BUF_SIZE, bc->fmt, ##__VA_ARGS__);  \
+    }                                                                 \
+    s_sink += len;                                                    \
+  }
+
+  switch(bc->type) {
+  case ARG_NONE:
+    RUN_LOOP();
+    break;
+  case ARG_INT:
+    RUN_LOOP(bc->i);
+    break;
+  case ARG_UINT:
+    RUN_LOOP(bc->u);
+    break;
+  case ARG_DOUBLE:
+    RUN_LOOP(bc->d);
+    break;
+  case ARG_STRING:
+    RUN_LOOP(bc->s);
+    break;
+  }
+#undef RUN_LOOP
+  return len;
+}
+
+bench_result_t measure(bench_case_t const *bc, bool use_mu) {
+  bench_result_t result;
+  long n = 1;
+  double best = 0.0;
+  int r;
+
+  // calibrate: double n until one run takes MIN_SECONDS
+  while (true) {
+    double t0 = now_seconds();
+    run_case(bc, n, use_mu);
+    if (now_seconds() - t0 >= MIN_SECONDS) {
+      break;
+    }
+    n *= 2;
+  }
+  for (r=0; r<N_REPEATS; r++) {
+    double t0 = now_seconds();
+    result.bytes = run_case(bc, n, use_mu);
+    double ns = (now_seconds() - t0) * 1e9 / n;
+    if (r == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  result.ns_per_call = best;
+  result.bytes_per_sec = result.bytes * 1e9 / best;
+  return result;
+}
+
+// =============================================================================
+// output
+
+void print_json_string(FILE *f, char const *s) {
+  fputc('"', f);
+  for (; *s; s++) {
+    switch(*s) {
+    case '"': fputs("\\\"", f); break;
+    case '\\': fputs("\\\\", f); break;
+    case '\n': fputs("\\n", f); break;
+    case '\t': fputs("\\t", f); break;
+    default: fputc(*s, f);
+    }
+  }
+  fputc('"', f);
+}
+
+void print_json_result(FILE *f, char const *key, bench_result_t const *r) {
+  fprintf(f,
+          "\"%s\": {\"ns_per_call\": %.2f, \"bytes_per_sec\": %.0f, "
+          "\"bytes\": %d}",
+          key,
+          r->ns_per_call,
+          r->bytes_per_sec,
+          r->bytes);
+}
+
+int main(int argc, char **argv) {
+  char const *filter = NULL;
+  FILE *out = stdout;
+  bool first = true;
+  size_t i;
+  int a;
+
+  for (a=1; a<argc; a++) {
+    if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+      out = fopen(argv[++a], "w");
+      if (out == NULL) {
+        perror(argv[a]);
+        return 1;
+      }
+    } else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+      filter = argv[++a];
+    } else if (strcmp(argv[a], "-s") == 0) {
+      s_emitter_fn = mu_sink_emitter;
+      s_emitter_arg = &s_bench_sink;
+    } else {
+      fprintf(stderr,
+              "usage: %s [-o file.json] [-f filter] [-s]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  memset(long_string, 'x', sizeof(long_string) - 1);
+
+  fprintf(out, "{\n  \"benchmark\": \"mu_printf_bench\",\n");
+  fprintf(out, "  \"compiler\": ");
+  print_json_string(out, __VERSION__);
+  fprintf(out, ",\n  \"results\": [");
+  fprintf(stderr, "%-16s %10s %10s %8s\n", "case", "mu ns", "libc ns", "mu/libc");
+
+  for (i=0; i<N_CASES; i++) {
+    bench_case_t const *bc = &s_cases[i];
+    if (filter && strstr(bc->name, filter) == NULL) {
+      continue;
+    }
+    bench_result_t mu = measure(bc, true);
+    bench_result_t libc = measure(bc, false);
+
+    fprintf(out, "%s\n    {\"name\": ", first ? "" : ",");
+    print_json_string(out, bc->name);
+    fprintf(out, ", \"format\": ");
+    print_json_string(out, bc->fmt);
+    fprintf(out, ",\n     ");
+    print_json_result(out, "mu_printf", &mu);
+    fprintf(out, ",\n     ");
+    print_json_result(out, "snprintf", &libc);
+    fprintf(out, ",\n     \"ratio\": %.3f}", mu.ns_per_call / libc.ns_per_call);
+    first = false;
+
+    fprintf(stderr,
+            "%-16s %10.1f %10.1f %8.2f%s\n",
+            bc->name,
+            mu.ns_per_call,
+            libc.ns_per_call,
+            mu.ns_per_call / libc.ns_per_call,
+            mu.bytes == libc.bytes ? "" : "  (output length differs)");
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * mu_printf_config - compile-time feature selection
+ *
+ * Every feature is enabled unless its macro is defined as 0, either here or
+ * on the compiler command line (e.g. -DMU_PRINTF_ENABLE_FLOAT=0).  A disabled
+ * feature is not compiled at all, which matters on parts where code size
+ * decides whether mu_printf fits.  A conversion that is disabled behaves like
+ * any other unknown conversion: it prints nothing and consumes no argument.
+ *
+ * Run ./size_report.sh to see what each configuration costs.
+ */
+
+#ifndef SOURCE_MU_PRINTF_CONFIG_H_
+#define SOURCE_MU_PRINTF_CONFIG_H_
+
+// %f, and with it mu_emit_float(), mu_pow10(), mu_precision() and
+// mu_floor_log10()
+#ifndef MU_PRINTF_ENABLE_FLOAT
+#define MU_PRINTF_ENABLE_FLOAT 1
+#endif
+
+// %e (needs MU_PRINTF_ENABLE_FLOAT)
+#ifndef MU_PRINTF_ENABLE_E
+#define MU_PRINTF_ENABLE_E MU_PRINTF_ENABLE_FLOAT
+#endif
+
+// %b
+#ifndef MU_PRINTF_ENABLE_BINARY
+#define MU_PRINTF_ENABLE_BINARY 1
+#endif
+
+// %j and %q: strings escaped for JSON and for C
+#ifndef MU_PRINTF_ENABLE_ESCAPE
+#define MU_PRINTF_ENABLE_ESCAPE 1
+#endif
+
+// mu_structured_compile() and friends: formats rendered as JSON or logfmt
+// records (needs MU_PRINTF_ENABLE_ESCAPE)
+#ifndef MU_PRINTF_ENABLE_STRUCTURED
+#define MU_PRINTF_ENABLE_STRUCTURED MU_PRINTF_ENABLE_ESCAPE
+#endif
+
+// most fields in one structured format
+#ifndef MU_PRINTF_STRUCTURED_FIELDS
+#define MU_PRINTF_STRUCTURED_FIELDS 8
+#endif
+
+// the '#', '0', '-', ' ' and '+' flags
+#ifndef MU_PRINTF_ENABLE_FLAGS
+#define MU_PRINTF_ENABLE_FLAGS 1
+#endif
+
+// minimum field width, as in "%8d" (precision is always supported)
+#ifndef MU_PRINTF_ENABLE_WIDTH
+#define MU_PRINTF_ENABLE_WIDTH 1
+#endif
+
+// per-conversion and per-format call, byte and cycle counters (see
+// mu_stats_snapshot()).  Off by default: when 0 the hooks compile to nothing.
+#ifndef MU_PRINTF_ENABLE_STATS
+#define MU_PRINTF_ENABLE_STATS 0
+#endif
+
+// number of distinct format strings the counters keep track of
+#ifndef MU_PRINTF_STATS_FORMATS
+#define MU_PRINTF_STATS_FORMATS 16
+#endif
+
+// feed every mu_vprintf() call to the format profiler in mu_profile.c (which
+// must then be linked in, and needs MU_PRINTF_ENABLE_ESCAPE).  Off by default.
+#ifndef MU_PRINTF_ENABLE_PROFILE
+#define MU_PRINTF_ENABLE_PROFILE 0
+#endif
+
+// size of the profiler's table: MU_PRINTF_PROFILE_SETS (a power of two) sets
+// of MU_PRINTF_PROFILE_WAYS entries each
+#ifndef MU_PRINTF_PROFILE_SETS
+#define MU_PRINTF_PROFILE_SETS 8
+#endif
+#ifndef MU_PRINTF_PROFILE_WAYS
+#define MU_PRINTF_PROFILE_WAYS 4
+#endif
+
+#if MU_PRINTF_ENABLE_E && !MU_PRINTF_ENABLE_FLOAT
+#error "MU_PRINTF_ENABLE_E requires MU_PRINTF_ENABLE_FLOAT"
+#endif
+
+#if MU_PRINTF_ENABLE_STRUCTURED && !MU_PRINTF_ENABLE_ESCAPE
+#error "MU_PRINTF_ENABLE_STRUCTURED requires MU_PRINTF_ENABLE_ESCAPE"
+#endif
+
+#if MU_PRINTF_ENABLE_PROFILE && !MU_PRINTF_ENABLE_ESCAPE
+#error "MU_PRINTF_ENABLE_PROFILE requires MU_PRINTF_ENABLE_ESCAPE"
+#endif
+
+#endif /* SOURCE_MU_PRINTF_CONFIG_H_ */
@@ -6,6 +6,10 @@
  *
  * To compile standalone:
  * gcc -DSTANDALONE -Wall -o mu_printf_test mu_printf_test.c mu_printf.c && ./mu_printf_test
+ *
+ * The tests pass in every configuration of mu_printf_config.h; add the same
+ * -D options (e.g. -DMU_PRINTF_ENABLE_FLAGS=0 -DMU_PRINTF_ENABLE_WIDTH=0) to
+ * test a reduced build.
  */
 
 #ifdef STANDALONE
@@ -72,6 +76,7 @@ void mu_null_emitter_test() {
   MU_TEST(mu_null_emitter(NULL, 'a') == 1);
 }
 
+#if MU_PRINTF_ENABLE_FLOAT
 void mu_precision_test() {
   PRINTF("...mu_precision_test\r\n");
   MU_TEST(mu_precision(0.0, 0) == 0);
@@ -124,6 +129,7 @@ void mu_precision_test() {
   MU_TEST(nearly_equal(mu_precision(-9.999999, 1), -10.0, 0.000001));
   MU_TEST(nearly_equal(mu_precision(-9.999999, 0), -10.0, 0.000001));
 }
+#endif
 
 void mu_pad_test() {
   PRINTF("...mu_pad_test\r\n");
@@ -137,6 +143,7 @@ void mu_pad_test() {
   MU_TEST(check_test_emitter("||"));
 }
 
+#if MU_PRINTF_ENABLE_FLOAT
 void mu_floor_log10_test() {
   PRINTF("...mu_floor_log10_test\r\n");
   MU_TEST(mu_floor_log10(0.10) == -1);
@@ -167,6 +174,7 @@ void mu_pow10_test() {
   MU_TEST(mu_pow10(5) == 100000.0);
   MU_TEST(mu_pow10(6) == 1000000.0);
 }
+#endif
 void mu_puti_test() {
   /*!
    * @brief Print a formatted integer
@@ -213,8 +221,49 @@ void mu_puti_test() {
   MU_TEST(mu_emit_integer(test_emitter, NULL, -26, 16, true) == 8);
   MU_TEST(check_test_emitter("FFFFFFE6"));
   // PRINTF("got '%s'\r\n", test_buf);
+
+  MU_TEST(mu_emit_integer(test_emitter, NULL, 6844, 8, false) == 5);
+  MU_TEST(check_test_emitter("15274"));
+
+  MU_TEST(mu_emit_integer(test_emitter, NULL, -1, 8, false) == 11);
+  MU_TEST(check_test_emitter("37777777777"));
+
+  MU_TEST(mu_emit_integer(test_emitter, NULL, 6844, 4, false) == 7);
+  MU_TEST(check_test_emitter("1222330"));
+
+  MU_TEST(mu_emit_integer(test_emitter, NULL, 6844, 7, false) == 5);
+  MU_TEST(check_test_emitter("25645"));
+
+  MU_TEST(mu_emit_integer(test_emitter, NULL, -1, 36, true) == 7);
+  MU_TEST(check_test_emitter("1Z141Z3"));
+}
+
+void mu_count_digits_test() {
+  PRINTF("...mu_count_digits_test\r\n");
+  MU_TEST(mu_count_digits(0, 10) == 0);
+  MU_TEST(mu_count_digits(1, 10) == 1);
+  MU_TEST(mu_count_digits(9, 10) == 1);
+  MU_TEST(mu_count_digits(10, 10) == 2);
+  MU_TEST(mu_count_digits(99, 10) == 2);
+  MU_TEST(mu_count_digits(100, 10) == 3);
+  MU_TEST(mu_count_digits(999999999, 10) == 9);
+  MU_TEST(mu_count_digits(1000000000, 10) == 10);
+  MU_TEST(mu_count_digits(-1, 10) == 10);
+
+  MU_TEST(mu_count_digits(0, 16) == 0);
+  MU_TEST(mu_count_digits(0xf, 16) == 1);
+  MU_TEST(mu_count_digits(0x10, 16) == 2);
+  MU_TEST(mu_count_digits(-1, 16) == 8);
+  MU_TEST(mu_count_digits(7, 8) == 1);
+  MU_TEST(mu_count_digits(8, 8) == 2);
+  MU_TEST(mu_count_digits(-1, 8) == 11);
+  MU_TEST(mu_count_digits(1, 2) == 1);
+  MU_TEST(mu_count_digits(-1, 2) == 32);
+  MU_TEST(mu_count_digits(48, 7) == 2);
+  MU_TEST(mu_count_digits(49, 7) == 3);
 }
 
+#if MU_PRINTF_ENABLE_FLOAT
 void mu_putf_test() {
   /*!
    * @brief Print a formatted float
@@ -284,11 +333,21 @@ void mu_putf_test() {
 
   MU_TEST(mu_emit_float(test_emitter, NULL, 9.99, 1) == 4);
   MU_TEST(check_test_emitter("10.0"));
+  MU_TEST(mu_emit_float(test_emitter, NULL, 99.996, 2) == 6);
+  MU_TEST(check_test_emitter("100.00"));
+
+  // longer than one chunk of digits
+  MU_TEST(mu_emit_float(test_emitter, NULL, 0.000000001, 18) == 20);
+  MU_TEST(check_test_emitter("0.000000000999999972"));
 }
+#endif
 
 void mu_parse_directive_test() {
   mu_directive_t directive;
 
+  // flags and widths are parsed in every configuration, but only recorded
+  // when they are enabled
+
   MU_TEST(*mu_parse_directive(&directive, "a?") == '?');
   MU_TEST(directive.flags.all == 0);
   MU_TEST(directive.width == 0);
@@ -297,75 +356,121 @@ void mu_parse_directive_test() {
 
   MU_TEST(*mu_parse_directive(&directive, "1a?") == '?');
   MU_TEST(directive.flags.all == 0);
-  MU_TEST(directive.width == 1);
+  MU_TEST(directive.width == (MU_PRINTF_ENABLE_WIDTH ? 1 : 0));
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "#a?") == '?');
-  MU_TEST(directive.flags.alternate_form != 0);
+  MU_TEST((directive.flags.alternate_form != 0) == MU_PRINTF_ENABLE_FLAGS);
   MU_TEST(directive.width == 0);
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "+a?") == '?');
-  MU_TEST(directive.flags.pad_plus != 0);
+  MU_TEST((directive.flags.pad_plus != 0) == MU_PRINTF_ENABLE_FLAGS);
   MU_TEST(directive.width == 0);
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "-a?") == '?');
-  MU_TEST(directive.flags.pad_right != 0);
+  MU_TEST((directive.flags.pad_right != 0) == MU_PRINTF_ENABLE_FLAGS);
   MU_TEST(directive.width == 0);
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, " a?") == '?');
-  MU_TEST(directive.flags.pad_space != 0);
+  MU_TEST((directive.flags.pad_space != 0) == MU_PRINTF_ENABLE_FLAGS);
   MU_TEST(directive.width == 0);
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "0a?") == '?');
-  MU_TEST(directive.flags.pad_zero != 0);
+  MU_TEST((directive.flags.pad_zero != 0) == MU_PRINTF_ENABLE_FLAGS);
   MU_TEST(directive.width == 0);
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "01a?") == '?');
-  MU_TEST(directive.flags.pad_zero != 0);
-  MU_TEST(directive.width == 1);
+  MU_TEST((directive.flags.pad_zero != 0) == MU_PRINTF_ENABLE_FLAGS);
+  MU_TEST(directive.width == (MU_PRINTF_ENABLE_WIDTH ? 1 : 0));
   MU_TEST(directive.precision == MU_PRECISION_NOT_GIVEN);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "01.a?") == '?');
-  MU_TEST(directive.flags.pad_zero != 0);
-  MU_TEST(directive.width == 1);
+  MU_TEST((directive.flags.pad_zero != 0) == MU_PRINTF_ENABLE_FLAGS);
+  MU_TEST(directive.width == (MU_PRINTF_ENABLE_WIDTH ? 1 : 0));
   MU_TEST(directive.precision == 0);
   MU_TEST(directive.conversion == 'a');
 
   MU_TEST(*mu_parse_directive(&directive, "01.2a?") == '?');
-  MU_TEST(directive.flags.pad_zero != 0);
-  MU_TEST(directive.width == 1);
+  MU_TEST((directive.flags.pad_zero != 0) == MU_PRINTF_ENABLE_FLAGS);
+  MU_TEST(directive.width == (MU_PRINTF_ENABLE_WIDTH ? 1 : 0));
   MU_TEST(directive.precision == 2);
   MU_TEST(directive.conversion == 'a');
 
   // mutual exclusions
   MU_TEST(*mu_parse_directive(&directive, "0-1.2a?") == '?');
   MU_TEST(directive.flags.pad_zero == 0);
-  MU_TEST(directive.flags.pad_right != 0);
+  MU_TEST((directive.flags.pad_right != 0) == MU_PRINTF_ENABLE_FLAGS);
 
   MU_TEST(*mu_parse_directive(&directive, "+ 1.2a?") == '?');
-  MU_TEST(directive.flags.pad_plus != 0);
+  MU_TEST((directive.flags.pad_plus != 0) == MU_PRINTF_ENABLE_FLAGS);
   MU_TEST(directive.flags.pad_space == 0);
 
   MU_TEST(*mu_parse_directive(&directive, "01.2A?") == '?');
   MU_TEST(directive.flags.upper_case != 0);
-  MU_TEST(directive.flags.pad_zero != 0);
-  MU_TEST(directive.width == 1);
+  MU_TEST((directive.flags.pad_zero != 0) == MU_PRINTF_ENABLE_FLAGS);
+  MU_TEST(directive.width == (MU_PRINTF_ENABLE_WIDTH ? 1 : 0));
   MU_TEST(directive.precision == 2);
   MU_TEST(directive.conversion == 'a');
 }
 
+/*
+ * A flag or field width that is compiled out prints as if it were absent.
+ * It must still be consumed with its directive, so that the conversion and
+ * the arguments after it stay in step.
+ */
+void mu_printf_disabled_test() {
+  PRINTF("...mu_printf_disabled_test\r\n");
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_printf(test_emitter, NULL, "%-5d|%d|%s", 7, 42, "ab") == 11);
+  MU_TEST(check_test_emitter("7    |42|ab"));
+  MU_TEST(mu_printf(test_emitter, NULL, "%08x|%d|%s", 0xbeef, 7, "ab") == 13);
+  MU_TEST(check_test_emitter("0000beef|7|ab"));
+#elif MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_printf(test_emitter, NULL, "%-5d|%d|%s", 7, 42, "ab") == 11);
+  MU_TEST(check_test_emitter("    7|42|ab"));
+  MU_TEST(mu_printf(test_emitter, NULL, "%08x|%d|%s", 0xbeef, 7, "ab") == 13);
+  MU_TEST(check_test_emitter("    beef|7|ab"));
+#else
+  MU_TEST(mu_printf(test_emitter, NULL, "%-5d|%d|%s", 7, 42, "ab") == 7);
+  MU_TEST(check_test_emitter("7|42|ab"));
+  MU_TEST(mu_printf(test_emitter, NULL, "%08x|%d|%s", 0xbeef, 7, "ab") == 9);
+  MU_TEST(check_test_emitter("beef|7|ab"));
+#endif
+
+#if MU_PRINTF_ENABLE_FLAGS
+  MU_TEST(mu_printf(test_emitter, NULL, "%+ #d|%#o|%s", 5, 8, "ab") == 9);
+  MU_TEST(check_test_emitter("+5|010|ab"));
+#else
+  MU_TEST(mu_printf(test_emitter, NULL, "%+ #d|%#o|%s", 5, 8, "ab") == 7);
+  MU_TEST(check_test_emitter("5|10|ab"));
+#endif
+
+#if MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_printf(test_emitter, NULL, "%12.3s|%d", "abcdef", 9) == 14);
+  MU_TEST(check_test_emitter("         abc|9"));
+#else
+  MU_TEST(mu_printf(test_emitter, NULL, "%12.3s|%d", "abcdef", 9) == 5);
+  MU_TEST(check_test_emitter("abc|9"));
+#endif
+
+  // mu_measure() agrees
+  MU_TEST(mu_measure("%-5d|%d|%s", 7, 42, "ab") ==
+          mu_printf(test_emitter, NULL, "%-5d|%d|%s", 7, 42, "ab"));
+  test_index = 0;
+}
+
 void mu_printf_c_test() {
   PRINTF("...mu_printf_c_test\r\n");
 
@@ -386,6 +491,7 @@ void mu_printf_s_test() {
   MU_TEST(mu_printf(test_emitter, NULL, "%s", "abcdefghijk") == 11);
   MU_TEST(check_test_emitter("abcdefghijk"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%15.0s", "abcdefghijk") == 15);
   MU_TEST(check_test_emitter("               "));
 
@@ -445,6 +551,39 @@ void mu_printf_s_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%15.0s", "abcd") == 15);
   MU_TEST(check_test_emitter("               "));
+#endif
+
+  // with a precision, nothing past it is read: the buffer needs no null
+  static const char unterminated[4] = {'w', 'x', 'y', 'z'};
+  MU_TEST(mu_printf(test_emitter, NULL, "%.4s", unterminated) == 4);
+  MU_TEST(check_test_emitter("wxyz"));
+
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_printf(test_emitter, NULL, "%8.3s", unterminated) == 8);
+  MU_TEST(check_test_emitter("     wxy"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%-8.4s|", unterminated) == 9);
+  MU_TEST(check_test_emitter("wxyz    |"));
+#endif
+
+  // strings longer than the chunks they are emitted in
+  static const char long_str[] =
+    "0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  MU_TEST(mu_printf(test_emitter, NULL, "%s", long_str) == 72);
+  MU_TEST(check_test_emitter(long_str));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%.64s", long_str) == 64);
+  MU_TEST(check_test_emitter("0123456789abcdefghijklmnopqrstuvwxyz"
+                             "0123456789ABCDEFGHIJKLMNOPQR"));
+
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_printf(test_emitter, NULL, "%75s", long_str) == 75);
+  MU_TEST(check_test_emitter("   0123456789abcdefghijklmnopqrstuvwxyz"
+                             "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%-75.33s|", long_str) == 76);
+  MU_TEST(check_test_emitter("0123456789abcdefghijklmnopqrstuvw"
+                             "                                          |"));
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-15.0s", "abcd") == 15);
   MU_TEST(check_test_emitter("               "));
@@ -490,14 +629,86 @@ void mu_printf_s_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-5s", "abcd") == 5);
   MU_TEST(check_test_emitter("abcd "));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%s", "abcd") == 4);
   MU_TEST(check_test_emitter("abcd"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%-s", "abcd") == 4);
   MU_TEST(check_test_emitter("abcd"));
+#endif
+
+}
+
+#if MU_PRINTF_ENABLE_ESCAPE
+void mu_printf_escape_test() {
+  PRINTF("...mu_printf_escape_test\r\n");
 
+  MU_TEST(mu_printf(test_emitter, NULL, "%j", "") == 0);
+  MU_TEST(check_test_emitter(""));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%j", "plain text") == 10);
+  MU_TEST(check_test_emitter("plain text"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "{\"msg\":\"%j\"}", "say \"hi\"\n") == 22);
+  MU_TEST(check_test_emitter("{\"msg\":\"say \\\"hi\\\"\\n\"}"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%j", "a\\b\tc\r\b\f") == 13);
+  MU_TEST(check_test_emitter("a\\\\b\\tc\\r\\b\\f"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%j", "\a\v\x01\x1f\x7f") == 30);
+  MU_TEST(check_test_emitter("\\u0007\\u000b\\u0001\\u001f\\u007f"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%q", "say \"hi\"\n") == 12);
+  MU_TEST(check_test_emitter("say \\\"hi\\\"\\n"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%q", "\a\v\x01" "7\x7f") == 13);
+  MU_TEST(check_test_emitter("\\a\\v\\0017\\177"));
+
+  // UTF-8 is copied as it is
+  MU_TEST(mu_printf(test_emitter, NULL, "%j", "caf\xc3\xa9") == 5);
+  MU_TEST(check_test_emitter("caf\xc3\xa9"));
+
+  // the precision limits the chars taken from the argument, not the output
+  MU_TEST(mu_printf(test_emitter, NULL, "%.3j", "\"\"\"\"") == 6);
+  MU_TEST(check_test_emitter("\\\"\\\"\\\""));
+
+  static const char unterminated[3] = {'a', '\n', 'b'};
+  MU_TEST(mu_printf(test_emitter, NULL, "%.3q", unterminated) == 4);
+  MU_TEST(check_test_emitter("a\\nb"));
+
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
+  // the width applies to the escaped text
+  MU_TEST(mu_printf(test_emitter, NULL, "%6j|", "a\"") == 7);
+  MU_TEST(check_test_emitter("   a\\\"|"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%-6j|", "a\"") == 7);
+  MU_TEST(check_test_emitter("a\\\"   |"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%2j|", "\n\n") == 5);
+  MU_TEST(check_test_emitter("\\n\\n|"));
+#endif
+
+  // long clean runs, starting at every alignment, with a char to escape
+  // at every position
+  static const char clean[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+  char str[40];
+  char expected[48];
+  int start, bad;
+  for (start=0; start<8; start++) {
+    for (bad=start; bad<36; bad++) {
+      memcpy(str, clean, sizeof(clean));
+      str[bad] = '"';
+      memcpy(expected, clean + start, bad - start);
+      memcpy(expected + bad - start, "\\\"", 2);
+      memcpy(expected + bad - start + 2, clean + bad + 1, 36 - bad);
+      MU_TEST(mu_printf(test_emitter, NULL, "%q", str + start) == 37 - start);
+      MU_TEST(check_test_emitter(expected));
+    }
+  }
 }
+#endif
 
 void mu_printf_d_test() {
   PRINTF("...mu_printf_d_test\r\n");
@@ -529,6 +740,7 @@ void mu_printf_d_test() {
   MU_TEST(mu_printf(test_emitter, NULL, "%.3d", -1) == 4);
   MU_TEST(check_test_emitter("-001"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%+d", 1) == 2);
   MU_TEST(check_test_emitter("+1"));
   // PRINTF("got '%s'\r\n", test_buf);
@@ -547,10 +759,12 @@ void mu_printf_d_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-5d", 1) == 5);
   MU_TEST(check_test_emitter("1    "));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%d", 0) == 1);
   MU_TEST(check_test_emitter("0"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%+d", 0) == 2);
   MU_TEST(check_test_emitter("+0"));
   // PRINTF("got '%s'\r\n", test_buf);
@@ -570,6 +784,7 @@ void mu_printf_d_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%10.5d", 0) == 10);
   MU_TEST(check_test_emitter("     00000"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%d", 1) == 1);
   MU_TEST(check_test_emitter("1"));
@@ -577,6 +792,7 @@ void mu_printf_d_test() {
   MU_TEST(mu_printf(test_emitter, NULL, "%d", -1) == 2);
   MU_TEST(check_test_emitter("-1"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%10d", 1) == 10);
   MU_TEST(check_test_emitter("         1"));
 
@@ -660,6 +876,7 @@ void mu_printf_d_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%+10.5d", -1) == 10);
   MU_TEST(check_test_emitter("    -00001"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%d", 123456) == 6);
   MU_TEST(check_test_emitter("123456"));
@@ -667,6 +884,7 @@ void mu_printf_d_test() {
   MU_TEST(mu_printf(test_emitter, NULL, "%d", -123456) == 7);
   MU_TEST(check_test_emitter("-123456"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%10d", 123456) == 10);
   MU_TEST(check_test_emitter("    123456"));
 
@@ -750,6 +968,7 @@ void mu_printf_d_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%+10.5d", -123456) == 10);
   MU_TEST(check_test_emitter("   -123456"));
+#endif
 }
 
 void mu_printf_u_test() {
@@ -757,6 +976,7 @@ void mu_printf_u_test() {
   MU_TEST(mu_printf(test_emitter, NULL, "%x", 0) == 1);
   MU_TEST(check_test_emitter("0"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#x", 0) == 1);
   MU_TEST(check_test_emitter("0"));
   // PRINTF("got '%s'\r\n", test_buf);
@@ -792,10 +1012,12 @@ void mu_printf_u_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-5.x", 0) == 5);
   MU_TEST(check_test_emitter("     "));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%x", 1) == 1);
   MU_TEST(check_test_emitter("1"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#x", 1) == 3);
   MU_TEST(check_test_emitter("0x1"));
 
@@ -828,10 +1050,12 @@ void mu_printf_u_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-5.x", 1) == 5);
   MU_TEST(check_test_emitter("1    "));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%x", 6844) == 4);
   MU_TEST(check_test_emitter("1abc"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#x", 6844) == 6);
   MU_TEST(check_test_emitter("0x1abc"));
 
@@ -864,12 +1088,15 @@ void mu_printf_u_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-5.x", 6844) == 5);
   MU_TEST(check_test_emitter("1abc "));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%X", 6844) == 4);
   MU_TEST(check_test_emitter("1ABC"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#X", 6844) == 6);
   MU_TEST(check_test_emitter("0X1ABC"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%o", 0) == 1);
   MU_TEST(check_test_emitter("0"));
@@ -877,35 +1104,58 @@ void mu_printf_u_test() {
   MU_TEST(mu_printf(test_emitter, NULL, "%o", 6844) == 5);
   MU_TEST(check_test_emitter("15274"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#o", 6844) == 6);
   MU_TEST(check_test_emitter("015274"));
+#endif
 
+#if MU_PRINTF_ENABLE_BINARY
   MU_TEST(mu_printf(test_emitter, NULL, "%b", 0) == 1);
   MU_TEST(check_test_emitter("0"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#b", 0) == 1);
   MU_TEST(check_test_emitter("0"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%b", 1) == 1);
   MU_TEST(check_test_emitter("1"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#b", 1) == 3);
   MU_TEST(check_test_emitter("0b1"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%b", 90) == 7);
   MU_TEST(check_test_emitter("1011010"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%#b", 90) == 9);
   MU_TEST(check_test_emitter("0b1011010"));
+#endif
+#endif
+
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_printf(test_emitter, NULL, "%08x", 0xbeef) == 8);
+  MU_TEST(check_test_emitter("0000beef"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%08X", -1) == 8);
+  MU_TEST(check_test_emitter("FFFFFFFF"));
+#endif
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%p", 0x2000) == 6);
+  MU_TEST(check_test_emitter("0x2000"));
 
 }
 
+#if MU_PRINTF_ENABLE_FLOAT
 void mu_printf_f_test() {
   PRINTF("...mu_printf_f_test\r\n");
 
   MU_TEST(mu_printf(test_emitter, NULL, "%f", 0.0) == 8);
   MU_TEST(check_test_emitter("0.000000"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% f", 0.0) == 9);
   MU_TEST(check_test_emitter(" 0.000000"));
 
@@ -974,10 +1224,12 @@ void mu_printf_f_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%05.1f", 0.0) == 5);
   MU_TEST(check_test_emitter("000.0"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%f", 1.0) == 8);
   MU_TEST(check_test_emitter("1.000000"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% f", 1.0) == 9);
   MU_TEST(check_test_emitter(" 1.000000"));
 
@@ -1046,10 +1298,12 @@ void mu_printf_f_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%05.1f", 1.0) == 5);
   MU_TEST(check_test_emitter("001.0"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%f", -1.0) == 9);
   MU_TEST(check_test_emitter("-1.000000"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% f", -1.0) == 9);
   MU_TEST(check_test_emitter("-1.000000"));
 
@@ -1119,10 +1373,12 @@ void mu_printf_f_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%05.1f", -1.0) == 5);
   MU_TEST(check_test_emitter("-01.0"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%f", 9.99) == 8);
   MU_TEST(check_test_emitter("9.990000"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% f", 9.99) == 9);
   MU_TEST(check_test_emitter(" 9.990000"));
 
@@ -1212,15 +1468,19 @@ void mu_printf_f_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%+05.1f", -1.0) == 5);
   MU_TEST(check_test_emitter("-01.0"));
+#endif
 
 }
+#endif
 
+#if MU_PRINTF_ENABLE_E
 void mu_printf_e_test() {
   PRINTF("...mu_printf_e_test\r\n");
   MU_TEST(mu_printf(test_emitter, NULL, "%e", 0.0) == 12);
   MU_TEST(check_test_emitter("0.000000e+00"));
   // PRINTF("got '%s'\r\n", test_buf);
   
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% e", 0.0) == 13);
   MU_TEST(check_test_emitter(" 0.000000e+00"));
   
@@ -1232,7 +1492,18 @@ void mu_printf_e_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%-e", 0.0) == 12);
   MU_TEST(check_test_emitter("0.000000e+00"));
+#endif
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%e", 123456.0) == 12);
+  MU_TEST(check_test_emitter("1.234560e+05"));
+
+  MU_TEST(mu_printf(test_emitter, NULL, "%.2e", 0.000123) == 8);
+  MU_TEST(check_test_emitter("1.23e-04"));
 
+  MU_TEST(mu_printf(test_emitter, NULL, "%.1e", 1e-20) == 7);
+  MU_TEST(check_test_emitter("1.0e-20"));
+
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "%0e", 0.0) == 12);
   MU_TEST(check_test_emitter("0.000000e+00"));
 
@@ -1289,10 +1560,12 @@ void mu_printf_e_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%08.1e", 0.0) == 8);
   MU_TEST(check_test_emitter("00.0e+00"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%e", 1.0) == 12);
   MU_TEST(check_test_emitter("1.000000e+00"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% e", 1.0) == 13);
   MU_TEST(check_test_emitter(" 1.000000e+00"));
 
@@ -1361,10 +1634,12 @@ void mu_printf_e_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%08.1e", 1.0) == 8);
   MU_TEST(check_test_emitter("01.0e+00"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%e", -1.0) == 13);
   MU_TEST(check_test_emitter("-1.000000e+00"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% e", -1.0) == 13);
   MU_TEST(check_test_emitter("-1.000000e+00"));
 
@@ -1433,10 +1708,12 @@ void mu_printf_e_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%08.1e", -1.0) == 8);
   MU_TEST(check_test_emitter("-1.0e+00"));
+#endif
 
   MU_TEST(mu_printf(test_emitter, NULL, "%e", 9.99) == 12);
   MU_TEST(check_test_emitter("9.990000e+00"));
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% e", 9.99) == 13);
   MU_TEST(check_test_emitter(" 9.990000e+00"));
 
@@ -1472,8 +1749,10 @@ void mu_printf_e_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%8.e", 9.99) == 8);
   MU_TEST(check_test_emitter("   1e+01"));
+#endif
   PRINTF("got '%s'\r\n", test_buf);
 
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
   MU_TEST(mu_printf(test_emitter, NULL, "% 8.e", 9.99) == 8);
   MU_TEST(check_test_emitter("   1e+01"));
 
@@ -1512,24 +1791,381 @@ void mu_printf_e_test() {
 
   MU_TEST(mu_printf(test_emitter, NULL, "%08.1E", 9.99) == 8);
   MU_TEST(check_test_emitter("01.0E+01"));
+#endif
+}
+#endif
+
+void mu_format_array_test() {
+  PRINTF("...mu_format_array_test\r\n");
+  int ints[] = {0, 1, -1, 12345, -2147483647 - 1, 99};
+  unsigned int regs[] = {0xbeef, 0, 0xffffffff};
+  char const *strs[] = {"ab", "", "cde"};
+  char chars[] = {'x', 'y', 'z'};
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%d", ",", ints, 6) == 27);
+  MU_TEST(check_test_emitter("0,1,-1,12345,-2147483648,99"));
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%x", " ", regs, 3) == 15);
+  MU_TEST(check_test_emitter("beef 0 ffffffff"));
+
+#if MU_PRINTF_ENABLE_FLAGS && MU_PRINTF_ENABLE_WIDTH
+  MU_TEST(mu_format_array(test_emitter, NULL, "%+4d", ", ", ints, 3) == 16);
+  MU_TEST(check_test_emitter("  +0,   +1,   -1"));
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%08x", " ", regs, 3) == 26);
+  MU_TEST(check_test_emitter("0000beef 00000000 ffffffff"));
+#endif
+
+#if MU_PRINTF_ENABLE_FLOAT
+  float floats[] = {0.0, 1.5, -2.25};
+  MU_TEST(mu_format_array(test_emitter, NULL, "%.2f", ";", floats, 3) == 15);
+  MU_TEST(check_test_emitter("0.00;1.50;-2.25"));
+#endif
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%s", "|", strs, 3) == 7);
+  MU_TEST(check_test_emitter("ab||cde"));
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%c", "", chars, 3) == 3);
+  MU_TEST(check_test_emitter("xyz"));
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%d", ",", ints, 0) == 0);
+  MU_TEST(check_test_emitter(""));
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "d", ",", ints, 3) == 0);
+  MU_TEST(check_test_emitter(""));
+
+  MU_TEST(mu_format_array(test_emitter, NULL, "%k", ",", ints, 3) == 0);
+  MU_TEST(check_test_emitter(""));
+}
+
+#if MU_PRINTF_ENABLE_FLOAT
+// ======================================================================
+// mu_format_array() batch float kernel vs. the scalar %f path
+
+char batch_buf[512];
+int batch_index = 0;
+
+int batch_emitter(void *obj, char ch) {
+  batch_buf[batch_index++] = ch;
+  return 1;
+}
+
+/*
+ * Format vs with mu_format_array() and with one mu_printf() per element, and
+ * return true if the two agree.
+ */
+bool check_float_batch(char const *fmt, float const *vs, int count) {
+  char expected[512];
+  int n_expected = 0;
+  int n;
+  int i;
+
+  for (i=0; i<count; i++) {
+    if (i > 0) {
+      expected[n_expected++] = ',';
+    }
+    batch_index = 0;
+    n_expected += mu_printf(batch_emitter, NULL, fmt, vs[i]);
+    memcpy(&expected[n_expected - batch_index], batch_buf, batch_index);
+  }
+  batch_index = 0;
+  n = mu_format_array(batch_emitter, NULL, fmt, ",", vs, count);
+  return (n == n_expected) &&
+      (batch_index == n_expected) &&
+      (memcmp(batch_buf, expected, n) == 0);
+}
+
+void mu_format_array_float_batch_test() {
+  PRINTF("...mu_format_array_float_batch_test\r\n");
+  float specials[] = {
+    0.0, -0.0, 1.0, -1.0, 0.5, 9.999999, 9.9999999, 99.5, 0.05, 0.0049,
+    123.456, -6.6666666, 1000.0, 65535.0, 2147483.5, 3.0e9, -3.0e9, 1.0e-8,
+  };
+  char const *fmts[] = {
+    "%.0f", "%.1f", "%.2f", "%.3f", "%f", "%.7f", "%.9f", "%F",
+  };
+  float vs[13];
+  unsigned int seed = 12345;
+  int i, j, k;
+
+  for (i=0; i<(int)(sizeof(fmts)/sizeof(fmts[0])); i++) {
+    MU_TEST(check_float_batch(fmts[i],
+                              specials,
+                              sizeof(specials)/sizeof(specials[0])));
+  }
+
+  // pseudo-random values over several decades and batch sizes
+  for (k=0; k<200; k++) {
+    int count = 1 + k % 13;
+    for (j=0; j<count; j++) {
+      seed = seed * 1103515245 + 12345;
+      float mantissa = (float)(seed >> 8) / (float)(1 << 24);
+      vs[j] = mantissa * mu_pow10((int)(seed % 9) - 3);
+      if (seed & 0x80) {
+        vs[j] = -vs[j];
+      }
+    }
+    MU_TEST(check_float_batch(fmts[k % 8], vs, count));
+  }
+}
+#endif
+
+#if MU_PRINTF_ENABLE_STRUCTURED
+void mu_structured_test() {
+  PRINTF("...mu_structured_test\r\n");
+  mu_structured_t json, logfmt;
+
+  MU_TEST(mu_structured_compile(&json, "id=%d n=%+5d", MU_STRUCTURED_JSON) == 2);
+  MU_TEST(json.fields[0].name_length == 2);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json, 7, -12) == 16);
+  MU_TEST(check_test_emitter("{\"id\":7,\"n\":-12}"));
+
+  MU_TEST(mu_structured_compile(&logfmt, "id=%d n=%+5d", MU_STRUCTURED_LOGFMT) == 2);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &logfmt, 7, 12) == 9);
+  MU_TEST(check_test_emitter("id=7 n=12"));
+
+  // strings are quoted and escaped; names may be followed by ':' and spaces
+  static char const str_fmt[] = "user: %s, sep %c, %q, load=%d%%";
+  MU_TEST(mu_structured_compile(&json, str_fmt, MU_STRUCTURED_JSON) == -1);
+  static char const str_fmt2[] = "user: %s, sep %c msg=%q load=%d%%";
+  MU_TEST(mu_structured_compile(&json, str_fmt2, MU_STRUCTURED_JSON) == 4);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json,
+                               "bob", '"', "say \"hi\"\n", 50) == 56);
+  MU_TEST(check_test_emitter("{\"user\":\"bob\",\"sep\":\"\\\"\","
+                             "\"msg\":\"say \\\"hi\\\"\\n\",\"load\":50}"));
+
+  MU_TEST(mu_structured_compile(&logfmt, str_fmt2, MU_STRUCTURED_LOGFMT) == 4);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &logfmt,
+                               "bob", '=', "a b", 50) == 36);
+  MU_TEST(check_test_emitter("user=\"bob\" sep=\"=\" msg=\"a b\" load=50"));
+
+#if MU_PRINTF_ENABLE_FLAGS
+  // hex is a string in JSON, but not in logfmt
+  MU_TEST(mu_structured_compile(&json, "addr=%#x", MU_STRUCTURED_JSON) == 1);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json, 0xbeef) == 17);
+  MU_TEST(check_test_emitter("{\"addr\":\"0xbeef\"}"));
+
+  MU_TEST(mu_structured_compile(&logfmt, "addr=%#x", MU_STRUCTURED_LOGFMT) == 1);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &logfmt, 0xbeef) == 11);
+  MU_TEST(check_test_emitter("addr=0xbeef"));
+#endif
+
+#if MU_PRINTF_ENABLE_FLOAT
+  MU_TEST(mu_structured_compile(&json, "temp=%8.1f", MU_STRUCTURED_JSON) == 1);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json, -21.5) == 14);
+  MU_TEST(check_test_emitter("{\"temp\":-21.5}"));
+
+  // '#' would leave a trailing '.', which is not a JSON number
+  MU_TEST(mu_structured_compile(&json, "a=%#.0f", MU_STRUCTURED_JSON) == 1);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json, 2.0) == 7);
+  MU_TEST(check_test_emitter("{\"a\":2}"));
+#if MU_PRINTF_ENABLE_E
+  MU_TEST(mu_structured_compile(&json, "b=%#.0e", MU_STRUCTURED_JSON) == 1);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json, 3.0) == 11);
+  MU_TEST(check_test_emitter("{\"b\":3e+00}"));
+#endif
+#endif
+
+  MU_TEST(mu_structured_compile(&json, "", MU_STRUCTURED_JSON) == 0);
+  MU_TEST(mu_structured_printf(test_emitter, NULL, &json) == 2);
+  MU_TEST(check_test_emitter("{}"));
+
+  // every directive needs a name and a supported conversion
+  MU_TEST(mu_structured_compile(&json, "%d", MU_STRUCTURED_JSON) == -1);
+  MU_TEST(mu_structured_compile(&json, "a=%d, =%d", MU_STRUCTURED_JSON) == -1);
+  MU_TEST(mu_structured_compile(&json, "a=%k", MU_STRUCTURED_JSON) == -1);
+  MU_TEST(mu_structured_compile(&json, "a\"b=%d", MU_STRUCTURED_JSON) == 1);
+  MU_TEST(json.fields[0].name_length == 1);
+  MU_TEST(mu_structured_compile(&json,
+      "a=%d b=%d c=%d d=%d e=%d f=%d g=%d h=%d", MU_STRUCTURED_JSON) == 8);
+  MU_TEST(mu_structured_compile(&json,
+      "a=%d b=%d c=%d d=%d e=%d f=%d g=%d h=%d i=%d", MU_STRUCTURED_JSON) == -1);
+}
+#endif
+
+// ======================================================================
+// mu_measure() agrees with what mu_printf() emits
+
+int count_index = 0;
+
+int count_emitter(void *obj, char ch) {
+  count_index += 1;
+  return 1;
+}
+
+bool check_measure(int measured, int printed) {
+  bool match = measured == printed && printed == count_index;
+  count_index = 0;
+  return match;
+}
+
+#define CHECK_MEASURE(...) \
+  check_measure(mu_measure(__VA_ARGS__), \
+                mu_printf(count_emitter, NULL, __VA_ARGS__))
+
+void mu_measure_test() {
+  PRINTF("...mu_measure_test\r\n");
+  static char const *int_fmts[] = {
+    "%d", "%i", "%5d", "%-5d", "%05d", "%+d", "% d", "%.0d", "%.3d", "%8.3d",
+    "%+.0d", "%x", "%#x", "%08X", "%#8X", "%o", "%#o", "%p", "%#b", "%-#12b",
+  };
+  static int ints[] = {
+    0, 1, -1, 9, 10, 99, 100, 12345, 2147483647, -2147483647 - 1,
+  };
+  static char const *str_fmts[] = {
+    "%s", "%.0s", "%.3s", "%10s", "%-10.2s", "%3s",
+#if MU_PRINTF_ENABLE_ESCAPE
+    "%j", "%q", "%.1j", "%8q", "%-8.3j",
+#endif
+  };
+  static char const *strs[] = {
+    "", "ab", "abcdef", "a\"b\n",
+  };
+  unsigned int i, j;
+
+  MU_TEST(mu_measure("") == 0);
+  MU_TEST(mu_measure("hello") == 5);
+  MU_TEST(CHECK_MEASURE("100%% sure"));
+  MU_TEST(CHECK_MEASURE("%c%c", 'a', 'b'));
+  MU_TEST(CHECK_MEASURE("x%ky%dz", 42));
+  MU_TEST(CHECK_MEASURE("%d:%s=%x\n", -7, "key", 0xbeef));
+  MU_TEST(CHECK_MEASURE("%255d", 1));
+
+  for (i=0; i<sizeof(int_fmts)/sizeof(int_fmts[0]); i++) {
+    for (j=0; j<sizeof(ints)/sizeof(ints[0]); j++) {
+      MU_TEST(CHECK_MEASURE(int_fmts[i], ints[j]));
+    }
+  }
+  for (i=0; i<sizeof(str_fmts)/sizeof(str_fmts[0]); i++) {
+    for (j=0; j<sizeof(strs)/sizeof(strs[0]); j++) {
+      MU_TEST(CHECK_MEASURE(str_fmts[i], strs[j]));
+    }
+  }
+
+#if MU_PRINTF_ENABLE_FLOAT
+  static char const *float_fmts[] = {
+    "%f", "%F", "%.0f", "%#.0f", "%10.3f", "%-12.2f", "%+f", "% .1f",
+    "%012.4f", "%.9f",
+#if MU_PRINTF_ENABLE_E
+    "%e", "%.0e", "%#.0e", "%12.2e", "%-+14.3E", "%08.1e", "%.9e",
+#endif
+  };
+  static double doubles[] = {
+    0.0, 9.99, 9.9999999, 0.5, 0.05, 99.5, 123456.0, 1e-10, 1e20, -3.75,
+    0.000123, -999999.9,
+  };
+  for (i=0; i<sizeof(float_fmts)/sizeof(float_fmts[0]); i++) {
+    for (j=0; j<sizeof(doubles)/sizeof(doubles[0]); j++) {
+      MU_TEST(CHECK_MEASURE(float_fmts[i], doubles[j]));
+    }
+  }
+  MU_TEST(CHECK_MEASURE("t=%8.2f %s", -40.0, "C"));
+#endif
 }
 
+#if MU_PRINTF_ENABLE_STATS
+// ======================================================================
+// instrumentation
+
+uint32_t fake_cycles;
+
+// a cycle counter that advances by 10 every time it is read
+uint32_t fake_cycle_counter(void) {
+  fake_cycles += 10;
+  return fake_cycles;
+}
+
+void mu_stats_test() {
+  PRINTF("...mu_stats_test\r\n");
+  static char const fmt[] = "n=%d %s%%";
+  static char formats[MU_PRINTF_STATS_FORMATS + 1][2];
+  mu_stats_t stats;
+  int i;
+
+  mu_stats_reset();
+  mu_stats_set_cycle_counter(NULL);
+  MU_TEST(mu_printf(test_emitter, NULL, fmt, 42, "ab") == 8);
+  MU_TEST(check_test_emitter("n=42 ab%"));
+  mu_stats_snapshot(&stats);
+  MU_TEST(stats.conversions[mu_stats_index('d')].calls == 1);
+  MU_TEST(stats.conversions[mu_stats_index('d')].bytes == 2);
+  MU_TEST(stats.conversions[mu_stats_index('d')].cycles == 0);
+  MU_TEST(stats.conversions[mu_stats_index('s')].calls == 1);
+  MU_TEST(stats.conversions[MU_STATS_OTHER].calls == 1);
+  MU_TEST(stats.conversions[mu_stats_index('x')].calls == 0);
+  MU_TEST(stats.formats[0].fmt == fmt);
+  MU_TEST(stats.formats[0].counter.calls == 1);
+  MU_TEST(stats.formats[0].counter.bytes == 8);
+  MU_TEST(stats.formats[1].fmt == NULL);
+
+  // cycles, including across a wrap of the counter
+  mu_stats_reset();
+  fake_cycles = 0xfffffff0;
+  mu_stats_set_cycle_counter(fake_cycle_counter);
+  MU_TEST(mu_printf(test_emitter, NULL, fmt, -1, "") == 6);
+  MU_TEST(check_test_emitter("n=-1 %"));
+  mu_stats_snapshot(&stats);
+  MU_TEST(stats.conversions[mu_stats_index('d')].cycles == 10);
+  MU_TEST(stats.conversions[mu_stats_index('s')].cycles == 10);
+  MU_TEST(stats.formats[0].counter.cycles == 70);
+  MU_TEST(mu_stats_index('X') == mu_stats_index('x'));
+
+  // formats beyond the last slot are only counted as dropped
+  mu_stats_reset();
+  for (i=0; i<MU_PRINTF_STATS_FORMATS + 1; i++) {
+    formats[i][0] = 'x';
+    mu_printf(test_emitter, NULL, formats[i]);
+  }
+  mu_printf(test_emitter, NULL, formats[0]);
+  mu_stats_snapshot(&stats);
+  MU_TEST(stats.formats[0].counter.calls == 2);
+  MU_TEST(stats.formats[MU_PRINTF_STATS_FORMATS - 1].fmt ==
+          formats[MU_PRINTF_STATS_FORMATS - 1]);
+  MU_TEST(stats.formats_dropped == 1);
+  mu_stats_set_cycle_counter(NULL);
+}
+#endif
+
 void mu_printf_test() {
   PRINTF("begin tests...\r\n");
   mu_null_emitter_test();
+#if MU_PRINTF_ENABLE_FLOAT
   mu_precision_test();
+#endif
   mu_pad_test();
+#if MU_PRINTF_ENABLE_FLOAT
   mu_floor_log10_test();
   mu_pow10_test();
+#endif
   mu_puti_test();
+  mu_count_digits_test();
+#if MU_PRINTF_ENABLE_FLOAT
   mu_putf_test();
+#endif
   mu_parse_directive_test();
+  mu_printf_disabled_test();
   mu_printf_c_test();
   mu_printf_s_test();
+#if MU_PRINTF_ENABLE_ESCAPE
+  mu_printf_escape_test();
+#endif
   mu_printf_d_test();
   mu_printf_u_test();
   // mu_printf_f_test();
+#if MU_PRINTF_ENABLE_E
   mu_printf_e_test();
+#endif
+  mu_format_array_test();
+#if MU_PRINTF_ENABLE_FLOAT
+  mu_format_array_float_batch_test();
+#endif
+#if MU_PRINTF_ENABLE_STRUCTURED
+  mu_structured_test();
+#endif
+  mu_measure_test();
+#if MU_PRINTF_ENABLE_STATS
+  mu_stats_test();
+#endif
   PRINTF("...end of tests\r\n");
 }
 
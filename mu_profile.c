@@ -0,0 +1,124 @@
+/*
+ * mu_profile.c
+ *
+ * gcc -Wall -O2 -DMU_PRINTF_ENABLE_PROFILE=1 -c mu_profile.c mu_printf.c
+ */
+
+#include "mu_profile.h"
+
+#if (MU_PRINTF_PROFILE_SETS & (MU_PRINTF_PROFILE_SETS - 1)) != 0
+#error "MU_PRINTF_PROFILE_SETS must be a power of two"
+#endif
+
+static mu_profile_entry_t s_table[MU_PROFILE_SIZE];
+
+// =============================================================================
+// forward declarations
+
+mu_profile_entry_t *profile_set(char const *fmt);
+int emit_count(emitter_t emitter_fn, void *obj, uint32_t v, char sep);
+
+// =============================================================================
+// Code
+
+void mu_profile_record(char const *fmt, int n_bytes) {
+  mu_profile_entry_t *set = profile_set(fmt);
+  mu_profile_entry_t *victim = set;
+  int i;
+
+  for (i=0; i<MU_PRINTF_PROFILE_WAYS; i++) {
+    mu_profile_entry_t *entry = &set[i];
+    if (entry->fmt == fmt) {
+      entry->count += 1;
+      entry->bytes += n_bytes;
+      return;
+    }
+    if (entry->count < victim->count) {
+      victim = entry;
+    }
+  }
+  // Space-Saving: take over the least counted entry, keeping its count as the
+  // error bound.  An unused entry has a count of zero, so it goes first.
+  victim->fmt = fmt;
+  victim->error = victim->count;
+  victim->count += 1;
+  victim->bytes = n_bytes;
+}
+
+void mu_profile_reset(void) {
+  static const mu_profile_entry_t empty;
+  int i;
+
+  for (i=0; i<MU_PROFILE_SIZE; i++) {
+    s_table[i] = empty;
+  }
+}
+
+int mu_profile_top(mu_profile_entry_t *top, int n) {
+  int n_top = 0;
+  int i, j;
+
+  // insertion sort of the used entries into top[], keeping the best n
+  for (i=0; i<MU_PROFILE_SIZE; i++) {
+    mu_profile_entry_t const *entry = &s_table[i];
+    if (entry->fmt == (void *)0) {
+      continue;
+    }
+    j = n_top < n ? n_top++ : n;
+    while (j > 0 && top[j - 1].count < entry->count) {
+      if (j < n) {
+        top[j] = top[j - 1];
+      }
+      j--;
+    }
+    if (j < n) {
+      top[j] = *entry;
+    }
+  }
+  return n_top;
+}
+
+int mu_profile_dump(emitter_t emitter_fn, void *obj, int n) {
+  mu_profile_entry_t top[MU_PROFILE_SIZE];
+  int n_emitted = 0;
+  int i;
+
+  // Formatted with the emit primitives rather than mu_printf(), which would
+  // record the dump's own formats in the table.
+  n = mu_profile_top(top, n < MU_PROFILE_SIZE ? n : MU_PROFILE_SIZE);
+  for (i=0; i<n; i++) {
+    n_emitted += emit_count(emitter_fn, obj, top[i].count, ' ');
+    n_emitted += emit_count(emitter_fn, obj, top[i].error, ' ');
+    n_emitted += emit_count(emitter_fn, obj, top[i].bytes, ' ');
+    n_emitted += mu_emit_char(emitter_fn, obj, '"');
+    n_emitted += mu_emit_escaped(emitter_fn, obj, top[i].fmt, -1, false);
+    n_emitted += mu_emit_block(emitter_fn, obj, "\"\n", 2);
+  }
+  return n_emitted;
+}
+
+// =============================================================================
+// =============================================================================
+
+/*
+ * Return the first entry of the set that fmt hashes to.  String literals are
+ * at least char aligned and often word aligned, so the pointer is mixed with
+ * a multiplicative (Fibonacci) hash and the high bits used.
+ */
+mu_profile_entry_t *profile_set(char const *fmt) {
+  uint32_t h = (uint32_t)(uintptr_t)fmt * 2654435761u;
+  uint32_t set = (h >> 16) & (MU_PRINTF_PROFILE_SETS - 1);
+  return &s_table[set * MU_PRINTF_PROFILE_WAYS];
+}
+
+// Emit v in decimal (0 as "0") followed by sep.
+int emit_count(emitter_t emitter_fn, void *obj, uint32_t v, char sep) {
+  int n_emitted;
+
+  if (v == 0) {
+    n_emitted = mu_emit_char(emitter_fn, obj, '0');
+  } else {
+    n_emitted = mu_emit_integer(emitter_fn, obj, v, 10, false);
+  }
+  return n_emitted + mu_emit_char(emitter_fn, obj, sep);
+}
@@ -0,0 +1,67 @@
+/*
+ * mu_profile - find the format strings that dominate formatting work
+ *
+ * When built with MU_PRINTF_ENABLE_PROFILE=1, every mu_vprintf() call
+ * records its fmt pointer and output length here.  Format strings are kept
+ * in a fixed-size heavy-hitters table using the Space-Saving algorithm: a
+ * format that is not in the table takes over the entry with the lowest count,
+ * inheriting that count as its error bound.  Frequent formats therefore stay
+ * put, and the top entries are the candidates for precompilation.
+ *
+ * To keep the per-call cost small and constant, the table is set associative:
+ * fmt is hashed to one set of MU_PRINTF_PROFILE_WAYS entries and only that
+ * set is searched (and, on a miss, evicted from).  A call costs one multiply
+ * and at most MU_PRINTF_PROFILE_WAYS compares.
+ *
+ * The table is not locked.  If mu_printf() runs from several threads or
+ * interrupts, concurrent calls can lose counts, but entries always hold a
+ * valid format pointer.
+ */
+
+#ifndef SOURCE_MU_PROFILE_H_
+#define SOURCE_MU_PROFILE_H_
+
+#include "mu_printf.h"
+
+#define MU_PROFILE_SIZE (MU_PRINTF_PROFILE_SETS * MU_PRINTF_PROFILE_WAYS)
+
+typedef struct {
+  char const *fmt;  // the format string, matched by address.  NULL if unused.
+  uint32_t count;   // calls: overestimates the true count by at most error
+  uint32_t error;   // count inherited when this format claimed the entry
+  uint32_t bytes;   // chars emitted since this format claimed the entry
+} mu_profile_entry_t;
+
+/*!
+ * @brief Record one call with format fmt that emitted n_bytes chars.
+ *
+ * Called by mu_vprintf() when MU_PRINTF_ENABLE_PROFILE is set.
+ */
+void mu_profile_record(char const *fmt, int n_bytes);
+
+/*!
+ * @brief Empty the table.
+ */
+void mu_profile_reset(void);
+
+/*!
+ * @brief Copy the (at most) n entries with the highest counts into top, in
+ * order of decreasing count.
+ *
+ * @return The number of entries copied.
+ */
+int mu_profile_top(mu_profile_entry_t *top, int n);
+
+/*!
+ * @brief Print the top n formats, one per line, with their source text.
+ *
+ * Each line holds the count, its error bound, the bytes emitted and the
+ * format string escaped as by %q, e.g.
+ *
+ *   1200 0 30000 "temp=%d\n"
+ *
+ * @return Number of chars emitted.
+ */
+int mu_profile_dump(emitter_t emitter_fn, void *obj, int n);
+
+#endif /* SOURCE_MU_PROFILE_H_ */
@@ -0,0 +1,140 @@
+/*
+ * mu_profile_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -DMU_PRINTF_ENABLE_PROFILE=1 -Wall -o mu_profile_test mu_profile_test.c mu_profile.c mu_printf.c && ./mu_profile_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_profile.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf) - 1) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+bool check_test_emitter(const char *expected) {
+  test_buf[test_index] = '\0';
+  test_index = 0;
+  return strcmp(expected, test_buf) == 0;
+}
+
+// ======================================================================
+// tests
+
+#define N_COLD 500
+
+static char const hot_a[] = "a=%d\n";
+static char const hot_b[] = "b=%s";
+static char const hot_c[] = "c";
+static char cold[N_COLD][2];
+
+void mu_profile_top_test() {
+  PRINTF("...mu_profile_top_test\r\n");
+  mu_profile_entry_t top[3];
+  int true_counts[3] = {0, 0, 0};
+  unsigned int seed = 1;
+  int n_cold = 0;
+  int i;
+
+  mu_profile_reset();
+  MU_TEST(mu_profile_top(top, 3) == 0);
+
+  // a skewed stream: three hot formats interleaved with many formats that
+  // are used only once
+  for (i=0; i<N_COLD; i++) {
+    cold[i][0] = 'x';
+  }
+  for (i=0; i<2200; i++) {
+    seed = seed * 1103515245 + 12345;
+    int pick = (seed >> 16) % 22;
+    if (pick < 10) {
+      mu_printf(test_emitter, NULL, hot_a, i);
+      true_counts[0] += 1;
+    } else if (pick < 15) {
+      mu_printf(test_emitter, NULL, hot_b, "xyz");
+      true_counts[1] += 1;
+    } else if (pick < 17 || n_cold == N_COLD) {
+      mu_printf(test_emitter, NULL, hot_c);
+      true_counts[2] += 1;
+    } else {
+      mu_printf(test_emitter, NULL, cold[n_cold++]);
+    }
+    test_index = 0;
+  }
+
+  MU_TEST(mu_profile_top(top, 3) == 3);
+  MU_TEST(top[0].fmt == hot_a);
+  MU_TEST(top[1].fmt == hot_b);
+  MU_TEST(top[2].fmt == hot_c);
+  for (i=0; i<3; i++) {
+    // Space-Saving never undercounts, and the error bound holds
+    MU_TEST(top[i].count >= (uint32_t)true_counts[i]);
+    MU_TEST(top[i].count - top[i].error <= (uint32_t)true_counts[i]);
+  }
+  MU_TEST(top[1].bytes <= 5 * top[1].count);
+
+  // asking for fewer gives the same leaders
+  MU_TEST(mu_profile_top(top, 1) == 1);
+  MU_TEST(top[0].fmt == hot_a);
+}
+
+void mu_profile_dump_test() {
+  PRINTF("...mu_profile_dump_test\r\n");
+  static char const fmt[] = "x\t\"%d\"\n";
+  static char const fmt_ctl[] = "\x01";
+
+  mu_profile_reset();
+  mu_printf(test_emitter, NULL, fmt, 5);
+  mu_printf(test_emitter, NULL, fmt, 42);
+  mu_printf(test_emitter, NULL, fmt_ctl);
+  test_index = 0;
+
+  MU_TEST(mu_profile_dump(test_emitter, NULL, 1) == 21);
+  MU_TEST(check_test_emitter("2 0 13 \"x\\t\\\"%d\\\"\\n\"\n"));
+
+  MU_TEST(mu_profile_dump(test_emitter, NULL, 5) == 34);
+  MU_TEST(check_test_emitter("2 0 13 \"x\\t\\\"%d\\\"\\n\"\n"
+                             "1 0 1 \"\\001\"\n"));
+
+  // the dump does not profile itself
+  mu_profile_entry_t top[4];
+  MU_TEST(mu_profile_top(top, 4) == 2);
+}
+
+void mu_profile_test() {
+  PRINTF("begin tests...\r\n");
+  mu_profile_top_test();
+  mu_profile_dump_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_profile_test();
+}
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * mu_recorder.c
+ *
+ * gcc -Wall -O2 -c mu_recorder.c mu_printf.c
+ */
+
+#include "mu_recorder.h"
+#include <stddef.h>
+
+// keep the compiler from moving stores to the region across this point, so
+// that a reset finds them in program order
+#define REGION_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// =============================================================================
+// forward declarations
+
+char *recorder_reserve(mu_sink_t *sink, int *n);
+void recorder_commit(mu_sink_t *sink, int n);
+bool header_is_valid(mu_recorder_t const *recorder,
+                     mu_recorder_header_t const *header,
+                     uint32_t size);
+uint32_t header_crc(mu_recorder_t const *recorder,
+                    mu_recorder_header_t const *header);
+uint32_t recorder_crc32(uint32_t crc, void const *buf, int n);
+void recorder_update(mu_recorder_t *recorder,
+                     uint32_t position,
+                     uint32_t length,
+                     uint32_t last);
+
+static const mu_sink_vtable_t s_recorder_vtable = {
+  recorder_reserve,
+  recorder_commit,
+  (void *)0  // every commit is already recorded
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_recorder_attach(mu_recorder_t *recorder,
+                              void *region,
+                              int region_size,
+                              mu_crc_fn crc_fn) {
+  mu_recorder_header_t *headers = region;
+  uint32_t size;
+  bool valid0;
+  bool valid1;
+
+  // a commit never fills the buffer (see recorder_reserve()), so it needs
+  // room for two chars to hold one
+  if (region_size < (int)(2 * sizeof(mu_recorder_header_t)) + 2) {
+    return (void *)0;
+  }
+  size = region_size - 2 * sizeof(mu_recorder_header_t);
+  recorder->sink.vtable = &s_recorder_vtable;
+  recorder->crc_fn = crc_fn ? crc_fn : recorder_crc32;
+  recorder->headers = headers;
+  recorder->data = (char *)(headers + 2);
+  valid0 = header_is_valid(recorder, &headers[0], size);
+  valid1 = header_is_valid(recorder, &headers[1], size);
+  recorder->recovered = valid0 || valid1;
+  if (valid0 && valid1) {
+    // the newer copy, allowing for the sequence number wrapping around
+    recorder->header = (int32_t)(headers[1].sequence -
+                                 headers[0].sequence) > 0 ? &headers[1]
+                                                          : &headers[0];
+  } else if (recorder->recovered) {
+    recorder->header = valid1 ? &headers[1] : &headers[0];
+  } else {
+    // an invalid copy to start from: the first update writes the other one
+    recorder->header = &headers[1];
+    headers[1].sequence = 0;
+    headers[1].magic = 0;
+    headers[1].size = size;
+    mu_recorder_clear(recorder);
+  }
+  return &recorder->sink;
+}
+
+int mu_recorder_dump(mu_recorder_t *recorder, emitter_t emitter_fn, void *obj) {
+  mu_recorder_header_t const *header = recorder->header;
+  int start = header->position - header->length;
+  int n_emitted = 0;
+
+  if (start < 0) {
+    // the log wraps: its oldest part is at the end of the buffer
+    start += header->size;
+    n_emitted += mu_emit_block(emitter_fn, obj, &recorder->data[start],
+                               header->size - start);
+    start = 0;
+  }
+  n_emitted += mu_emit_block(emitter_fn, obj, &recorder->data[start],
+                             header->position - start);
+  return n_emitted;
+}
+
+void mu_recorder_clear(mu_recorder_t *recorder) {
+  recorder_update(recorder, 0, 0, 0);
+}
+
+// =============================================================================
+// =============================================================================
+
+char *recorder_reserve(mu_sink_t *sink, int *n) {
+  mu_recorder_t *recorder = (mu_recorder_t *)sink;
+  mu_recorder_header_t const *header = recorder->header;
+  int room = header->size - header->position;
+
+  // never full: up to the end of the buffer, over the oldest chars, but
+  // sparing the last commit's chars, which the current header's CRC covers.
+  // Only a reservation at the start of the buffer can reach them, and one
+  // char short of the whole buffer, so there is always a char to spare.
+  if (header->position == 0) {
+    room -= header->last ? header->last : 1;
+  }
+  if (*n > room) {
+    *n = room;
+  }
+  return &recorder->data[header->position];
+}
+
+void recorder_commit(mu_sink_t *sink, int n) {
+  mu_recorder_t *recorder = (mu_recorder_t *)sink;
+  mu_recorder_header_t const *header = recorder->header;
+  uint32_t position = header->position + n;
+  uint32_t length = header->length + n;
+
+  if (position == header->size) {
+    position = 0;
+  }
+  if (length > header->size) {
+    length = header->size;
+  }
+  recorder_update(recorder, position, length, n);
+}
+
+/*
+ * A copy is valid if it describes a log that fits a buffer of size chars and
+ * its CRC matches.
+ */
+bool header_is_valid(mu_recorder_t const *recorder,
+                     mu_recorder_header_t const *header,
+                     uint32_t size) {
+  return header->magic == MU_RECORDER_MAGIC &&
+         header->size == size &&
+         header->position < size &&
+         header->length <= size &&
+         header->last <= header->length &&
+         header->last < size &&
+         header->last <= (header->position ? header->position : size) &&
+         header->crc == header_crc(recorder, header);
+}
+
+// The CRC of the header fields before crc, then of the last commit's chars.
+uint32_t header_crc(mu_recorder_t const *recorder,
+                    mu_recorder_header_t const *header) {
+  uint32_t end = header->position ? header->position : header->size;
+  uint32_t crc = recorder->crc_fn(0, header,
+                                  offsetof(mu_recorder_header_t, crc));
+
+  return recorder->crc_fn(crc, &recorder->data[end - header->last],
+                          header->last);
+}
+
+/*
+ * CRC-32 as computed by mu_crc32_update(), a nibble at a time from a 16
+ * entry table, for when the recorder is given no crc_fn: a commit covers a
+ * few dozen bytes, and this keeps the 8 KiB slice-by-8 tables out of the
+ * image.
+ */
+uint32_t recorder_crc32(uint32_t crc, void const *buf, int n) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+  };
+  uint8_t const *p = buf;
+
+  crc = ~crc;
+  while (n-- > 0) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ table[crc & 0xf];
+    crc = (crc >> 4) ^ table[crc & 0xf];
+  }
+  return ~crc;
+}
+
+/*
+ * Write the other copy of the header and make it the current one.  The CRC
+ * goes last: until it is written, the copy is invalid and attach uses the
+ * current one.
+ */
+void recorder_update(mu_recorder_t *recorder,
+                     uint32_t position,
+                     uint32_t length,
+                     uint32_t last) {
+  mu_recorder_header_t *current = recorder->header;
+  mu_recorder_header_t *next = recorder->headers +
+                               (current == recorder->headers);
+
+  REGION_BARRIER();  // the chars are in place before any of the header
+  next->sequence = current->sequence + 1;
+  next->magic = MU_RECORDER_MAGIC;
+  next->size = current->size;
+  next->position = position;
+  next->length = length;
+  next->last = last;
+  REGION_BARRIER();
+  next->crc = header_crc(recorder, next);
+  REGION_BARRIER();
+  recorder->header = next;
+}
@@ -0,0 +1,95 @@
+/*
+ * mu_recorder - a RAM flight recorder that survives a warm reset
+ *
+ * Printing logs over a UART costs time on every call; a flight recorder costs
+ * a memory copy, and the log is read only when something has gone wrong.  A
+ * mu_recorder_t is a sink (see mu_sink_t in mu_printf.h) that keeps the most
+ * recent output in a circular buffer, overwriting the oldest chars.
+ *
+ * The buffer and a small header live in a region of RAM that the startup
+ * code does not clear, such as a .noinit section:
+ *
+ *   static uint32_t region[1024] MU_RECORDER_NOINIT;
+ *   mu_recorder_t rec;
+ *   mu_sink_t *log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+ *   if (rec.recovered) {
+ *     mu_recorder_dump(&rec, uart_emitter, NULL);  // what happened last time
+ *   }
+ *   mu_printf(mu_sink_emitter, log, "t=%d\n", t);
+ *
+ * The region starts with two copies of a header that holds a magic number,
+ * the buffer size, the write position and a CRC-32.  Each commit writes the
+ * older copy and gives it the next sequence number, so a reset part way
+ * through leaves the other copy intact, and mu_recorder_attach() takes the
+ * newest copy whose CRC checks out.  The CRC covers the header fields and
+ * the chars of the commit it records; older chars are not checksummed, and a
+ * fault in the middle of a call leaves that call's text cut short.  A region
+ * that was never written or was garbled by a cold start is simply cleared.
+ * The CRC is computed a nibble at a time unless attach is given a mu_crc_fn,
+ * such as mu_crc32_update() or one that drives a CRC unit.
+ *
+ * On a host the region can be any memory that outlives the process, e.g. a
+ * file that is read back in, or a shared memory segment.
+ */
+
+#ifndef SOURCE_MU_RECORDER_H_
+#define SOURCE_MU_RECORDER_H_
+
+#include "mu_crc.h"
+#include "mu_printf.h"
+
+// place a region where the C runtime will not zero it (the linker script must
+// provide a .noinit output section)
+#define MU_RECORDER_NOINIT __attribute__((__section__(".noinit")))
+
+#define MU_RECORDER_MAGIC 0x6d755246  // "muRF"
+
+// one of the two copies at the start of the region
+typedef struct {
+  uint32_t sequence;  // one more than the other copy's, when this is current
+  uint32_t magic;     // MU_RECORDER_MAGIC
+  uint32_t size;      // chars in the buffer that follows
+  uint32_t position;  // where the next char goes
+  uint32_t length;    // chars held, at most size
+  uint32_t last;      // chars written by the last commit, ending at position
+  uint32_t crc;       // CRC-32 of the fields above and the last commit's chars
+} mu_recorder_header_t;
+
+typedef struct {
+  mu_sink_t sink;                 // must come first
+  mu_crc_fn crc_fn;               // computes the header CRCs
+  mu_recorder_header_t *headers;  // the two copies, at the start of the region
+  mu_recorder_header_t *header;   // the current copy
+  char *data;                     // the circular buffer, after the headers
+  bool recovered;                 // the region held a valid log when attached
+} mu_recorder_t;
+
+/*!
+ * @brief Attach recorder to a region, keeping the log already there if a
+ * header copy is intact and clearing it otherwise.
+ *
+ * @param recorder The recorder.
+ * @param region Word-aligned memory that survives a reset.
+ * @param region_size Size of region in chars, headers included.
+ * @param crc_fn The CRC routine, or NULL for a small built-in one.
+ * @return The sink, to be passed as obj with mu_sink_emitter, or NULL if
+ * region has no room for two headers and two chars.
+ */
+mu_sink_t *mu_recorder_attach(mu_recorder_t *recorder,
+                              void *region,
+                              int region_size,
+                              mu_crc_fn crc_fn);
+
+/*!
+ * @brief Emit the log, oldest char first.
+ *
+ * @return Number of chars emitted.
+ */
+int mu_recorder_dump(mu_recorder_t *recorder, emitter_t emitter_fn, void *obj);
+
+/*!
+ * @brief Empty the log.
+ */
+void mu_recorder_clear(mu_recorder_t *recorder);
+
+#endif /* SOURCE_MU_RECORDER_H_ */
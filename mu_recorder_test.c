@@ -0,0 +1,260 @@
+/*
+ * mu_recorder_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_recorder_test mu_recorder_test.c mu_recorder.c mu_crc.c mu_printf.c && ./mu_recorder_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_recorder.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf) - 1) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+bool check_test_emitter(const char *expected) {
+  test_buf[test_index] = '\0';
+  test_index = 0;
+  return strcmp(expected, test_buf) == 0;
+}
+
+// two headers and 16 chars of log
+#define REGION_SIZE (2 * sizeof(mu_recorder_header_t) + 16)
+
+// ======================================================================
+// tests
+
+void mu_recorder_ring_test() {
+  PRINTF("...mu_recorder_ring_test\r\n");
+  static uint32_t region[REGION_SIZE / 4];
+  mu_recorder_t rec;
+
+  memset(region, 0x5a, sizeof(region));  // whatever was in RAM at power-up
+  mu_sink_t *log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  MU_TEST(!rec.recovered);
+  MU_TEST(mu_recorder_dump(&rec, test_emitter, NULL) == 0);
+
+  MU_TEST(mu_printf(mu_sink_emitter, log, "a=%d\n", 1) == 4);
+  MU_TEST(mu_printf(mu_sink_emitter, log, "b=%s\n", "two") == 6);
+  MU_TEST(mu_recorder_dump(&rec, test_emitter, NULL) == 10);
+  MU_TEST(check_test_emitter("a=1\nb=two\n"));
+
+  // older output is overwritten, the newest 16 chars are kept in order
+  MU_TEST(mu_printf(mu_sink_emitter, log, "c=%x\n", 0xabc) == 6);
+  MU_TEST(mu_printf(mu_sink_emitter, log, "d=%5d\n", 4) == 8);
+  MU_TEST(mu_recorder_dump(&rec, test_emitter, NULL) == 16);
+  MU_TEST(check_test_emitter("o\nc=abc\nd=    4\n"));
+
+  // longer than the whole buffer
+  MU_TEST(mu_printf(mu_sink_emitter, log, "%s", "0123456789abcdefghij") == 20);
+  MU_TEST(mu_recorder_dump(&rec, test_emitter, NULL) == 16);
+  MU_TEST(check_test_emitter("456789abcdefghij"));
+
+  mu_recorder_clear(&rec);
+  MU_TEST(mu_recorder_dump(&rec, test_emitter, NULL) == 0);
+}
+
+void mu_recorder_reset_test() {
+  PRINTF("...mu_recorder_reset_test\r\n");
+  static uint32_t region[REGION_SIZE / 4];
+  mu_recorder_t rec;
+  mu_recorder_t after_reset;
+
+  memset(region, 0, sizeof(region));
+  mu_sink_t *log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  MU_TEST(!rec.recovered);
+  mu_printf(mu_sink_emitter, log, "fault at %x\n", 0x8000);
+
+  // attaching again (as after a warm reset) finds the log
+  log = mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 14);
+  MU_TEST(check_test_emitter("fault at 8000\n"));
+
+  // and keeps appending to it
+  mu_printf(mu_sink_emitter, log, "ok");
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 16);
+  MU_TEST(check_test_emitter("fault at 8000\nok"));
+
+  // a region of another size is not taken for a log
+  log = mu_recorder_attach(&after_reset, region, sizeof(region) - 4, NULL);
+  MU_TEST(!after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 0);
+
+  // nor is one whose headers were both disturbed
+  log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  mu_printf(mu_sink_emitter, log, "abc");
+  rec.headers[0].length -= 1;
+  rec.headers[1].length -= 1;
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(!after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 0);
+
+  // a region with no room for a log is refused
+  MU_TEST(mu_recorder_attach(&rec, region,
+                             2 * sizeof(mu_recorder_header_t) + 1,
+                             NULL) == NULL);
+  MU_TEST(mu_recorder_attach(&rec, region, 0, NULL) == NULL);
+  MU_TEST(mu_recorder_attach(&rec, region,
+                             2 * sizeof(mu_recorder_header_t) + 2,
+                             NULL) != NULL);
+}
+
+void mu_recorder_torn_test() {
+  PRINTF("...mu_recorder_torn_test\r\n");
+  static uint32_t region[REGION_SIZE / 4];
+  static uint32_t saved[REGION_SIZE / 4];
+  mu_recorder_t rec;
+  mu_recorder_t after_reset;
+
+  memset(region, 0, sizeof(region));
+  mu_sink_t *log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  mu_printf(mu_sink_emitter, log, "one\n");
+  mu_printf(mu_sink_emitter, log, "two\n");
+
+  // a reset part way through a header update: the copy being written has
+  // its new position but not yet its CRC, so the previous copy is used
+  memcpy(saved, region, sizeof(region));
+  mu_printf(mu_sink_emitter, log, "three\n");
+  mu_recorder_header_t *written = rec.header;
+  mu_recorder_header_t torn = *written;
+  memcpy(region, saved, sizeof(region));
+  written->sequence = torn.sequence;
+  written->position = torn.position;
+  written->length = torn.length;
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 8);
+  MU_TEST(check_test_emitter("one\ntwo\n"));
+
+  // the update completed: the newer copy wins
+  memcpy(region, saved, sizeof(region));
+  log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  mu_printf(mu_sink_emitter, log, "three\n");
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 14);
+  MU_TEST(check_test_emitter("one\ntwo\nthree\n"));
+
+  // the CRC covers the last call's text: if it was garbled, the log goes
+  // back to before that call
+  rec.data[10] ^= 1;
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 8);
+  MU_TEST(check_test_emitter("one\ntwo\n"));
+
+  // a reset while a call overwrites the whole buffer: the chars the current
+  // header's CRC covers are never handed out, so that header stays valid
+  memset(region, 0, sizeof(region));
+  log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  mu_printf(mu_sink_emitter, log, "%s", "0123456789abcdef");
+  int n = 16;
+  char *p = log->vtable->reserve(log, &n);
+  MU_TEST(n < 16);
+  memset(p, '#', n);
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(after_reset.header->sequence == rec.header->sequence);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 16);
+  MU_TEST(check_test_emitter("###############f"));  // older chars: cut short
+
+  // sequence numbers wrap around
+  memset(region, 0, sizeof(region));
+  log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  rec.header->sequence = 0xfffffffe;
+  mu_recorder_clear(&rec);
+  mu_printf(mu_sink_emitter, log, "wrapped");
+  MU_TEST(rec.header->sequence == 0);
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 7);
+  MU_TEST(check_test_emitter("wrapped"));
+}
+
+void mu_recorder_crc_test() {
+  PRINTF("...mu_recorder_crc_test\r\n");
+  static uint32_t region[REGION_SIZE / 4];
+  mu_recorder_t rec;
+  mu_recorder_t after_reset;
+
+  // the built-in CRC is the same CRC-32 as mu_crc32_update()
+  memset(region, 0, sizeof(region));
+  mu_sink_t *log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  mu_printf(mu_sink_emitter, log, "crc %d", 32);
+  mu_recorder_attach(&after_reset, region, sizeof(region), mu_crc32_update);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 6);
+  MU_TEST(check_test_emitter("crc 32"));
+
+  // and back
+  log = mu_recorder_attach(&rec, region, sizeof(region), mu_crc32_update);
+  mu_printf(mu_sink_emitter, log, "!");
+  mu_recorder_attach(&after_reset, region, sizeof(region), NULL);
+  MU_TEST(after_reset.recovered);
+  MU_TEST(mu_recorder_dump(&after_reset, test_emitter, NULL) == 7);
+  MU_TEST(check_test_emitter("crc 32!"));
+}
+
+void mu_recorder_file_test() {
+  PRINTF("...mu_recorder_file_test\r\n");
+  static uint32_t region[REGION_SIZE / 4];
+  static uint32_t restored[REGION_SIZE / 4];
+  mu_recorder_t rec;
+  FILE *f = tmpfile();
+
+  // on a host, the region can outlive the process in a file
+  mu_sink_t *log = mu_recorder_attach(&rec, region, sizeof(region), NULL);
+  mu_printf(mu_sink_emitter, log, "%s %d", "before exit", 42);
+  MU_TEST(f != NULL);
+  MU_TEST(fwrite(region, sizeof(region), 1, f) == 1);
+  rewind(f);
+  MU_TEST(fread(restored, sizeof(restored), 1, f) == 1);
+  fclose(f);
+
+  mu_recorder_attach(&rec, restored, sizeof(restored), NULL);
+  MU_TEST(rec.recovered);
+  MU_TEST(mu_recorder_dump(&rec, test_emitter, NULL) == 14);
+  MU_TEST(check_test_emitter("before exit 42"));
+}
+
+void mu_recorder_test() {
+  PRINTF("begin tests...\r\n");
+  mu_recorder_ring_test();
+  mu_recorder_reset_test();
+  mu_recorder_torn_test();
+  mu_recorder_crc_test();
+  mu_recorder_file_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_recorder_test();
+}
+
+#endif
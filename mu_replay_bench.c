@@ -0,0 +1,807 @@
+/*
+ * mu_replay_bench.c - replay a trace of real format strings through mu_printf
+ *
+ * gcc -Wall -O2 -o mu_replay_bench mu_replay_bench.c mu_lzss.c mu_printf.c
+ *
+ * Usage:
+ *   mu_replay_bench [-s sink] [-n passes] [-o out.json] trace_file
+ *       Replay trace_file and report throughput, per-record latency
+ *       percentiles and the cost of each conversion as JSON.
+ *       sink is one of: null, buffer, slow, lzss (default buffer).  lzss
+ *       compresses into the buffer with mu_lzss and also reports the
+ *       compression ratio; compare its throughput with buffer's to see what
+ *       the compression costs.
+ *   mu_replay_bench -g n_records
+ *       Write a synthesized trace of n_records to stdout.
+ *   mu_replay_bench -c base.json new.json [max_regression_percent]
+ *       Compare two results (e.g. from two builds of mu_printf.c).  Exits
+ *       with status 1 if any metric got slower by more than the given percent
+ *       (default 5).
+ *
+ * Trace format: one record per line.  The format string comes first, then
+ * one tab-separated argument per directive.  Backslash escapes (\n \t \r \\)
+ * are honored in both.  The type of each argument is taken from its
+ * directive: %d %i are ints, %b %c %o %p %x are unsigned ints (decimal or
+ * 0x...), %e %f are doubles and %s is a string.  Lines that are empty or
+ * start with '#' are ignored.
+ *
+ * Each record is replayed with a single mu_printf() call, and so through one
+ * mu_vprintf(), with its arguments passed as the types its format expects.
+ * Records may have at most MAX_ARGS arguments.  Results are also reported for
+ * each distinct format, and for each conversion over the records that use it.
+ */
+
+#include "mu_lzss.h"
+#include "mu_printf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_LINE 1024
+#define MAX_ARGS 4
+#define SLOW_SINK_SPIN 20
+#define BUFFER_SINK_SIZE 4096
+#define N_CONVERSIONS 128
+
+typedef enum { ARG_NONE, ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_STRING } arg_type_t;
+
+typedef struct {
+  arg_type_t type;
+  int i;
+  unsigned int u;
+  double d;
+  char *s;
+} arg_t;
+
+typedef struct {
+  char const *fmt;     // owned by the record's format_t
+  int format;          // index of the record's format in the trace
+  arg_t args[MAX_ARGS];
+  int n_args;
+} record_t;
+
+typedef struct {
+  char *fmt;
+  char conversions[MAX_ARGS + 1];  // the format's conversions, in order
+  long count;          // records replayed with this format
+  double seconds;
+  long bytes;
+} format_t;
+
+typedef struct {
+  record_t *records;
+  int n_records;
+  format_t *formats;
+  int n_formats;
+} trace_t;
+
+typedef struct {
+  long directives;     // directives replayed with this conversion
+  long records;        // records replayed that use it
+  double seconds;      // time spent in those records
+} conversion_stats_t;
+
+// =============================================================================
+// sinks
+
+static char s_buffer[BUFFER_SINK_SIZE];
+static int s_buffer_index;
+static volatile int s_slow_register;
+static mu_lzss_t s_lzss;
+static void *s_sink_arg;
+
+int buffer_sink(void *obj, char ch) {
+  s_buffer[s_buffer_index] = ch;
+  s_buffer_index = (s_buffer_index + 1) & (BUFFER_SINK_SIZE - 1);
+  return 1;
+}
+
+/*
+ * Stands in for a device that is slow to accept each char, such as a UART
+ * data register written by polling.
+ */
+int slow_sink(void *obj, char ch) {
+  int i;
+  for (i=0; i<SLOW_SINK_SPIN; i++) {
+    s_slow_register = ch;
+  }
+  return 1;
+}
+
+/*
+ * Return the emitter for the named sink, and set s_sink_arg to its obj.
+ */
+emitter_t sink_named(char const *name) {
+  s_sink_arg = NULL;
+  if (strcmp(name, "null") == 0) {
+    return mu_null_emitter;
+  } else if (strcmp(name, "buffer") == 0) {
+    return buffer_sink;
+  } else if (strcmp(name, "slow") == 0) {
+    return slow_sink;
+  } else if (strcmp(name, "lzss") == 0) {
+    s_sink_arg = mu_lzss_init(&s_lzss, buffer_sink, NULL);
+    return mu_sink_emitter;
+  }
+  return NULL;
+}
+
+// =============================================================================
+// trace loading
+
+double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Copy n chars of src, expanding backslash escapes.  Returns a new string.
+ */
+char *unescape(char const *src, int n) {
+  char *dst = malloc(n + 1);
+  int i = 0;
+  int j = 0;
+
+  while (i < n) {
+    char ch = src[i++];
+    if (ch == '\\' && i < n) {
+      ch = src[i++];
+      switch(ch) {
+      case 'n': ch = '\n'; break;
+      case 't': ch = '\t'; break;
+      case 'r': ch = '\r'; break;
+      default: break;  // '\\' and anything else stand for themselves
+      }
+    }
+    dst[j++] = ch;
+  }
+  dst[j] = '\0';
+  return dst;
+}
+
+arg_type_t type_of(char conversion) {
+  switch(conversion) {
+  case 'd':
+  case 'i':
+    return ARG_INT;
+  case 'b':
+  case 'c':
+  case 'o':
+  case 'p':
+  case 'x':
+    return ARG_UINT;
+  case 'e':
+  case 'f':
+    return ARG_DOUBLE;
+  case 's':
+    return ARG_STRING;
+  default:
+    return ARG_NONE;
+  }
+}
+
+void free_args(record_t *record) {
+  int i;
+  for (i=0; i<record->n_args; i++) {
+    free(record->args[i].s);
+  }
+}
+
+/*
+ * Parse one trace line into record, returning its format string (which the
+ * caller owns) in *fmt and its conversions in conversions.  Returns false on
+ * a malformed line, in which case nothing needs freeing.
+ */
+bool parse_record(record_t *record, char **fmt, char *conversions,
+                  char *line) {
+  char *args[MAX_ARGS + 1];
+  int n_args = 0;
+  char *tab;
+
+  // split off the tab separated arguments (one too many is an error)
+  for (tab = strchr(line, '\t'); tab && n_args <= MAX_ARGS;
+       tab = strchr(tab, '\t')) {
+    *tab++ = '\0';
+    args[n_args++] = tab;
+  }
+
+  char *unescaped = unescape(line, strlen(line));
+  char const *p = unescaped;
+
+  record->n_args = 0;
+  while (*p) {
+    if (*p++ != '%') {
+      continue;
+    }
+    mu_directive_t directive;
+    p = mu_parse_directive(&directive, p);
+    arg_type_t type = type_of(directive.conversion);
+    if (type == ARG_NONE) {
+      continue;  // %% and friends take no argument
+    }
+    if (record->n_args == MAX_ARGS || record->n_args == n_args) {
+      free_args(record);
+      free(unescaped);
+      return false;
+    }
+    arg_t *arg = &record->args[record->n_args];
+    char const *text = args[record->n_args];
+    conversions[record->n_args++] = directive.conversion;
+    arg->type = type;
+    arg->s = NULL;
+    switch(type) {
+    case ARG_INT:
+      arg->i = strtol(text, NULL, 0);
+      break;
+    case ARG_UINT:
+      arg->u = strtoul(text, NULL, 0);
+      break;
+    case ARG_DOUBLE:
+      arg->d = strtod(text, NULL);
+      break;
+    default:
+      arg->s = unescape(text, strlen(text));
+      break;
+    }
+  }
+  if (record->n_args != n_args) {
+    free_args(record);
+    free(unescaped);
+    return false;
+  }
+  conversions[record->n_args] = '\0';
+  *fmt = unescaped;
+  return true;
+}
+
+/*
+ * Return the index of fmt among the trace's formats, adding it (and taking
+ * ownership of fmt) if it is new, or -1 if out of memory.
+ */
+int intern_format(trace_t *trace, char *fmt, char const *conversions,
+                  int *capacity) {
+  int i;
+
+  for (i=0; i<trace->n_formats; i++) {
+    if (strcmp(trace->formats[i].fmt, fmt) == 0) {
+      free(fmt);
+      return i;
+    }
+  }
+  if (trace->n_formats == *capacity) {
+    int n = *capacity ? *capacity * 2 : 16;
+    format_t *formats = realloc(trace->formats, n * sizeof(format_t));
+    if (formats == NULL) {
+      return -1;
+    }
+    trace->formats = formats;
+    *capacity = n;
+  }
+  format_t *format = &trace->formats[trace->n_formats];
+  memset(format, 0, sizeof(format_t));
+  format->fmt = fmt;
+  strcpy(format->conversions, conversions);
+  return trace->n_formats++;
+}
+
+void free_trace(trace_t *trace) {
+  int i;
+
+  for (i=0; i<trace->n_records; i++) {
+    free_args(&trace->records[i]);
+  }
+  for (i=0; i<trace->n_formats; i++) {
+    free(trace->formats[i].fmt);
+  }
+  free(trace->records);
+  free(trace->formats);
+}
+
+/*
+ * Load the trace at path.  Returns false if it cannot be read.
+ */
+bool load_trace(trace_t *trace, char const *path) {
+  FILE *f = fopen(path, "r");
+  char line[MAX_LINE];
+  int record_capacity = 0;
+  int format_capacity = 0;
+  int line_number = 0;
+
+  memset(trace, 0, sizeof(trace_t));
+  if (f == NULL) {
+    perror(path);
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    record_t *record;
+    char conversions[MAX_ARGS + 1];
+    char *fmt;
+
+    line_number += 1;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    if (trace->n_records == record_capacity) {
+      int n = record_capacity ? record_capacity * 2 : 256;
+      record_t *records = realloc(trace->records, n * sizeof(record_t));
+      if (records == NULL) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        break;
+      }
+      trace->records = records;
+      record_capacity = n;
+    }
+    record = &trace->records[trace->n_records];
+    if (!parse_record(record, &fmt, conversions, line)) {
+      fprintf(stderr, "%s:%d: bad record\n", path, line_number);
+      continue;
+    }
+    record->format = intern_format(trace, fmt, conversions, &format_capacity);
+    if (record->format < 0) {
+      fprintf(stderr, "%s: out of memory\n", path);
+      free_args(record);
+      free(fmt);
+      break;
+    }
+    record->fmt = trace->formats[record->format].fmt;
+    trace->n_records += 1;
+  }
+  fclose(f);
+  return true;
+}
+
+// =============================================================================
+// replay
+
+/*
+ * A record is replayed with one mu_printf() call whose arguments have the
+ * types the format expects.  C cannot build a va_list at run time, so each
+ * REPLAY_ARGn() switches on the type of argument n and appends it to the
+ * argument list, giving one call site per sequence of argument types.
+ */
+#define REPLAY_CALL(...) \
+  return mu_printf(sink, s_sink_arg, record->fmt __VA_ARGS__)
+
+// a macro cannot expand inside its own expansion, so each level is spelled out
+#define REPLAY_ARG3(...) \
+  if (record->n_args == 3) { REPLAY_CALL(__VA_ARGS__); } \
+  switch(record->args[3].type) { \
+  case ARG_INT: REPLAY_CALL(__VA_ARGS__, record->args[3].i); \
+  case ARG_UINT: REPLAY_CALL(__VA_ARGS__, record->args[3].u); \
+  case ARG_DOUBLE: REPLAY_CALL(__VA_ARGS__, record->args[3].d); \
+  default: REPLAY_CALL(__VA_ARGS__, record->args[3].s); \
+  }
+#define REPLAY_ARG2(...) \
+  if (record->n_args == 2) { REPLAY_CALL(__VA_ARGS__); } \
+  switch(record->args[2].type) { \
+  case ARG_INT: REPLAY_ARG3(__VA_ARGS__, record->args[2].i); \
+  case ARG_UINT: REPLAY_ARG3(__VA_ARGS__, record->args[2].u); \
+  case ARG_DOUBLE: REPLAY_ARG3(__VA_ARGS__, record->args[2].d); \
+  default: REPLAY_ARG3(__VA_ARGS__, record->args[2].s); \
+  }
+#define REPLAY_ARG1(...) \
+  if (record->n_args == 1) { REPLAY_CALL(__VA_ARGS__); } \
+  switch(record->args[1].type) { \
+  case ARG_INT: REPLAY_ARG2(__VA_ARGS__, record->args[1].i); \
+  case ARG_UINT: REPLAY_ARG2(__VA_ARGS__, record->args[1].u); \
+  case ARG_DOUBLE: REPLAY_ARG2(__VA_ARGS__, record->args[1].d); \
+  default: REPLAY_ARG2(__VA_ARGS__, record->args[1].s); \
+  }
+#define REPLAY_ARG0(...) \
+  if (record->n_args == 0) { REPLAY_CALL(__VA_ARGS__); } \
+  switch(record->args[0].type) { \
+  case ARG_INT: REPLAY_ARG1(__VA_ARGS__, record->args[0].i); \
+  case ARG_UINT: REPLAY_ARG1(__VA_ARGS__, record->args[0].u); \
+  case ARG_DOUBLE: REPLAY_ARG1(__VA_ARGS__, record->args[0].d); \
+  default: REPLAY_ARG1(__VA_ARGS__, record->args[0].s); \
+  }
+
+#if MAX_ARGS != 4
+#error "REPLAY_ARG0..3 handle exactly MAX_ARGS arguments"
+#endif
+
+int replay_record(emitter_t sink, record_t const *record) {
+  REPLAY_ARG0()
+}
+
+int compare_doubles(void const *a, void const *b) {
+  double da = *(double const *)a;
+  double db = *(double const *)b;
+  return (da > db) - (da < db);
+}
+
+double percentile(double const *sorted, long n, double p) {
+  long i = (long)(p * (n - 1) + 0.5);
+  return sorted[i];
+}
+
+/*
+ * Write str to out as a quoted JSON string.
+ */
+void write_json_string(FILE *out, char const *str) {
+  char ch;
+
+  fputc('"', out);
+  while ((ch = *str++)) {
+    switch(ch) {
+    case '"': fputs("\\\"", out); break;
+    case '\\': fputs("\\\\", out); break;
+    case '\n': fputs("\\n", out); break;
+    case '\r': fputs("\\r", out); break;
+    case '\t': fputs("\\t", out); break;
+    default:
+      if ((unsigned char)ch < ' ') {
+        fprintf(out, "\\u%04x", ch);
+      } else {
+        fputc(ch, out);
+      }
+    }
+  }
+  fputc('"', out);
+}
+
+int replay(char const *path, char const *sink_name, int passes, FILE *out) {
+  emitter_t sink = sink_named(sink_name);
+  conversion_stats_t conversions[N_CONVERSIONS];
+  trace_t trace;
+  int pass;
+  int r;
+  int f;
+  int c;
+
+  if (sink == NULL) {
+    fprintf(stderr, "unknown sink '%s'\n", sink_name);
+    return 1;
+  }
+  if (!load_trace(&trace, path)) {
+    return 1;
+  }
+  if (trace.n_records == 0) {
+    fprintf(stderr, "%s: no records\n", path);
+    free_trace(&trace);
+    return 1;
+  }
+  record_t const *records = trace.records;
+  int n_records = trace.n_records;
+
+  // whole records: throughput and latency percentiles
+  long n_samples = (long)n_records * passes;
+  double *latency = malloc(n_samples * sizeof(double));
+  if (latency == NULL) {
+    fprintf(stderr, "out of memory\n");
+    free_trace(&trace);
+    return 1;
+  }
+  long bytes = 0;
+  double t_start = now_seconds();
+  for (pass=0; pass<passes; pass++) {
+    for (r=0; r<n_records; r++) {
+      double t0 = now_seconds();
+      bytes += replay_record(sink, &records[r]);
+      latency[(long)pass * n_records + r] = (now_seconds() - t0) * 1e9;
+    }
+  }
+  double seconds = now_seconds() - t_start;
+  qsort(latency, n_samples, sizeof(double), compare_doubles);
+  if (s_sink_arg == &s_lzss.sink) {
+    mu_lzss_flush(&s_lzss);
+  }
+  uint32_t compressed_bytes = s_lzss.bytes_out;
+
+  // one format at a time: replay just the records that use it
+  for (f=0; f<trace.n_formats; f++) {
+    format_t *format = &trace.formats[f];
+    double t0 = now_seconds();
+    for (pass=0; pass<passes; pass++) {
+      for (r=0; r<n_records; r++) {
+        if (records[r].format == f) {
+          format->bytes += replay_record(sink, &records[r]);
+          format->count += 1;
+        }
+      }
+    }
+    format->seconds = now_seconds() - t0;
+  }
+
+  // each conversion is charged the time of the formats that use it
+  memset(conversions, 0, sizeof(conversions));
+  for (f=0; f<trace.n_formats; f++) {
+    format_t const *format = &trace.formats[f];
+    bool counted[N_CONVERSIONS] = {false};
+    char const *p;
+    for (p=format->conversions; *p; p++) {
+      conversion_stats_t *cs = &conversions[*p & (N_CONVERSIONS - 1)];
+      cs->directives += format->count;
+      if (!counted[*p & (N_CONVERSIONS - 1)]) {
+        counted[*p & (N_CONVERSIONS - 1)] = true;
+        cs->records += format->count;
+        cs->seconds += format->seconds;
+      }
+    }
+  }
+
+  fprintf(out, "{\n  \"trace\": ");
+  write_json_string(out, path);
+  fprintf(out, ",\n  \"sink\": ");
+  write_json_string(out, sink_name);
+  fprintf(out, ",\n  \"records\": %ld,\n  \"bytes\": %ld,\n", n_samples, bytes);
+  fprintf(out, "  \"seconds\": %.6f,\n", seconds);
+  fprintf(out, "  \"records_per_sec\": %.0f,\n", n_samples / seconds);
+  fprintf(out, "  \"bytes_per_sec\": %.0f,\n", bytes / seconds);
+  if (s_sink_arg == &s_lzss.sink) {
+    fprintf(out, "  \"compressed_bytes\": %u,\n", compressed_bytes);
+    fprintf(out, "  \"compression_ratio\": %.3f,\n",
+            (double)compressed_bytes / bytes);
+  }
+  fprintf(out,
+          "  \"latency_ns\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+          "\"p999\": %.1f, \"max\": %.1f},\n",
+          percentile(latency, n_samples, 0.50),
+          percentile(latency, n_samples, 0.90),
+          percentile(latency, n_samples, 0.99),
+          percentile(latency, n_samples, 0.999),
+          latency[n_samples - 1]);
+  fprintf(out, "  \"conversions\": {");
+  bool first = true;
+  for (c=0; c<N_CONVERSIONS; c++) {
+    conversion_stats_t const *cs = &conversions[c];
+    if (cs->records == 0) {
+      continue;
+    }
+    fprintf(out,
+            "%s\n    \"%c\": {\"directives\": %ld, \"records\": %ld, "
+            "\"ns_per_record\": %.2f}",
+            first ? "" : ",",
+            c,
+            cs->directives,
+            cs->records,
+            cs->seconds * 1e9 / cs->records);
+    first = false;
+  }
+  fprintf(out, "\n  },\n  \"formats\": {");
+  for (f=0; f<trace.n_formats; f++) {
+    format_t const *format = &trace.formats[f];
+    fprintf(out, "%s\n    ", f ? "," : "");
+    write_json_string(out, format->fmt);
+    fprintf(out, ": {\"count\": %ld, \"ns_per_call\": %.2f, \"bytes\": %ld}",
+            format->count,
+            format->seconds * 1e9 / format->count,
+            format->bytes);
+  }
+  fprintf(out, "\n  }\n}\n");
+
+  free(latency);
+  free_trace(&trace);
+  return 0;
+}
+
+// =============================================================================
+// trace synthesis
+
+static unsigned int s_seed = 1;
+
+unsigned int next_random() {
+  s_seed = s_seed * 1103515245 + 12345;
+  return s_seed >> 8;
+}
+
+int synthesize(long n_records) {
+  static char const *modules[] = {"adc", "radio", "power", "fs", "sched"};
+  static char const *states[] = {"IDLE", "RX", "TX", "SLEEP", "ERROR"};
+  unsigned int t = 1000;
+  long i;
+
+  printf("# synthesized by mu_replay_bench -g %ld\n", n_records);
+  for (i=0; i<n_records; i++) {
+    unsigned int r = next_random();
+    t += r % 50;
+    switch(r % 8) {
+    case 0:
+      printf("[%%d] %%s: temp=%%.2f C\\n\t%u\t%s\t%.4f\n",
+             t, modules[r % 5], (int)(r % 6000) / 100.0 - 20.0);
+      break;
+    case 1:
+      printf("reg %%08x = %%08x\\n\t0x%x\t0x%x\n",
+             0x40000000 + (r % 256) * 4, next_random());
+      break;
+    case 2:
+      printf("ADC ch%%d raw=%%d v=%%.3f\\n\t%u\t%u\t%.5f\n",
+             r % 8, r % 4096, (r % 4096) * 3.3 / 4096);
+      break;
+    case 3:
+      printf("[%%d] state %%s -> %%s\\n\t%u\t%s\t%s\n",
+             t, states[r % 5], states[(r / 5) % 5]);
+      break;
+    case 4:
+      printf("err %%d at 0x%%x\\n\t%d\t0x%x\n",
+             -(int)(r % 40), 0x08000000 + (r % 65536) * 2);
+      break;
+    case 5:
+      printf("heap free=%%d min=%%d\\n\t%u\t%u\n", r % 65536, r % 16384);
+      break;
+    case 6:
+      printf("rssi=%%d snr=%%.1f dB f=%%e Hz\\n\t%d\t%.2f\t%.1f\n",
+             -(int)(r % 100) - 30, (r % 200) / 10.0 - 5.0, 868.1e6 + r % 1000);
+      break;
+    default:
+      printf("watchdog kicked\\n\n");
+      break;
+    }
+  }
+  return 0;
+}
+
+// =============================================================================
+// comparison
+
+/*
+ * Find the number following "key": after position from in a result file.
+ * Returns true if found.
+ */
+bool json_number(char const *text, char const *from, char const *key, double *v) {
+  char pattern[64];
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  char const *p = strstr(from ? from : text, pattern);
+  if (p == NULL) {
+    return false;
+  }
+  *v = strtod(p + strlen(pattern), NULL);
+  return true;
+}
+
+/*
+ * Find key within the named section of a result file, or return NULL.
+ */
+char const *section_entry(char const *text, char const *section,
+                          char const *key) {
+  char pattern[64];
+  snprintf(pattern, sizeof(pattern), "\"%s\": {", section);
+  char const *p = strstr(text, pattern);
+  return p ? strstr(p, key) : NULL;
+}
+
+char *read_file(char const *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    perror(path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *text = malloc(n + 1);
+  n = fread(text, 1, n, f);
+  text[n] = '\0';
+  fclose(f);
+  return text;
+}
+
+/*
+ * Report one metric.  Returns true if it regressed by more than max_percent.
+ * Higher is better for throughput; lower is better for times.
+ */
+bool compare_metric(char const *name, double base, double now,
+                    bool higher_is_better, double max_percent) {
+  double change = base ? (now - base) * 100.0 / base : 0.0;
+  double worse = higher_is_better ? -change : change;
+  bool regressed = worse > max_percent;
+  printf("%-28s %14.2f %14.2f %+8.1f%%%s\n",
+         name, base, now, change, regressed ? "  REGRESSION" : "");
+  return regressed;
+}
+
+int compare(char const *base_path, char const *new_path, double max_percent) {
+  static char const *latencies[] = {"p50", "p90", "p99", "p999"};
+  char *base = read_file(base_path);
+  char *now = read_file(new_path);
+  bool regressed = false;
+  double b, n;
+  int c;
+  int i;
+
+  if (base == NULL || now == NULL) {
+    return 2;
+  }
+  printf("%-28s %14s %14s %9s\n", "metric", "base", "new", "change");
+  if (json_number(base, NULL, "records_per_sec", &b) &&
+      json_number(now, NULL, "records_per_sec", &n)) {
+    regressed |= compare_metric("records_per_sec", b, n, true, max_percent);
+  }
+  for (i=0; i<4; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "latency_ns.%s", latencies[i]);
+    if (json_number(base, NULL, latencies[i], &b) &&
+        json_number(now, NULL, latencies[i], &n)) {
+      regressed |= compare_metric(name, b, n, false, max_percent);
+    }
+  }
+  for (c=1; c<N_CONVERSIONS; c++) {
+    char key[16];
+    char name[48];
+    snprintf(key, sizeof(key), "\n    \"%c\":", c);
+    snprintf(name, sizeof(name), "%%%c ns_per_record", c);
+    char const *base_from = section_entry(base, "conversions", key);
+    char const *now_from = section_entry(now, "conversions", key);
+    if (base_from && now_from &&
+        json_number(base, base_from, "ns_per_record", &b) &&
+        json_number(now, now_from, "ns_per_record", &n)) {
+      regressed |= compare_metric(name, b, n, false, max_percent);
+    }
+  }
+  // formats are matched by their (escaped) format string, one per line
+  char const *line = strstr(base, "\"formats\"");
+  while (line && (line = strstr(line, "\n    \"")) != NULL) {
+    char const *end = strstr(line, ": {\"count\"");
+    char key[MAX_LINE];
+    char name[48];
+    if (end == NULL || end - line >= (long)sizeof(key)) {
+      break;
+    }
+    snprintf(key, sizeof(key), "%.*s", (int)(end - line), line);
+    int n_name = (int)(end - line) - 7;  // less the newline, indent, quotes
+    snprintf(name, sizeof(name), "%.*s", n_name < 28 ? n_name : 28, line + 6);
+    char const *now_from = section_entry(now, "formats", key);
+    if (now_from &&
+        json_number(base, line, "ns_per_call", &b) &&
+        json_number(now, now_from, "ns_per_call", &n)) {
+      regressed |= compare_metric(name, b, n, false, max_percent);
+    }
+    line = end;
+  }
+  free(base);
+  free(now);
+  return regressed ? 1 : 0;
+}
+
+// =============================================================================
+
+int usage(char const *name) {
+  fprintf(stderr,
+          "usage: %s [-s null|buffer|slow] [-n passes] [-o out.json] trace\n"
+          "       %s -g n_records\n"
+          "       %s -c base.json new.json [max_regression_percent]\n",
+          name, name, name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  char const *sink_name = "buffer";
+  char const *trace = NULL;
+  FILE *out = stdout;
+  int passes = 10;
+  int a;
+
+  for (a=1; a<argc; a++) {
+    if (strcmp(argv[a], "-g") == 0 && a + 1 < argc) {
+      return synthesize(strtol(argv[a + 1], NULL, 10));
+    } else if (strcmp(argv[a], "-c") == 0 && a + 2 < argc) {
+      double max_percent = a + 3 < argc ? strtod(argv[a + 3], NULL) : 5.0;
+      return compare(argv[a + 1], argv[a + 2], max_percent);
+    } else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+      sink_name = argv[++a];
+    } else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+      passes = strtol(argv[++a], NULL, 10);
+    } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+      out = fopen(argv[++a], "w");
+      if (out == NULL) {
+        perror(argv[a]);
+        return 2;
+      }
+    } else if (argv[a][0] != '-' && trace == NULL) {
+      trace = argv[a];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (trace == NULL || passes < 1) {
+    return usage(argv[0]);
+  }
+  int status = replay(trace, sink_name, passes, out);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return status;
+}
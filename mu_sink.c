@@ -0,0 +1,54 @@
+/*
+ * mu_sink.c
+ *
+ * gcc -Wall -O2 -c mu_sink.c mu_printf.c
+ */
+
+#include "mu_sink.h"
+
+// =============================================================================
+// forward declarations
+
+char *buffer_sink_reserve(mu_sink_t *sink, int *n);
+void buffer_sink_commit(mu_sink_t *sink, int n);
+
+static const mu_sink_vtable_t s_buffer_sink_vtable = {
+  buffer_sink_reserve,
+  buffer_sink_commit,
+  (void *)0  // nothing to do at the end of a call
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_buffer_sink_init(mu_buffer_sink_t *buffer_sink,
+                               char *buf,
+                               int size) {
+  buffer_sink->sink.vtable = &s_buffer_sink_vtable;
+  buffer_sink->buf = buf;
+  buffer_sink->size = size;
+  buffer_sink->length = 0;
+  return &buffer_sink->sink;
+}
+
+void mu_buffer_sink_reset(mu_buffer_sink_t *buffer_sink) {
+  buffer_sink->length = 0;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *buffer_sink_reserve(mu_sink_t *sink, int *n) {
+  mu_buffer_sink_t *buffer_sink = (mu_buffer_sink_t *)sink;
+  int room = buffer_sink->size - buffer_sink->length;
+
+  if (*n > room) {
+    *n = room;
+  }
+  return &buffer_sink->buf[buffer_sink->length];
+}
+
+void buffer_sink_commit(mu_sink_t *sink, int n) {
+  mu_buffer_sink_t *buffer_sink = (mu_buffer_sink_t *)sink;
+  buffer_sink->length += n;
+}
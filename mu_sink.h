@@ -0,0 +1,46 @@
+/*
+ * mu_sink - zero-copy sinks for mu_printf
+ *
+ * A sink hands out its own memory with reserve() and takes it back with
+ * commit() (see mu_sink_t in mu_printf.h), so the formatter converts digits
+ * and copies text straight into it.  To print into a sink, pass
+ * mu_sink_emitter as the emitter and the sink as obj:
+ *
+ *   char buf[64];
+ *   mu_buffer_sink_t out;
+ *   mu_printf(mu_sink_emitter, mu_buffer_sink_init(&out, buf, sizeof(buf)),
+ *             "t=%d", 42);
+ *
+ * This file provides the buffer sink, which fills a caller-provided block of
+ * memory, such as a packet or a DMA buffer, from the start.
+ */
+
+#ifndef SOURCE_MU_SINK_H_
+#define SOURCE_MU_SINK_H_
+
+#include "mu_printf.h"
+
+typedef struct {
+  mu_sink_t sink;  // must come first
+  char *buf;       // the memory being filled
+  int size;        // chars in buf
+  int length;      // chars committed so far
+} mu_buffer_sink_t;
+
+/*!
+ * @brief Make buffer_sink an empty sink writing into buf.
+ *
+ * Output beyond size chars is dropped.  No null is appended.
+ *
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_buffer_sink_init(mu_buffer_sink_t *buffer_sink,
+                               char *buf,
+                               int size);
+
+/*!
+ * @brief Empty the sink, so that it fills buf from the start again.
+ */
+void mu_buffer_sink_reset(mu_buffer_sink_t *buffer_sink);
+
+#endif /* SOURCE_MU_SINK_H_ */
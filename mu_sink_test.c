@@ -0,0 +1,169 @@
+/*
+ * mu_sink_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_sink_test mu_sink_test.c mu_sink.c mu_printf.c && ./mu_sink_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_sink.h"
+#include "mu_printf.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf) - 1) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+char sink_buf[256];
+mu_buffer_sink_t buffer_sink;
+
+// A sink that grants at most 3 chars per reservation, so that the formatter
+// has to fall back to its own buffers and split its copies.
+typedef struct {
+  mu_sink_t sink;
+  mu_buffer_sink_t *inner;
+  int n_reserves;
+} chunky_sink_t;
+
+char *chunky_reserve(mu_sink_t *sink, int *n) {
+  chunky_sink_t *chunky = (chunky_sink_t *)sink;
+  chunky->n_reserves += 1;
+  if (*n > 3) {
+    *n = 3;
+  }
+  return chunky->inner->sink.vtable->reserve(&chunky->inner->sink, n);
+}
+
+void chunky_commit(mu_sink_t *sink, int n) {
+  chunky_sink_t *chunky = (chunky_sink_t *)sink;
+  chunky->inner->sink.vtable->commit(&chunky->inner->sink, n);
+}
+
+static const mu_sink_vtable_t s_chunky_vtable = {
+  chunky_reserve,
+  chunky_commit,
+  NULL
+};
+
+// Format with both the sink and test_emitter, and compare.
+#define CHECK_SINK(sink, ...) \
+  check_sink(mu_printf(mu_sink_emitter, (sink), __VA_ARGS__), \
+             mu_printf(test_emitter, NULL, __VA_ARGS__))
+
+bool check_sink(int n_sink, int n_emitter) {
+  bool match = n_sink == n_emitter &&
+      buffer_sink.length == test_index &&
+      memcmp(sink_buf, test_buf, test_index) == 0;
+  if (!match) {
+    test_buf[test_index] = '\0';
+    PRINTF("expected '%s', got '%.*s'\r\n",
+           test_buf, buffer_sink.length, sink_buf);
+  }
+  mu_buffer_sink_reset(&buffer_sink);
+  test_index = 0;
+  return match;
+}
+
+// ======================================================================
+// tests
+
+void check_formats(mu_sink_t *sink) {
+  MU_TEST(CHECK_SINK(sink, ""));
+  MU_TEST(CHECK_SINK(sink, "plain text, no directives"));
+  MU_TEST(CHECK_SINK(sink, "%d %d %d", 0, -1234567, 2147483647));
+  MU_TEST(CHECK_SINK(sink, "[%8d|%-8d|%08d]", 42, -42, 42));
+  MU_TEST(CHECK_SINK(sink, "%x %#X %o %p", 0xdeadbeef, 0xbeef, 0777, 0x1234));
+#if MU_PRINTF_ENABLE_BINARY
+  MU_TEST(CHECK_SINK(sink, "%b %#b", 0xa5, 5));
+#endif
+  MU_TEST(CHECK_SINK(sink, "%s|%10s|%-10s|%.3s", "abc", "right", "left", "trunc"));
+  MU_TEST(CHECK_SINK(sink, "%c%c%%", 'o', 'k'));
+#if MU_PRINTF_ENABLE_FLOAT
+  MU_TEST(CHECK_SINK(sink, "%f %.2f %10.3f", 3.14159, -273.15, 9.9996));
+  MU_TEST(CHECK_SINK(sink, "%.0f %.9f", 0.5, 123456.789));
+#endif
+#if MU_PRINTF_ENABLE_E
+  MU_TEST(CHECK_SINK(sink, "%e %.2E", 123456.0, -0.000123));
+#endif
+#if MU_PRINTF_ENABLE_ESCAPE
+  MU_TEST(CHECK_SINK(sink, "{\"msg\":\"%j\"}", "a \"quoted\"\tvalue"));
+#endif
+}
+
+void mu_buffer_sink_test() {
+  PRINTF("...mu_buffer_sink_test\r\n");
+  mu_sink_t *sink = mu_buffer_sink_init(&buffer_sink, sink_buf, sizeof(sink_buf));
+  check_formats(sink);
+
+  // a single char through the emitter itself
+  MU_TEST(mu_emit_char(mu_sink_emitter, sink, 'z') == 1);
+  MU_TEST(buffer_sink.length == 1 && sink_buf[0] == 'z');
+  mu_buffer_sink_reset(&buffer_sink);
+}
+
+void mu_chunky_sink_test() {
+  PRINTF("...mu_chunky_sink_test\r\n");
+  chunky_sink_t chunky = {{&s_chunky_vtable}, &buffer_sink, 0};
+
+  mu_buffer_sink_init(&buffer_sink, sink_buf, sizeof(sink_buf));
+  check_formats(&chunky.sink);
+  MU_TEST(chunky.n_reserves > 0);
+}
+
+void mu_sink_full_test() {
+  PRINTF("...mu_sink_full_test\r\n");
+  char small[8];
+  mu_buffer_sink_t out;
+  mu_sink_t *sink = mu_buffer_sink_init(&out, small, sizeof(small));
+
+  // what doesn't fit is dropped, but counted
+  MU_TEST(mu_printf(mu_sink_emitter, sink, "n=%d %s", 123456, "overflow") == 17);
+  MU_TEST(out.length == 8);
+  MU_TEST(memcmp(small, "n=123456", 8) == 0);
+  MU_TEST(mu_printf(mu_sink_emitter, sink, "%-5d|", 1) == 6);
+  MU_TEST(out.length == 8);
+
+  // a number without room to be converted in place is formatted aside, and
+  // written as far as it fits
+  mu_buffer_sink_reset(&out);
+  MU_TEST(mu_printf(mu_sink_emitter, sink, "abcde%d", 1234) == 9);
+  MU_TEST(out.length == 8);
+  MU_TEST(memcmp(small, "abcde123", 8) == 0);
+}
+
+void mu_sink_test() {
+  PRINTF("begin tests...\r\n");
+  mu_buffer_sink_test();
+  mu_chunky_sink_test();
+  mu_sink_full_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_sink_test();
+}
+
+#endif
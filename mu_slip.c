@@ -0,0 +1,80 @@
+/*
+ * mu_slip.c
+ *
+ * gcc -Wall -O2 -c mu_slip.c mu_printf.c
+ */
+
+#include "mu_slip.h"
+
+// =============================================================================
+// forward declarations
+
+char *slip_reserve(mu_sink_t *sink, int *n);
+void slip_commit(mu_sink_t *sink, int n);
+void slip_end(mu_sink_t *sink);
+
+static const mu_sink_vtable_t s_slip_vtable = {
+  slip_reserve,
+  slip_commit,
+  slip_end
+};
+
+// =============================================================================
+// Code
+
+mu_sink_t *mu_slip_init(mu_slip_t *slip, emitter_t emitter_fn, void *obj) {
+  slip->sink.vtable = &s_slip_vtable;
+  slip->emitter_fn = emitter_fn;
+  slip->emitter_arg = obj;
+  slip->in_packet = false;
+  return &slip->sink;
+}
+
+// =============================================================================
+// =============================================================================
+
+char *slip_reserve(mu_sink_t *sink, int *n) {
+  mu_slip_t *slip = (mu_slip_t *)sink;
+
+  if (*n > MU_SLIP_CHUNK_SIZE) {
+    *n = MU_SLIP_CHUNK_SIZE;
+  }
+  return slip->chunk;
+}
+
+void slip_commit(mu_sink_t *sink, int n) {
+  mu_slip_t *slip = (mu_slip_t *)sink;
+  char const *run = slip->chunk;
+  char const *end = run + n;
+  char const *p;
+
+  slip->in_packet = true;
+  for (p=run; p<end; p++) {
+    char escape[2] = {MU_SLIP_ESC, MU_SLIP_ESC_END};
+    if (*p == MU_SLIP_ESC) {
+      escape[1] = MU_SLIP_ESC_ESC;
+    } else if (*p != MU_SLIP_END) {
+      continue;
+    }
+    mu_emit_block(slip->emitter_fn, slip->emitter_arg, run, p - run);
+    mu_emit_block(slip->emitter_fn, slip->emitter_arg, escape, 2);
+    run = p + 1;
+  }
+  mu_emit_block(slip->emitter_fn, slip->emitter_arg, run, end - run);
+}
+
+void slip_end(mu_sink_t *sink) {
+  mu_slip_t *slip = (mu_slip_t *)sink;
+
+  if (!slip->in_packet) {
+    return;  // the call printed nothing
+  }
+  mu_emit_char(slip->emitter_fn, slip->emitter_arg, MU_SLIP_END);
+  slip->in_packet = false;
+  if (slip->emitter_fn == mu_sink_emitter) {
+    mu_sink_t *downstream = slip->emitter_arg;
+    if (downstream->vtable->end) {
+      downstream->vtable->end(downstream);
+    }
+  }
+}
@@ -0,0 +1,49 @@
+/*
+ * mu_slip - SLIP-encode output on the fly
+ *
+ * SLIP (RFC 1055) ends each message with an END byte (0xc0), and escapes
+ * END and ESC (0xdb) bytes in the message as ESC 0xdc and ESC 0xdd.  A
+ * mu_slip_t is a sink (see mu_sink_t in mu_printf.h) that encodes the output
+ * of each mu_printf() call as it is written and passes it on to another
+ * emitter, ending with END.  A call that prints nothing sends nothing.
+ *
+ * SLIP needs no lookahead.  The formatter writes into a small chunk, and
+ * runs without END or ESC go downstream with one mu_emit_block() each.
+ *
+ *   mu_slip_t slip;
+ *   mu_sink_t *out = mu_slip_init(&slip, uart_emitter, NULL);
+ *   mu_printf(mu_sink_emitter, out, "t=%d", t);  // one END-terminated packet
+ */
+
+#ifndef SOURCE_MU_SLIP_H_
+#define SOURCE_MU_SLIP_H_
+
+#include "mu_printf.h"
+
+#define MU_SLIP_END ((char)0xc0)
+#define MU_SLIP_ESC ((char)0xdb)
+#define MU_SLIP_ESC_END ((char)0xdc)
+#define MU_SLIP_ESC_ESC ((char)0xdd)
+
+// chars the formatter may write at a time
+#ifndef MU_SLIP_CHUNK_SIZE
+#define MU_SLIP_CHUNK_SIZE 32
+#endif
+
+typedef struct {
+  mu_sink_t sink;         // must come first
+  emitter_t emitter_fn;   // where encoded packets go
+  void *emitter_arg;      // user-supplied argument to emitter_fn
+  bool in_packet;         // this call has written something
+  char chunk[MU_SLIP_CHUNK_SIZE];
+} mu_slip_t;
+
+/*!
+ * @brief Set up slip to encode each call's output as a packet for
+ * emitter_fn.
+ *
+ * @return The sink, to be passed as obj with mu_sink_emitter.
+ */
+mu_sink_t *mu_slip_init(mu_slip_t *slip, emitter_t emitter_fn, void *obj);
+
+#endif /* SOURCE_MU_SLIP_H_ */
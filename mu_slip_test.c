@@ -0,0 +1,99 @@
+/*
+ * mu_slip_test.c
+ *
+ * To compile standalone:
+ * gcc -DSTANDALONE -Wall -o mu_slip_test mu_slip_test.c mu_slip.c mu_sink.c mu_printf.c && ./mu_slip_test
+ */
+
+#include <stdio.h>
+#define PRINTF printf
+
+#include "mu_slip.h"
+#include "mu_printf.h"
+#include "mu_sink.h"
+#include <stddef.h>
+#include <string.h>
+
+// ======================================================================
+// test support
+
+#define MU_TEST(expr) mu_test((expr), __FILE__, __LINE__, #expr)
+
+void mu_test(bool pass, const char *file, int line, const char *expr) {
+  if (!pass) {
+    PRINTF("%s:%d: ", file, line);
+    PRINTF("...fail %s\r\n", expr);
+  }
+}
+
+char test_buf[256];
+int test_index;
+
+int test_emitter(void *obj, char ch) {
+  if (test_index < (int)sizeof(test_buf)) {
+    test_buf[test_index++] = ch;
+  }
+  return 1;
+}
+
+bool check_test_emitter(char const *expected, int n) {
+  bool match = test_index == n && memcmp(expected, test_buf, n) == 0;
+  test_index = 0;
+  return match;
+}
+
+// ======================================================================
+// tests
+
+void mu_slip_emitter_test() {
+  PRINTF("...mu_slip_emitter_test\r\n");
+  mu_slip_t slip;
+  mu_sink_t *out = mu_slip_init(&slip, test_emitter, NULL);
+
+  MU_TEST(mu_printf(mu_sink_emitter, out, "t=%d", 42) == 4);
+  MU_TEST(check_test_emitter("t=42\xc0", 5));
+
+  // END and ESC are escaped wherever they come from
+  MU_TEST(mu_printf(mu_sink_emitter, out, "a\xc0%c%s", 0xdb, "\xdb\xc0z") == 6);
+  MU_TEST(check_test_emitter("a\xdb\xdc\xdb\xdd\xdb\xdd\xdb\xdcz\xc0", 11));
+
+  // longer than a chunk
+  MU_TEST(mu_printf(mu_sink_emitter, out, "%s\xc0%s",
+                    "0123456789abcdefghijklmnopqrstuvwxyz",
+                    "0123456789") == 47);
+  MU_TEST(check_test_emitter("0123456789abcdefghijklmnopqrstuvwxyz\xdb\xdc"
+                             "0123456789\xc0", 49));
+
+  MU_TEST(mu_printf(mu_sink_emitter, out, "") == 0);
+  MU_TEST(check_test_emitter("", 0));
+}
+
+void mu_slip_sink_test() {
+  PRINTF("...mu_slip_sink_test\r\n");
+  char buf[32];
+  mu_buffer_sink_t downstream;
+  mu_slip_t slip;
+  mu_sink_t *out = mu_slip_init(&slip, mu_sink_emitter,
+                                mu_buffer_sink_init(&downstream, buf,
+                                                    sizeof(buf)));
+
+  mu_printf(mu_sink_emitter, out, "x=%x\xdb", 255);
+  mu_printf(mu_sink_emitter, out, "y");
+  MU_TEST(downstream.length == 9);
+  MU_TEST(memcmp(buf, "x=ff\xdb\xdd\xc0y\xc0", 9) == 0);
+}
+
+void mu_slip_test() {
+  PRINTF("begin tests...\r\n");
+  mu_slip_emitter_test();
+  mu_slip_sink_test();
+  PRINTF("...end of tests\r\n");
+}
+
+#ifdef STANDALONE
+
+int main() {
+  mu_slip_test();
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * mu_unlzss.c - decompress a mu_lzss stream on the host
+ *
+ * gcc -Wall -O2 -o mu_unlzss mu_unlzss.c mu_lzss.c mu_printf.c
+ *
+ * Usage: mu_unlzss [file]
+ *   Reads a stream written by a mu_lzss_t (e.g. a flash log pulled off a
+ *   device) from file, or from stdin, and writes the text to stdout.
+ */
+
+#include "mu_lzss.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv) {
+  FILE *in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+  char *src = NULL;
+  char *dst = NULL;
+  size_t capacity = 0;
+  size_t n = 0;
+  int size;
+  int length;
+
+  if (in == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [file]\n", argv[0]);
+    return 1;
+  }
+  do {
+    if (n == capacity) {
+      capacity = capacity ? capacity * 2 : 65536;
+      src = realloc(src, capacity);
+    }
+    n += fread(src + n, 1, capacity - n, in);
+  } while (!feof(in) && !ferror(in));
+
+  // each compressed byte stands for under 9 chars, and usually far fewer:
+  // start small and grow until the text fits
+  for (size = n * 4 + 64; ; size *= 2) {
+    dst = realloc(dst, size);
+    length = mu_lzss_decode(src, n, dst, size);
+    if (length >= 0 || size >= (int)n * 9 + 64) {
+      break;
+    }
+  }
+  if (length < 0) {
+    fprintf(stderr, "%s: not a valid mu_lzss stream\n",
+            argc > 1 ? argv[1] : "stdin");
+    return 1;
+  }
+  fwrite(dst, 1, length, stdout);
+  return 0;
+}
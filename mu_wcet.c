@@ -0,0 +1,411 @@
+/*
+ * mu_wcet.c - worst case instruction count and stack depth of each directive
+ *
+ * gcc -Wall -O2 -o mu_wcet mu_wcet.c mu_printf.c && ./mu_wcet -b mu_wcet_budget.txt
+ *
+ * Host only (Linux).  Sweeps inputs that drive each directive to its worst
+ * case (extreme exponents, maximum widths and precisions, long strings) and
+ * measures every call two ways:
+ *
+ * - instructions: the call runs in a child process that the harness single
+ *   steps with ptrace(), so the count is exact and repeatable and needs
+ *   neither hardware counters nor valgrind.
+ * - stack: the call runs on a private stack painted with a known pattern
+ *   (via makecontext()); the deepest overwritten byte is its peak usage.
+ *
+ * Both are reported net of an empty call, which accounts for the harness's
+ * own overhead.
+ *
+ * Usage: mu_wcet [-v] [-b budget_file] [-w margin_percent]
+ *   -v  print every case, not just the worst case for each directive
+ *   -b  check the worst cases against a budget file.  Exits with status 1
+ *       if any directive is over budget, or 2 if instructions could not be
+ *       counted (ptrace not permitted, e.g. in some containers).
+ *   -w  print a budget file built from this run plus margin_percent (exits
+ *       with status 2 if instructions could not be counted)
+ *
+ * Budget file: one line per directive, "directive max_instructions
+ * max_stack_bytes".  '#' starts a comment.  A directive that is missing
+ * from the file, or has "-" in a column, is not checked for that column.
+ */
+
+#include "mu_printf.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#define CASE_STACK_SIZE (256 * 1024)
+#define STACK_PAINT 0xa5
+#define LONG_STRING_SIZE 1024
+#define MAX_DIRECTIVES 16
+
+typedef enum { ARG_NONE, ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_STRING } arg_type_t;
+
+typedef struct {
+  char const *directive;  // budget line this case counts against
+  char const *fmt;
+  arg_type_t type;
+  int i;
+  unsigned int u;
+  double d;
+  char const *s;
+} wcet_case_t;
+
+typedef struct {
+  long instructions;
+  long stack_bytes;
+} wcet_result_t;
+
+typedef struct {
+  char directive[8];
+  long max_instructions;  // -1: not checked
+  long max_stack_bytes;   // -1: not checked
+} budget_t;
+
+// =============================================================================
+// the sweep
+
+static char s_long_string[LONG_STRING_SIZE + 1];
+
+#define BASELINE(name) {name, "", ARG_NONE, 0, 0, 0.0, NULL}
+#define INT_CASE(name, fmt, v) {name, fmt, ARG_INT, v, 0, 0.0, NULL}
+#define UINT_CASE(name, fmt, v) {name, fmt, ARG_UINT, 0, v, 0.0, NULL}
+#define DOUBLE_CASE(name, fmt, v) {name, fmt, ARG_DOUBLE, 0, 0, v, NULL}
+#define STRING_CASE(name, fmt, v) {name, fmt, ARG_STRING, 0, 0, 0.0, v}
+
+static wcet_case_t s_cases[] = {
+  BASELINE("baseline"),
+
+  INT_CASE("%d", "%d", 0),
+  INT_CASE("%d", "%d", -2147483647 - 1),
+  INT_CASE("%d", "%d", 2147483647),
+  INT_CASE("%d", "%+255d", -2147483647 - 1),
+  INT_CASE("%d", "%-255d", -2147483647 - 1),
+  INT_CASE("%d", "%0255d", -2147483647 - 1),
+  INT_CASE("%d", "%255.254d", -2147483647 - 1),
+
+  UINT_CASE("%x", "%x", 0xffffffff),
+  UINT_CASE("%x", "%08x", 0xffffffff),
+  UINT_CASE("%x", "%#255x", 0xffffffff),
+  UINT_CASE("%x", "%#-255X", 0xffffffff),
+  UINT_CASE("%x", "%#255.254x", 0xffffffff),
+
+  UINT_CASE("%o", "%o", 0xffffffff),
+  UINT_CASE("%o", "%#255o", 0xffffffff),
+
+  UINT_CASE("%b", "%b", 0xffffffff),
+  UINT_CASE("%b", "%#255b", 0xffffffff),
+  UINT_CASE("%b", "%#255.254b", 0xffffffff),
+
+  UINT_CASE("%c", "%c", 'a'),
+  UINT_CASE("%c", "%255c", 'a'),
+
+  STRING_CASE("%s", "%s", ""),
+  STRING_CASE("%s", "%s", s_long_string),
+  STRING_CASE("%s", "%255s", ""),
+  STRING_CASE("%s", "%-255s", ""),
+  STRING_CASE("%s", "%.254s", s_long_string),
+  STRING_CASE("%s", "%255.254s", s_long_string),
+
+  DOUBLE_CASE("%f", "%f", 0.0),
+  DOUBLE_CASE("%f", "%f", 1.17549435e-38),
+  DOUBLE_CASE("%f", "%f", 4294967040.0),
+  DOUBLE_CASE("%f", "%f", 3.40282347e+38),
+  DOUBLE_CASE("%f", "%.9f", -99999.999999),
+  DOUBLE_CASE("%f", "%+255.9f", -4294967040.0),
+  DOUBLE_CASE("%f", "%.30f", 1.0),
+  DOUBLE_CASE("%f", "%.254f", 9.99),
+
+  DOUBLE_CASE("%e", "%e", 0.0),
+  DOUBLE_CASE("%e", "%e", 1.17549435e-38),
+  DOUBLE_CASE("%e", "%e", 3.40282347e+38),
+  DOUBLE_CASE("%e", "%e", 4.9406564584124654e-324),
+  DOUBLE_CASE("%e", "%e", 1.7976931348623157e+308),
+  DOUBLE_CASE("%e", "%+255.9e", -1.7976931348623157e+308),
+  DOUBLE_CASE("%e", "%.254e", 9.99),
+};
+
+#define N_CASES ((int)(sizeof(s_cases) / sizeof(s_cases[0])))
+
+static volatile char s_register;
+
+int register_emitter(void *obj, char ch) {
+  s_register = ch;
+  return 1;
+}
+
+int run_case(wcet_case_t const *wc) {
+  switch(wc->type) {
+  case ARG_INT:
+    return mu_printf(register_emitter, NULL, wc->fmt, wc->i);
+  case ARG_UINT:
+    return mu_printf(register_emitter, NULL, wc->fmt, wc->u);
+  case ARG_DOUBLE:
+    return mu_printf(register_emitter, NULL, wc->fmt, wc->d);
+  case ARG_STRING:
+    return mu_printf(register_emitter, NULL, wc->fmt, wc->s);
+  default:
+    return mu_printf(register_emitter, NULL, wc->fmt);
+  }
+}
+
+// =============================================================================
+// instruction count: single step each case in a traced child
+
+/*
+ * Fill in results[i].instructions for every case.  Returns false if the
+ * child could not be traced.
+ */
+bool count_instructions(wcet_result_t *results) {
+  pid_t pid = fork();
+  int status;
+  int i;
+
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    // child: stop before and after each case
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0) {
+      _exit(1);
+    }
+    for (i=0; i<N_CASES; i++) {
+      raise(SIGSTOP);
+      run_case(&s_cases[i]);
+      raise(SIGSTOP);
+    }
+    _exit(0);
+  }
+
+  for (i=0; i<N_CASES; i++) {
+    long n = 0;
+    // run to the stop before the case...
+    if (i > 0) {
+      ptrace(PTRACE_CONT, pid, NULL, NULL);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFSTOPPED(status)) {
+      return false;
+    }
+    // ...then step until the stop after it
+    while (true) {
+      if (ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL) < 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        return false;
+      }
+      waitpid(pid, &status, 0);
+      if (!WIFSTOPPED(status) || WSTOPSIG(status) == SIGSTOP) {
+        break;
+      }
+      n += 1;
+    }
+    results[i].instructions = n;
+  }
+  ptrace(PTRACE_CONT, pid, NULL, NULL);
+  waitpid(pid, &status, 0);
+  return true;
+}
+
+// =============================================================================
+// stack depth: run each case on a painted stack
+
+static ucontext_t s_main_context;
+static ucontext_t s_case_context;
+static int s_current_case;
+
+void case_trampoline() {
+  run_case(&s_cases[s_current_case]);
+}
+
+long measure_stack(int i, unsigned char *stack) {
+  long depth;
+
+  memset(stack, STACK_PAINT, CASE_STACK_SIZE);
+  getcontext(&s_case_context);
+  s_case_context.uc_stack.ss_sp = stack;
+  s_case_context.uc_stack.ss_size = CASE_STACK_SIZE;
+  s_case_context.uc_link = &s_main_context;
+  makecontext(&s_case_context, case_trampoline, 0);
+  s_current_case = i;
+  swapcontext(&s_main_context, &s_case_context);
+
+  // the stack grows down: find the lowest byte that was written
+  for (depth=0; depth<CASE_STACK_SIZE; depth++) {
+    if (stack[depth] != STACK_PAINT) {
+      break;
+    }
+  }
+  return CASE_STACK_SIZE - depth;
+}
+
+// =============================================================================
+// budgets
+
+int load_budget(char const *path, budget_t *budgets) {
+  FILE *f = fopen(path, "r");
+  char line[128];
+  int n = 0;
+
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) && n < MAX_DIRECTIVES) {
+    char directive[8];
+    char instructions[24];
+    char stack[24];
+    if (line[0] == '#' ||
+        sscanf(line, "%7s %23s %23s", directive, instructions, stack) != 3) {
+      continue;
+    }
+    strcpy(budgets[n].directive, directive);
+    budgets[n].max_instructions =
+        strcmp(instructions, "-") ? strtol(instructions, NULL, 10) : -1;
+    budgets[n].max_stack_bytes =
+        strcmp(stack, "-") ? strtol(stack, NULL, 10) : -1;
+    n += 1;
+  }
+  fclose(f);
+  return n;
+}
+
+budget_t const *find_budget(budget_t const *budgets, int n, char const *d) {
+  int i;
+  for (i=0; i<n; i++) {
+    if (strcmp(budgets[i].directive, d) == 0) {
+      return &budgets[i];
+    }
+  }
+  return NULL;
+}
+
+// =============================================================================
+
+int main(int argc, char **argv) {
+  wcet_result_t results[N_CASES];
+  char const *directives[MAX_DIRECTIVES];
+  wcet_result_t worst[MAX_DIRECTIVES];
+  budget_t budgets[MAX_DIRECTIVES];
+  char const *budget_path = NULL;
+  int n_budgets = 0;
+  int n_directives = 0;
+  int margin = -1;
+  bool verbose = false;
+  bool over = false;
+  bool counted = true;
+  int i, j, a;
+
+  for (a=1; a<argc; a++) {
+    if (strcmp(argv[a], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+      budget_path = argv[++a];
+    } else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc) {
+      margin = strtol(argv[++a], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-v] [-b budget_file] [-w margin_percent]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  memset(s_long_string, 'x', LONG_STRING_SIZE);
+
+  // warm up: the first call through a PLT entry runs the dynamic linker,
+  // whose stack and instructions would be charged to that case
+  for (i=0; i<N_CASES; i++) {
+    run_case(&s_cases[i]);
+  }
+
+  unsigned char *stack = malloc(CASE_STACK_SIZE);
+  for (i=0; i<N_CASES; i++) {
+    results[i].stack_bytes = measure_stack(i, stack);
+  }
+  free(stack);
+  if (!count_instructions(results)) {
+    fprintf(stderr, "ptrace unavailable: instruction counts not measured\n");
+    counted = false;
+    for (i=0; i<N_CASES; i++) {
+      results[i].instructions = -1;
+    }
+  }
+
+  // net of the empty call, worst case per directive
+  for (i=1; i<N_CASES; i++) {
+    wcet_case_t const *wc = &s_cases[i];
+    if (results[i].instructions >= 0) {
+      results[i].instructions -= results[0].instructions;
+    }
+    results[i].stack_bytes -= results[0].stack_bytes;
+    if (verbose) {
+      printf("%-6s %-14s %10ld instructions %7ld stack bytes\n",
+             wc->directive, wc->fmt, results[i].instructions,
+             results[i].stack_bytes);
+    }
+    for (j=0; j<n_directives; j++) {
+      if (strcmp(directives[j], wc->directive) == 0) {
+        break;
+      }
+    }
+    if (j == n_directives) {
+      directives[n_directives++] = wc->directive;
+      worst[j] = results[i];
+    }
+    if (results[i].instructions > worst[j].instructions) {
+      worst[j].instructions = results[i].instructions;
+    }
+    if (results[i].stack_bytes > worst[j].stack_bytes) {
+      worst[j].stack_bytes = results[i].stack_bytes;
+    }
+  }
+
+  if (budget_path) {
+    n_budgets = load_budget(budget_path, budgets);
+    if (n_budgets < 0) {
+      return 2;
+    }
+  }
+
+  if (margin >= 0) {
+    if (!counted) {
+      return 2;  // a budget without instruction counts would check nothing
+    }
+    printf("# directive  max_instructions  max_stack_bytes\n");
+    printf("# worst case measured by mu_wcet, plus %d%%\n", margin);
+    for (j=0; j<n_directives; j++) {
+      printf("%-10s %17ld %16ld\n",
+             directives[j],
+             worst[j].instructions * (100 + margin) / 100,
+             worst[j].stack_bytes * (100 + margin) / 100);
+    }
+    return 0;
+  }
+
+  printf("directive  instructions  budget  stack_bytes  budget\n");
+  for (j=0; j<n_directives; j++) {
+    budget_t const *b = find_budget(budgets, n_budgets, directives[j]);
+    long max_instructions = b ? b->max_instructions : -1;
+    long max_stack = b ? b->max_stack_bytes : -1;
+    bool over_instructions = max_instructions >= 0 &&
+        worst[j].instructions > max_instructions;
+    bool over_stack = max_stack >= 0 && worst[j].stack_bytes > max_stack;
+    printf("%-10s %13ld %7ld %12ld %7ld%s\n",
+           directives[j],
+           worst[j].instructions,
+           max_instructions,
+           worst[j].stack_bytes,
+           max_stack,
+           over_instructions || over_stack ? "  OVER BUDGET" : "");
+    over |= over_instructions || over_stack;
+  }
+  if (over) {
+    return 1;
+  }
+  // a budget that could not be checked must not pass
+  return budget_path && !counted ? 2 : 0;
+}
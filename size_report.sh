@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# size_report.sh - code size of mu_printf.c in each feature configuration
+#
+# ./size_report.sh
+# CC=arm-none-eabi-gcc CFLAGS="-Os -mcpu=cortex-m0plus -mthumb" ./size_report.sh
+#
+# Compiles mu_printf.c once per configuration (see mu_printf_config.h) and
+# prints the size of its .text and .rodata sections.  CC defaults to gcc and
+# CFLAGS to -Os.  SIZE defaults to the size tool that matches CC.
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--Os}
+SIZE=${SIZE:-$(echo "$CC" | sed 's/gcc$/size/')}
+[ "$SIZE" = "$CC" ] && SIZE=size
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+OBJ=$(mktemp /tmp/mu_printf_size.XXXXXX)
+trap 'rm -f "$OBJ"' EXIT
+
+NO_FLOAT="-DMU_PRINTF_ENABLE_FLOAT=0"
+NO_E="-DMU_PRINTF_ENABLE_E=0"
+NO_BINARY="-DMU_PRINTF_ENABLE_BINARY=0"
+NO_ESCAPE="-DMU_PRINTF_ENABLE_ESCAPE=0"
+NO_STRUCTURED="-DMU_PRINTF_ENABLE_STRUCTURED=0"
+NO_FLAGS="-DMU_PRINTF_ENABLE_FLAGS=0"
+NO_WIDTH="-DMU_PRINTF_ENABLE_WIDTH=0"
+
+# section size (decimal) of $OBJ, or 0 if it has no such section
+section_size() {
+  "$SIZE" -A "$OBJ" | awk -v name="$1" '
+    index($1, name) == 1 { total += $2 }
+    END { print total + 0 }'
+}
+
+report() {
+  label=$1
+  shift
+  if ! $CC $CFLAGS "$@" -I"$DIR" -c "$DIR/mu_printf.c" -o "$OBJ"; then
+    echo "$label: compile failed" >&2
+    exit 1
+  fi
+  printf "%-24s %8s %8s\n" "$label" "$(section_size .text)" \
+    "$(section_size .rodata)"
+}
+
+echo "$CC $CFLAGS"
+printf "%-24s %8s %8s\n" "configuration" ".text" ".rodata"
+report "full"
+report "no %e" $NO_E
+report "no float" $NO_FLOAT
+report "no %b" $NO_BINARY
+report "no structured" $NO_STRUCTURED
+report "no %j %q" $NO_ESCAPE
+report "no flags" $NO_FLAGS
+report "no width" $NO_WIDTH
+report "integers and strings" $NO_FLOAT $NO_BINARY $NO_ESCAPE
+report "minimal" $NO_FLOAT $NO_BINARY $NO_ESCAPE $NO_FLAGS $NO_WIDTH